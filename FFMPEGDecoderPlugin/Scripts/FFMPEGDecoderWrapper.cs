@@ -7,12 +7,132 @@ namespace HTC.UnityPlugin.Multimedia
     {
         private const string NATIVE_LIBRARY_NAME = "libffmpegdecoder";
 
+        //  Mirrors NativeHistogram in DecoderStats.h. Bucket 0 counts durations below 1 us, bucket i counts [2^(i-1), 2^i) us.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct NativeHistogram
+        {
+            public long count;
+            public long sumUs;
+            public long maxUs;
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 20)]
+            public uint[] buckets;
+        }
+
+        //  Mirrors NativeDecoderStats in DecoderStats.h.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct NativeDecoderStats
+        {
+            public NativeHistogram demuxTime;
+            public NativeHistogram videoDecodeTime;
+            public NativeHistogram audioDecodeTime;
+            public NativeHistogram conversionTime;
+            public NativeHistogram seekLatency;
+            public NativeHistogram resumeLatency;
+            public long videoFramesDecoded;
+            public long audioFramesDecoded;
+            public long videoFramesDropped;
+            public long videoFramesCapped;
+            public long videoFramesPresented;
+            public long bytesRead;
+            public long seekCount;
+            public long bufferUnderruns;
+            public long audioUnderruns;
+            public int videoQueueDepth;
+            public int audioQueueDepth;
+            public int videoQueuePeak;
+            public int audioQueuePeak;
+            public int videoQueueTarget;
+            public int audioQueueTarget;
+        }
+
+        //  Mirrors NativeDecoderOptions in DecoderOptions.h, start from nativeGetDefaultDecoderOptions.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct NativeDecoderOptions
+        {
+            public int useTCP;
+            public int seekToAny;
+            public int videoBufferMin;
+            public int videoBufferMax;
+            public int audioBufferMin;
+            public int audioBufferMax;
+            public int openTimeoutMs;       //  10 s by default, an open of a stalled source used to wait forever and now fails.
+            public int readTimeoutMs;       //  0 by default. When set, a read that stalls longer ends playback like end of file.
+            public long sliceThresholdPixels;
+            public int videoOutputFormat;   //  0 RGB24, 1 RGBA.
+            public int codecThreads;
+            public int priority;
+            public int ioBufferSize;
+            public long probeSize;
+            public long analyzeDurationUs;
+            public int liveMode;            //  Low latency settings and live edge tracking for RTSP and HLS.
+            public int liveTargetDelayMs;
+            public int audioOutputFormat;   //  0 interleaved float, 1 interleaved int16, 2 planar float.
+            public int mappedInput;         //  Memory map local files instead of the file protocol. Only for complete files never rewritten while playing.
+        }
+
+        //  Mirrors NativeAudioLayout in DecoderOptions.h, filled by nativeGetAudioPlanes.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct NativeAudioLayout
+        {
+            public int sampleFormat;
+            public int channels;
+            public int sampleRate;
+            public int samples;
+            public int bytesPerSample;
+            public int planeCount;
+            public int planeSize;
+        }
+
+        //  Mirrors NativeVideoLease in DecoderOptions.h. The planes stay valid until nativeReleaseVideoLease, also
+        //  after nativeDestroyDecoder, so every lease has to be released.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct NativeVideoLease
+        {
+            public long handle;
+            public double time;
+            public int width;
+            public int height;
+            public int format;
+            public int planeCount;
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)]
+            public IntPtr[] planes;
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)]
+            public int[] strides;
+        }
+
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern void nativeCleanAll();
 
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern void nativeCleanDestroyedDecoders();
 
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeGetPendingTeardowns(ref int count, ref long bytes);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetCodecPoolSize(int size);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeGetCodecPoolStats(ref int idleCount, ref int hitCount, ref int missCount);
+
+        //  Total codec threads of all decoders, 0 for the core count, negative for threads=auto per decoder.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetCodecThreadBudget(int threadCount);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeGetCodecThreadStats(ref int budget, ref int liveDecoders, ref int allocatedThreads);
+
+        //  Async opens and resumes running at once, 0 for half the cores, negative for no limit.
+        //  Queued opens start by nativeSetDecoderPriority, highest first, and are cancelled by nativeDestroyDecoder.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetOpenConcurrency(int concurrency);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeGetOpenStats(ref int concurrency, ref int queued, ref int running, ref long cancelled, ref NativeHistogram queueWait, ref NativeHistogram openTime);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeResetOpenStats();
+
         //  Decoder
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern int nativeCreateDecoder(string filePath, ref int id);
@@ -20,9 +140,30 @@ namespace HTC.UnityPlugin.Multimedia
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern int nativeCreateDecoderAsync(string filePath, ref int id);
 
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern int nativeCreateDecoderPrerollAsync(string filePath, float startTime, ref int id);
+
+        //  A negative prerollTime skips the preroll.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern int nativeCreateDecoderWithOptionsAsync(string filePath, ref NativeDecoderOptions options, float prerollTime, ref int id);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeGetDefaultDecoderOptions(ref NativeDecoderOptions options);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetDefaultDecoderOptions(ref NativeDecoderOptions options);
+
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern int nativeGetDecoderState(int id);
 
+        //  0 low, 1 normal, 2 high. Applied when the video codec opens, so call it right after creating the decoder.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetDecoderPriority(int id, int priority);
+
+        //  Frames per second handed out at most, for small or distant screens. Can change at any time, 0 removes the cap.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetMaxFrameRate(int id, float maxFrameRate);
+
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern bool nativeStartDecoding(int id);
 
@@ -32,6 +173,15 @@ namespace HTC.UnityPlugin.Multimedia
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern void nativeDestroyDecoder(int id);
 
+        //  Frees codecs, queues and optionally the input of a paused or off-screen decoder, the position is kept.
+        //  Returns at once, the state is 9 while the release runs and 8 once hibernated.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern bool nativeHibernateDecoder(int id, bool isCloseInput);
+
+        //  Poll nativeGetDecoderState until INITIALIZED, then call nativeStartDecoding again.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeResumeDecoderAsync(int id);
+
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern bool nativeIsVideoBufferFull(int id);
 
@@ -44,9 +194,50 @@ namespace HTC.UnityPlugin.Multimedia
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern bool nativeGrabVideoFrame(int id, ref IntPtr frameDataPtr, ref bool frameReady);
 
+        //  Grabs the frame due at presentationTime, a negative time uses the decoder clock. Older queued frames are released.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeGrabVideoFrameAt(int id, float presentationTime, ref IntPtr frameDataPtr, ref bool frameReady, ref float frameTime);
+
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern bool nativeReleaseVideoFrame(int id);
 
+        //  Several leases may be held at once, e.g. for a worker thread upload, and released in any order.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern bool nativeLeaseVideoFrame(int id, ref NativeVideoLease lease);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern bool nativeLeaseVideoFrameAt(int id, float presentationTime, ref NativeVideoLease lease);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern bool nativeReleaseVideoLease(int id, long handle);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeGetStartupTimings(int id, ref float open, ref float streamInfo, ref float codecOpen, ref float firstPacket, ref float firstFrame);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern bool nativeGetDecoderStats(int id, ref NativeDecoderStats stats);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeResetDecoderStats(int id);
+
+        //  Seconds behind the live edge and the catch up clock rate, false when the decoder is not in live mode.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern bool nativeGetLiveLatency(int id, ref float latency, ref float rate);
+
+        //  Log, level follows Logger::Level (0 none .. 5 verbose), categories is a Logger::Category mask.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetLogLevel(int level, int categories);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeFlushLog();
+
+        //  Trace, the dump is Chrome trace-event JSON for chrome://tracing or Perfetto.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetTraceEnabled(bool isEnabled);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern bool nativeDumpTrace(string path);
+
         //  Video
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern bool nativeIsVideoEnabled(int id);
@@ -79,9 +270,19 @@ namespace HTC.UnityPlugin.Multimedia
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern float nativeGetAudioData(int id, ref IntPtr output, ref int lengthPerChannel);
 
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern float nativeGetAudioPlanes(int id, IntPtr[] planes, int maxPlanes, ref NativeAudioLayout layout);
+
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern void nativeFreeAudioData(int id);
 
+        //  Audio ring, nativeFillAudioBuffer is safe to call from OnAudioFilterRead and never blocks.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern bool nativeSetAudioRingEnable(int id, bool isEnable, int capacityMs);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern int nativeFillAudioBuffer(int id, float[] buffer, int frameCount, int channels);
+
         //  Seek
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern void nativeSetSeekTime(int id, float sec);
@@ -89,8 +290,26 @@ namespace HTC.UnityPlugin.Multimedia
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern bool nativeIsSeekOver(int id);
 
+        //  Clock, source 0 follows nativeSetVideoTime and 1 follows the audio pulled with nativeGetAudioData or read from the audio ring.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetClockSource(int id, int source);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern void nativeSetAudioOutputLatency(int id, float seconds);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern float nativeGetClockTime(int id);
+
         //  Utility
         [DllImport(NATIVE_LIBRARY_NAME)]
         public static extern int nativeGetMetaData(string filePath, out IntPtr key, out IntPtr value);
+
+        //  Seek bar preview atlas, blocks until done so call it from a worker thread. Size the atlas with nativeGetSpriteSheetSize.
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern long nativeGetSpriteSheetSize(int count, int tileWidth, int tileHeight, int columns, int videoOutputFormat);
+
+        [DllImport(NATIVE_LIBRARY_NAME)]
+        public static extern int nativeCreateSpriteSheet(string filePath, int count, int tileWidth, int tileHeight, int columns,
+            int workerCount, int videoOutputFormat, byte[] atlas, float[] tileTimes);
     }
 }
\ No newline at end of file
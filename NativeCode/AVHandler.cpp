@@ -3,19 +3,38 @@
 #include "AVHandler.h"
 #include "DecoderFFmpeg.h"
 #include "Logger.h"
+#include <algorithm>
+#include <string.h>
 
-AVHandler::AVHandler() {
+//	The id only labels trace events, -1 for decoders not created through the API such as metadata queries.
+AVHandler::AVHandler(int id, const NativeDecoderOptions* options) {
 	mDecoderState = UNINITIALIZED;
 	mSeekTime = 0.0;
-	mIDecoder = std::make_unique<DecoderFFmpeg>();
+	mResumeTime = 0.0;
+	mIsAudioRingEnabled = false;
+	mIsAudioRingFlushPending = false;
+	mAudioRingOffset = 0;
+	mAudioRingFrameTime = -1.0;
+	mAudioRingEndTime = -1.0;
+	mAudioRingSampleRate = 0;
+	mIsStreamReopening = false;
+	mIsVideoWanted = true;
+	mIsAudioWanted = true;
+	mIDecoder = std::make_unique<DecoderFFmpeg>(id, options);
 }
 
-void AVHandler::init(const char* filePath) {
+//	With preroll, the first frame at startTime is decoded before the state turns INITIALIZED.
+void AVHandler::init(const char* filePath, bool isPreroll, double startTime) {
 	if (mIDecoder == nullptr || !mIDecoder->init(filePath)) {
 		mDecoderState = INIT_FAIL;
-	} else {
-		mDecoderState = INITIALIZED;
+		return;
+	}
+
+	if (isPreroll && !mIDecoder->preroll(startTime)) {
+		LOG_ERROR(Logger::CATEGORY_DECODER, "Preroll fail. \n");
 	}
+
+	mDecoderState = INITIALIZED;
 }
 
 AVHandler::DecoderState AVHandler::getDecoderState() {
@@ -24,6 +43,10 @@ AVHandler::DecoderState AVHandler::getDecoderState() {
 
 void AVHandler::stopDecoding() {
 	mDecoderState = STOP;
+	if (mIDecoder != nullptr) {
+		mIDecoder->interrupt();
+	}
+
 	if (mDecodeThread.joinable()) {
 		mDecodeThread.join();
 	}
@@ -34,25 +57,123 @@ void AVHandler::stopDecoding() {
 
 void AVHandler::stop() {
     mDecoderState = STOP;
+	if (mIDecoder != nullptr) {
+		mIDecoder->interrupt();
+	}
+}
+
+//	Keeps the presented position for resume and asks the decode thread to stop, returns without waiting for it.
+bool AVHandler::beginHibernate() {
+	DecoderState state = mDecoderState;
+	if (mIDecoder == nullptr || state < INITIALIZED || state == STOP || state == HIBERNATED || state == HIBERNATING) {
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Hibernate unavailable. \n");
+		return false;
+	}
+
+	double position = mSeekTime;
+	if (state != SEEK) {
+		IDecoder::VideoInfo videoInfo = mIDecoder->getVideoInfo();
+		IDecoder::AudioInfo audioInfo = mIDecoder->getAudioInfo();
+		double lastTime = videoInfo.isEnabled ? videoInfo.lastTime : audioInfo.lastTime;
+		if (lastTime >= 0) {
+			position = lastTime;
+		}
+	}
+
+	mResumeTime = position;
+	{
+		std::lock_guard<std::mutex> lock(mStreamToggleMutex);
+		mIsVideoWanted = mIDecoder->getVideoInfo().isEnabled;
+		mIsAudioWanted = mIDecoder->getAudioInfo().isEnabled;
+		mIsStreamReopening = true;
+	}
+	mDecoderState = HIBERNATING;
+	mIDecoder->interrupt();
+	return true;
+}
+
+//	Joins the decode thread and frees the decoder down to its stream info. A stop from a destroy in the meantime wins.
+void AVHandler::finishHibernate(bool isCloseInput) {
+	if (mDecodeThread.joinable()) {
+		mDecodeThread.join();
+	}
+
+	//	The decode thread is joined, so this thread may act as the ring producer.
+	if (mAudioRing != nullptr) {
+		flushAudioRing(mAudioRing->getChannels());
+	}
+
+	DecoderState expected = HIBERNATING;
+	if (!mIDecoder->hibernate(isCloseInput)) {
+		mDecoderState.compare_exchange_strong(expected, INIT_FAIL);
+		return;
+	}
+	mDecoderState.compare_exchange_strong(expected, HIBERNATED);
+}
+
+//	Blocks until the first frame at the hibernated position is decoded, the state turns INITIALIZED as after init.
+void AVHandler::resume() {
+	if (mIDecoder == nullptr || mDecoderState != HIBERNATED) {
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Not hibernated. \n");
+		return;
+	}
+
+	//	Reported like an init in progress, so seeks and hibernate are refused until it is done.
+	mDecoderState = UNINITIALIZED;
+	bool isVideoEnabled = false, isAudioEnabled = false;
+	{
+		std::lock_guard<std::mutex> lock(mStreamToggleMutex);
+		isVideoEnabled = mIsVideoWanted;
+		isAudioEnabled = mIsAudioWanted;
+	}
+	if (!mIDecoder->resume(mResumeTime, isVideoEnabled, isAudioEnabled)) {
+		mDecoderState = INIT_FAIL;
+		return;
+	}
+
+	//	Toggles made while the streams reopened.
+	{
+		std::lock_guard<std::mutex> lock(mStreamToggleMutex);
+		if (mIsVideoWanted != isVideoEnabled) {
+			mIDecoder->setVideoEnable(mIsVideoWanted);
+		}
+		if (mIsAudioWanted != isAudioEnabled) {
+			mIDecoder->setAudioEnable(mIsAudioWanted);
+		}
+		mIsStreamReopening = false;
+	}
+
+	mSeekTime = mResumeTime;
+	mDecoderState = INITIALIZED;
 }
 
 bool AVHandler::isDecoderRunning() const {
     return mDecodeThreadRunning;
 }
 
-double AVHandler::getVideoFrame(void** frameData) {
-	if (mIDecoder == nullptr || !mIDecoder->getVideoInfo().isEnabled || mDecoderState == SEEK) {
-		LOG("Video is not available. \n");
-		*frameData = nullptr;
-		return -1;
+bool AVHandler::leaseVideoFrame(double time, NativeVideoLease& lease) {
+	if (mIDecoder == nullptr || !mIDecoder->getVideoInfo().isEnabled || mDecoderState == SEEK || mDecoderState == HIBERNATING) {
+		LOG_VERBOSE(Logger::CATEGORY_VIDEO, "Video is not available. \n");
+		memset(&lease, 0, sizeof(NativeVideoLease));
+		lease.time = -1;
+		return false;
+	}
+
+	return mIDecoder->leaseVideoFrame(time, lease);
+}
+
+//	Allowed in every state, a lease taken before a seek or hibernate is still the host's to release.
+bool AVHandler::releaseVideoFrame(int64_t handle) {
+	if (mIDecoder == nullptr) {
+		return false;
 	}
 
-	return mIDecoder->getVideoFrame(frameData);
+	return mIDecoder->releaseVideoFrame(handle);
 }
 
 double AVHandler::getAudioFrame(uint8_t** outputFrame, int& frameSize) {
-	if (mIDecoder == nullptr || !mIDecoder->getAudioInfo().isEnabled || mDecoderState == SEEK) {
-		LOG("Audio is not available. \n");
+	if (mIDecoder == nullptr || !mIDecoder->getAudioInfo().isEnabled || mDecoderState == SEEK || mDecoderState == HIBERNATING) {
+		LOG_VERBOSE(Logger::CATEGORY_AUDIO, "Audio is not available. \n");
 		*outputFrame = nullptr;
 		return -1;
 	}
@@ -60,18 +181,22 @@ double AVHandler::getAudioFrame(uint8_t** outputFrame, int& frameSize) {
 	return mIDecoder->getAudioFrame(outputFrame, frameSize);
 }
 
-void AVHandler::freeVideoFrame() {
-	if (mIDecoder == nullptr || !mIDecoder->getVideoInfo().isEnabled || mDecoderState == SEEK) {
-		LOG("Video is not available. \n");
-		return;
+double AVHandler::getAudioPlanes(uint8_t** planes, int maxPlanes, NativeAudioLayout& layout) {
+	if (mIDecoder == nullptr || !mIDecoder->getAudioInfo().isEnabled || mDecoderState == SEEK || mDecoderState == HIBERNATING) {
+		LOG_VERBOSE(Logger::CATEGORY_AUDIO, "Audio is not available. \n");
+		memset(&layout, 0, sizeof(NativeAudioLayout));
+		for (int i = 0; i < maxPlanes; i++) {
+			planes[i] = nullptr;
+		}
+		return -1;
 	}
 
-	mIDecoder->freeVideoFrame();
+	return mIDecoder->getAudioPlanes(planes, maxPlanes, layout);
 }
 
 void AVHandler::freeAudioFrame() {
-	if (mIDecoder == nullptr || !mIDecoder->getAudioInfo().isEnabled || mDecoderState == SEEK) {
-		LOG("Audio is not available. \n");
+	if (mIDecoder == nullptr || !mIDecoder->getAudioInfo().isEnabled || mDecoderState == SEEK || mDecoderState == HIBERNATING) {
+		LOG_VERBOSE(Logger::CATEGORY_AUDIO, "Audio is not available. \n");
 		return;
 	}
 
@@ -80,33 +205,39 @@ void AVHandler::freeAudioFrame() {
 
 void AVHandler::startDecoding() {
 	if (mIDecoder == nullptr || mDecoderState != INITIALIZED) {
-		LOG("Not initialized, decode thread would not start. \n");
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Not initialized, decode thread would not start. \n");
 		return;
 	}
 
 	mDecodeThread = std::thread([&]() {
         mDecodeThreadRunning = true;
 		if (!(mIDecoder->getVideoInfo().isEnabled || mIDecoder->getAudioInfo().isEnabled)) {
-			LOG("No stream enabled. \n");
-			LOG("Decode thread would not start. \n");
+			LOG_WARNING(Logger::CATEGORY_DECODER, "No stream enabled. \n");
+			LOG_WARNING(Logger::CATEGORY_DECODER, "Decode thread would not start. \n");
 			return;
 		}
 
 		mDecoderState = DECODING;
-		while (mDecoderState != STOP) {
+		while (mDecoderState != STOP && mDecoderState != HIBERNATING) {
 			switch (mDecoderState) {
 			case DECODING:
+				//	Compare-exchange so an interrupted read can not overwrite a concurrent STOP.
 				if (!mIDecoder->decode()) {
-					mDecoderState = DECODE_EOF;
+					DecoderState expected = DECODING;
+					mDecoderState.compare_exchange_strong(expected, DECODE_EOF);
 				}
 				break;
-			case SEEK:
+			case SEEK: {
+				mIsAudioRingFlushPending = true;
 				mIDecoder->seek(mSeekTime);
-				mDecoderState = DECODING;
+				DecoderState expected = SEEK;
+				mDecoderState.compare_exchange_strong(expected, DECODING);
 				break;
+			}
 			case DECODE_EOF:
 				break;
 			}
+			pumpAudioRing();
 		}
         mDecodeThreadRunning = false;
 	});
@@ -117,8 +248,13 @@ AVHandler::~AVHandler() {
 }
 
 void AVHandler::setSeekTime(float sec) {
+	if (mDecoderState == HIBERNATED || mDecoderState == HIBERNATING) {
+		mResumeTime = sec;
+		return;
+	}
+
 	if (mDecoderState < INITIALIZED || mDecoderState == SEEK) {
-		LOG("Seek unavaiable.");
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Seek unavaiable.");
 		return;
 	} 
 
@@ -154,12 +290,204 @@ int AVHandler::getMetaData(char**& key, char**& value) {
 	return mIDecoder->getMetaData(key, value);
 }
 
+IDecoder::StartupTimings AVHandler::getStartupTimings() {
+	if (mIDecoder == nullptr) {
+		IDecoder::StartupTimings timings = { -1, -1, -1, -1, -1 };
+		return timings;
+	}
+
+	return mIDecoder->getStartupTimings();
+}
+
+int64_t AVHandler::getMemoryUsage() {
+	if (mIDecoder == nullptr) {
+		return 0;
+	}
+
+	return mIDecoder->getMemoryUsage();
+}
+
+DecoderStats* AVHandler::getStats() {
+	if (mIDecoder == nullptr) {
+		return nullptr;
+	}
+
+	return mIDecoder->getStats();
+}
+
+void AVHandler::setPriority(int priority) {
+	if (mIDecoder == nullptr) {
+		return;
+	}
+
+	mIDecoder->setPriority(priority);
+}
+
+void AVHandler::setMaxFrameRate(double frameRate) {
+	if (mIDecoder == nullptr) {
+		return;
+	}
+
+	mIDecoder->setMaxFrameRate(frameRate);
+}
+
+double AVHandler::updateLiveClock(double hostTime) {
+	if (mIDecoder == nullptr) {
+		return hostTime;
+	}
+
+	return mIDecoder->updateLiveClock(hostTime);
+}
+
+bool AVHandler::getLiveLatency(double& latency, double& rate) {
+	if (mIDecoder == nullptr) {
+		return false;
+	}
+
+	return mIDecoder->getLiveLatency(latency, rate);
+}
+
+bool AVHandler::setAudioRingEnable(bool isEnable, int capacityMs) {
+	if (!isEnable) {
+		mIsAudioRingEnabled = false;
+		return true;
+	}
+
+	if (mIDecoder == nullptr || mDecoderState < INITIALIZED) {
+		LOG_WARNING(Logger::CATEGORY_AUDIO, "Audio ring unavailable before init. \n");
+		return false;
+	}
+
+	IDecoder::AudioInfo audioInfo = mIDecoder->getAudioInfo();
+	if (!audioInfo.isEnabled || audioInfo.sampleRate == 0) {
+		LOG_WARNING(Logger::CATEGORY_AUDIO, "Audio ring needs an enabled audio stream. \n");
+		return false;
+	}
+
+	if (audioInfo.sampleFormat != AUDIO_OUTPUT_FLT) {
+		LOG_WARNING(Logger::CATEGORY_AUDIO, "Audio ring needs AUDIO_OUTPUT_FLT. \n");
+		return false;
+	}
+
+	if (mAudioRing == nullptr) {
+		int capacityFrames = (int)((int64_t)audioInfo.sampleRate * std::max(capacityMs, 1) / 1000);
+		mAudioRing = std::make_unique<AudioRing>(audioInfo.channels, capacityFrames);
+		LOG_INFO(Logger::CATEGORY_AUDIO, "Audio ring %d frames x %d channels. \n", capacityFrames, audioInfo.channels);
+	}
+
+	//	Whatever the ring held from an earlier enable is stale, the decode thread drops it before refilling.
+	mIsAudioRingFlushPending = true;
+	mIsAudioRingEnabled.store(true, std::memory_order_release);
+	return true;
+}
+
+//	Host audio thread. Never locks or allocates, a disabled ring fills silence.
+int AVHandler::fillAudioRing(float* output, int frameCount, int channels) {
+	if (!mIsAudioRingEnabled.load(std::memory_order_acquire)) {
+		if (output != nullptr && frameCount > 0 && channels > 0) {
+			memset(output, 0, (size_t)frameCount * channels * sizeof(float));
+		}
+		return 0;
+	}
+
+	return mAudioRing->read(output, frameCount, channels);
+}
+
+int64_t AVHandler::getAudioRingUnderruns() {
+	return mAudioRing != nullptr ? mAudioRing->getUnderruns() : 0;
+}
+
+void AVHandler::resetAudioRingUnderruns() {
+	if (mAudioRing != nullptr) {
+		mAudioRing->resetUnderruns();
+	}
+}
+
+//	Decode thread, moves decoded audio into the ring as far as it has room. A frame that does not fit is
+//	written in parts and stays queued until its last sample is in the ring.
+void AVHandler::pumpAudioRing() {
+	if (!mIsAudioRingEnabled.load(std::memory_order_acquire) || mIDecoder == nullptr) {
+		return;
+	}
+
+	if (mIsAudioRingFlushPending.exchange(false)) {
+		flushAudioRing(mAudioRing->getChannels());
+	}
+
+	IDecoder::AudioInfo audioInfo = mIDecoder->getAudioInfo();
+	if (!audioInfo.isEnabled || audioInfo.sampleRate == 0 || mDecoderState == SEEK) {
+		return;
+	}
+
+	int channels = (int)audioInfo.channels;
+	if (channels != mAudioRing->getChannels()) {
+		flushAudioRing(channels);
+	}
+
+	while (mAudioRing->getFreeFrames() > 0) {
+		uint8_t* data = nullptr;
+		int frameSize = 0;
+		double frameTime = mIDecoder->getAudioFrame(&data, frameSize);
+		if (data == nullptr || frameTime < 0) {
+			break;
+		}
+
+		//	Live mode may have dropped a partly written frame as late.
+		if (frameTime != mAudioRingFrameTime) {
+			mAudioRingFrameTime = frameTime;
+			mAudioRingOffset = 0;
+		}
+
+		//	The write and the time it moves the ring end to are one step for getAudioRingTime.
+		const float* samples = (const float*)data + (int64_t)mAudioRingOffset * channels;
+		{
+			std::lock_guard<std::mutex> lock(mAudioRingClockMutex);
+			mAudioRingOffset += mAudioRing->write(samples, frameSize - mAudioRingOffset);
+			mAudioRingEndTime = frameTime + (double)mAudioRingOffset / audioInfo.sampleRate;
+			mAudioRingSampleRate = (int)audioInfo.sampleRate;
+		}
+		if (mAudioRingOffset < frameSize) {
+			break;
+		}
+
+		mIDecoder->freeAudioFrame();
+		mAudioRingOffset = 0;
+		mAudioRingFrameTime = -1.0;
+	}
+}
+
+//	Producer side, drops the ring content together with the media time it stood for.
+void AVHandler::flushAudioRing(int channels) {
+	mAudioRing->setChannels(channels);
+	mAudioRingOffset = 0;
+	std::lock_guard<std::mutex> lock(mAudioRingClockMutex);
+	mAudioRingEndTime = -1.0;
+}
+
+//	Media time of the next sample the host reads from the ring, -1 while the ring holds no timed audio.
+//	Pending seeks and flushes count as no audio, so a seek does not hand the clock the old position.
+double AVHandler::getAudioRingTime() {
+	if (!mIsAudioRingEnabled.load(std::memory_order_acquire) || mIsAudioRingFlushPending || mDecoderState == SEEK) {
+		return -1.0;
+	}
+
+	std::lock_guard<std::mutex> lock(mAudioRingClockMutex);
+	if (mAudioRingEndTime < 0.0 || mAudioRingSampleRate <= 0) {
+		return -1.0;
+	}
+	return mAudioRingEndTime - (double)mAudioRing->getBufferedFrames() / mAudioRingSampleRate;
+}
+
 void AVHandler::setVideoEnable(bool isEnable) {
 	if (mIDecoder == nullptr) {
 		return;
 	}
 
-	mIDecoder->setVideoEnable(isEnable);
+	std::lock_guard<std::mutex> lock(mStreamToggleMutex);
+	mIsVideoWanted = isEnable;
+	if (!mIsStreamReopening) {
+		mIDecoder->setVideoEnable(isEnable);
+	}
 }
 
 void AVHandler::setAudioEnable(bool isEnable) {
@@ -167,7 +495,11 @@ void AVHandler::setAudioEnable(bool isEnable) {
 		return;
 	}
 
-	mIDecoder->setAudioEnable(isEnable);
+	std::lock_guard<std::mutex> lock(mStreamToggleMutex);
+	mIsAudioWanted = isEnable;
+	if (!mIsStreamReopening) {
+		mIDecoder->setAudioEnable(isEnable);
+	}
 }
 
 void AVHandler::setAudioAllChDataEnable(bool isEnable) {
@@ -2,33 +2,43 @@
 
 #pragma once
 #include "IDecoder.h"
+#include "DecoderOptions.h"
+#include "AudioRing.h"
 #include <thread>
 #include <mutex>
 #include <memory>
+#include <atomic>
  
 class AVHandler {
 public:
-	AVHandler();
+	AVHandler(int id = -1, const NativeDecoderOptions* options = nullptr);
 	~AVHandler();
 	
 	enum DecoderState {
-		INIT_FAIL = -1, UNINITIALIZED, INITIALIZED, DECODING, SEEK, BUFFERING, DECODE_EOF, STOP
+		INIT_FAIL = -1, UNINITIALIZED, INITIALIZED, DECODING, SEEK, BUFFERING, DECODE_EOF, STOP, HIBERNATED, HIBERNATING
 	};
 	DecoderState getDecoderState();
 
-	void init(const char* filePath);
+	void init(const char* filePath, bool isPreroll = false, double startTime = 0.0);
 	void startDecoding();
 	void stopDecoding();
 
     void stop();
 
+	//	beginHibernate only stops the decode thread from decoding. finishHibernate joins it and frees the decoder, it
+	//	blocks and belongs on a background thread. The state is HIBERNATING in between.
+	bool beginHibernate();
+	void finishHibernate(bool isCloseInput);
+	void resume();
+
     bool isDecoderRunning() const;
 
 	void setSeekTime(float sec);
 	
-	double getVideoFrame(void** frameData);
+	bool leaseVideoFrame(double time, NativeVideoLease& lease);
+	bool releaseVideoFrame(int64_t handle);
 	double getAudioFrame(uint8_t** outputFrame, int& frameSize);
-	void freeVideoFrame();
+	double getAudioPlanes(uint8_t** planes, int maxPlanes, NativeAudioLayout& layout);
 	void freeAudioFrame();
 	void setVideoEnable(bool isEnable);
 	void setAudioEnable(bool isEnable);
@@ -40,12 +50,48 @@ public:
 	bool isVideoBufferFull();
 
 	int getMetaData(char**& key, char**& value);
+	IDecoder::StartupTimings getStartupTimings();
+	int64_t getMemoryUsage();
+	DecoderStats* getStats();
+	void setPriority(int priority);
+	void setMaxFrameRate(double frameRate);
+	double updateLiveClock(double hostTime);
+	bool getLiveLatency(double& latency, double& rate);
+
+	//	The ring is created on first enable and lives as long as the handler. While it is enabled the decode thread
+	//	moves decoded audio into it, so the host reads audio with fillAudioRing instead of getAudioFrame.
+	//	The ring holds interleaved floats and is only available with AUDIO_OUTPUT_FLT.
+	bool setAudioRingEnable(bool isEnable, int capacityMs);
+	int fillAudioRing(float* output, int frameCount, int channels);
+	int64_t getAudioRingUnderruns();
+	void resetAudioRingUnderruns();
+	double getAudioRingTime();
 
 private:
-	DecoderState mDecoderState;
+	void pumpAudioRing();
+	void flushAudioRing(int channels);
+
+	std::atomic<DecoderState> mDecoderState;
 	std::unique_ptr<IDecoder> mIDecoder;
 	double mSeekTime;
+	double mResumeTime;
+
+	//	From hibernate until resume is done the decoder streams are not touched by stream toggles, the wanted state
+	//	is kept here and applied by resume.
+	std::mutex mStreamToggleMutex;
+	bool mIsStreamReopening;
+	bool mIsVideoWanted;
+	bool mIsAudioWanted;
 	
 	std::thread mDecodeThread;
     bool mDecodeThreadRunning = false;
+
+	std::unique_ptr<AudioRing> mAudioRing;
+	std::atomic<bool> mIsAudioRingEnabled;
+	std::atomic<bool> mIsAudioRingFlushPending;
+	int mAudioRingOffset;				//	Decode thread only, frames of the front audio frame already in the ring.
+	double mAudioRingFrameTime;
+	std::mutex mAudioRingClockMutex;	//	Decode and main thread, the host audio thread never takes it.
+	double mAudioRingEndTime;			//	Media time at the write end of the ring, -1 after a flush.
+	int mAudioRingSampleRate;
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "AudioRing.h"
+#include <algorithm>
+#include <string.h>
+
+namespace {
+	const int CHANNEL_BITS = 8;
+	const int64_t CHANNEL_MASK = (1 << CHANNEL_BITS) - 1;
+
+	//	Copies count samples between the ring and a linear buffer, split in two at the end of the ring.
+	void copyFromRing(const float* ring, int64_t capacity, int64_t position, float* output, int64_t count) {
+		int64_t start = position % capacity;
+		int64_t first = std::min(count, capacity - start);
+		memcpy(output, ring + start, first * sizeof(float));
+		memcpy(output + first, ring, (count - first) * sizeof(float));
+	}
+
+	void copyToRing(float* ring, int64_t capacity, int64_t position, const float* input, int64_t count) {
+		int64_t start = position % capacity;
+		int64_t first = std::min(count, capacity - start);
+		memcpy(ring + start, input, first * sizeof(float));
+		memcpy(ring, input + first, (count - first) * sizeof(float));
+	}
+}
+
+AudioRing::AudioRing(int channels, int capacityFrames) :
+	mCapacity((int64_t)std::max(channels, 1) * std::max(capacityFrames, 1)) {
+	mSamples.reset(new float[(size_t)mCapacity]);
+	mWritePosition = 0;
+	mReadPosition = 0;
+	mFlush = std::max(1, std::min(channels, (int)CHANNEL_MASK));
+	mUnderruns = 0;
+	mFlushSeen = -1;
+	mIsPrimed = false;
+	mIsUnderrun = false;
+}
+
+int64_t AudioRing::getUsedSamples(int64_t writePosition) const {
+	int64_t readPosition = std::max(mReadPosition.load(std::memory_order_acquire), mFlush.load(std::memory_order_relaxed) >> CHANNEL_BITS);
+	return std::max<int64_t>(writePosition - readPosition, 0);
+}
+
+int AudioRing::getFreeFrames() const {
+	int64_t writePosition = mWritePosition.load(std::memory_order_relaxed);
+	return (int)((mCapacity - getUsedSamples(writePosition)) / getChannels());
+}
+
+int AudioRing::write(const float* samples, int frameCount) {
+	int channels = getChannels();
+	int64_t writePosition = mWritePosition.load(std::memory_order_relaxed);
+	int64_t freeFrames = (mCapacity - getUsedSamples(writePosition)) / channels;
+	int frames = (int)std::min<int64_t>(frameCount, freeFrames);
+	if (frames <= 0) {
+		return 0;
+	}
+
+	copyToRing(mSamples.get(), mCapacity, writePosition, samples, (int64_t)frames * channels);
+	mWritePosition.store(writePosition + (int64_t)frames * channels, std::memory_order_release);
+	return frames;
+}
+
+void AudioRing::setChannels(int channels) {
+	channels = std::max(1, std::min(channels, (int)CHANNEL_MASK));
+	mFlush.store(mWritePosition.load(std::memory_order_relaxed) << CHANNEL_BITS | channels, std::memory_order_release);
+}
+
+int AudioRing::getChannels() const {
+	return (int)(mFlush.load(std::memory_order_relaxed) & CHANNEL_MASK);
+}
+
+int AudioRing::getBufferedFrames() const {
+	return (int)(getUsedSamples(mWritePosition.load(std::memory_order_acquire)) / getChannels());
+}
+
+void AudioRing::flush() {
+	setChannels(getChannels());
+}
+
+int AudioRing::read(float* output, int frameCount, int outChannels) {
+	if (output == nullptr || frameCount <= 0 || outChannels <= 0) {
+		return 0;
+	}
+
+	//	The write position is loaded first: any flush that precedes the samples it publishes is seen below.
+	int64_t writePosition = mWritePosition.load(std::memory_order_acquire);
+	int64_t flush = mFlush.load(std::memory_order_acquire);
+	int channels = (int)(flush & CHANNEL_MASK);
+	int64_t readPosition = std::max(mReadPosition.load(std::memory_order_relaxed), flush >> CHANNEL_BITS);
+	if (flush != mFlushSeen) {
+		mFlushSeen = flush;
+		mIsPrimed = false;
+		mIsUnderrun = false;
+	}
+
+	int64_t available = std::max<int64_t>(writePosition - readPosition, 0) / channels;
+	int frames = (int)std::min<int64_t>(frameCount, available);
+	if (channels == outChannels) {
+		copyFromRing(mSamples.get(), mCapacity, readPosition, output, (int64_t)frames * channels);
+	} else {
+		//	Extra host channels are silent, extra source channels are dropped.
+		int copied = std::min(channels, outChannels);
+		const float* ring = mSamples.get();
+		int64_t index = readPosition % mCapacity;
+		for (int i = 0; i < frames; i++) {
+			float* outFrame = output + (int64_t)i * outChannels;
+			for (int c = 0; c < channels; c++) {
+				if (c < copied) {
+					outFrame[c] = ring[index];
+				}
+				index = index + 1 == mCapacity ? 0 : index + 1;
+			}
+			for (int c = copied; c < outChannels; c++) {
+				outFrame[c] = 0.0f;
+			}
+		}
+	}
+	mReadPosition.store(readPosition + (int64_t)frames * channels, std::memory_order_release);
+
+	if (frames < frameCount) {
+		memset(output + (int64_t)frames * outChannels, 0, (size_t)(frameCount - frames) * outChannels * sizeof(float));
+	}
+
+	if (frames > 0) {
+		mIsPrimed = true;
+	}
+	if (frames == frameCount) {
+		mIsUnderrun = false;
+	} else if (mIsPrimed && !mIsUnderrun) {
+		mUnderruns.fetch_add(1, std::memory_order_relaxed);
+		mIsUnderrun = true;
+	}
+
+	return frames;
+}
+
+int64_t AudioRing::getUnderruns() const {
+	return mUnderruns.load(std::memory_order_relaxed);
+}
+
+void AudioRing::resetUnderruns() {
+	mUnderruns.store(0, std::memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+//	Single producer single consumer ring of interleaved float samples. The decode thread writes, the host audio
+//	thread reads. Both sides are wait free: no lock, no allocation and no loop that waits on the other side.
+//	Positions are running sample counts, so a flush is a forward jump of the read position instead of a reset.
+class AudioRing {
+public:
+	AudioRing(int channels, int capacityFrames);
+
+	//	Producer side. A channel change flushes, the capacity in frames shrinks when the channel count grows.
+	int getFreeFrames() const;
+	int write(const float* samples, int frameCount);
+	void setChannels(int channels);
+	int getChannels() const;
+	void flush();
+
+	//	Any thread, frames written and not read yet.
+	int getBufferedFrames() const;
+
+	//	Consumer side. Fills exactly frameCount frames of outChannels interleaved samples, pads the rest with
+	//	silence and returns the number of frames taken from the ring.
+	int read(float* output, int frameCount, int outChannels);
+
+	int64_t getUnderruns() const;
+	void resetUnderruns();
+
+private:
+	int64_t getUsedSamples(int64_t writePosition) const;
+
+	std::unique_ptr<float[]> mSamples;
+	const int64_t mCapacity;
+	std::atomic<int64_t> mWritePosition;
+	std::atomic<int64_t> mReadPosition;
+	std::atomic<int64_t> mFlush;			//	Flush position << 8 | channels, one word so the consumer sees both together.
+	std::atomic<int64_t> mUnderruns;
+
+	//	Consumer only.
+	int64_t mFlushSeen;
+	bool mIsPrimed;							//	Nothing is counted before the first samples after a flush.
+	bool mIsUnderrun;						//	An underrun is counted once until the ring fills a request again.
+};
\ No newline at end of file
@@ -0,0 +1,1628 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+//	Offline benchmark of the native decoder, one JSON object per line on stdout.
+//	Usage: ffmpegdecoder_Benchmark <mode> [options]
+//		convert [--frames N] [--tolerance N]	YUV to RGB kernels against swscale.
+//		slices [--frames N]						Sliced conversion time by thread count at 1080p, 1440p and 4K.
+//		decode [--media DIR] [--duration S] [--clip NAME]
+//												Decode synthetic clips through the native API. Clips are generated into DIR on first use.
+//		soak [--decoders N] [--seconds S] [--tick-hz N] [--seek-interval S] [--lifetime S] [--sample-interval S] [--seed N]
+//												Many concurrent decoders driven by a simulated host tick, with seeks and scheduled destroys.
+//		threads [--decoders N] [--clip NAME] [--duration S] [--budget N]
+//												Aggregate decode throughput of N decoders with the codec thread budget against threads=auto per decoder.
+//		live [--clip NAME] [--port N] [--target-ms N] [--seconds S] [--stall-at S] [--stall S]
+//												Latency behind a local HTTP live stand-in with a stall, default against live mode.
+//		audio [--clip NAME] [--duration S]		Bytes handed to the host per audio second for every audio output format.
+//		mmap [--clip NAME] [--duration S] [--decoders N]
+//												Read syscalls and demux time of N decoders on one file, mapped input against the file protocol.
+//		cap [--clip NAME] [--duration S] [--decoders N]
+//												CPU and frames handed out with no frame-rate cap, at 30 and at 15, audio has to match.
+//		open [--clip NAME] [--decoders N] [--visible N] [--concurrency N]
+//												Time to ready of N background opens and a few high priority ones posted after them,
+//												bounded open executor against one open per thread.
+//		stall [--port N] [--timeout-ms N] [--bound-ms N]
+//												Opens against a local listener that accepts and never replies. The open timeout has to fail the
+//												open, and destroy and clean all have to return, within bound-ms.
+//		resume [--clip NAME] [--decoders N] [--cycles N]
+//												Hibernate, then resume to the first frame, with the input kept and closed. Hibernate has to
+//												return without waiting for the release.
+//	Exit code is non zero when a correctness check fails.
+
+#include "ViveMediaDecoder.h"
+#include "BenchmarkMedia.h"
+#include "ColorConvert.h"
+#include "SliceWorkerPool.h"
+#include "VideoConverter.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <float.h>
+#include <fstream>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+static const char* getOption(int argc, char** argv, const char* name, const char* defaultValue) {
+	for (int i = 2; i + 1 < argc; i++) {
+		if (strcmp(argv[i], name) == 0) {
+			return argv[i + 1];
+		}
+	}
+	return defaultValue;
+}
+
+static double nowMs() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void sleepMs(int ms) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+//	Peak resident memory of the whole process so far.
+static int64_t getPeakRssKb() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return (int64_t)counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return (int64_t)usage.ru_maxrss / 1024;
+#else
+	return (int64_t)usage.ru_maxrss;
+#endif
+#endif
+}
+
+static int64_t getCurrentRssKb() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return (int64_t)counters.WorkingSetSize / 1024;
+#else
+	std::ifstream statm("/proc/self/statm");
+	int64_t pages = 0, residentPages = 0;
+	if (!(statm >> pages >> residentPages)) {
+		return getPeakRssKb();
+	}
+	return residentPages * (sysconf(_SC_PAGESIZE) / 1024);
+#endif
+}
+
+//	User plus system CPU time of the process in seconds.
+static double getCpuSeconds() {
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernel, &user);
+	auto toSeconds = [](const FILETIME& time) { return (((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) / 1e7; };
+	return toSeconds(kernel) + toSeconds(user);
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+static int getThreadCount() {
+#ifdef _WIN32
+	int count = 0;
+	DWORD processId = GetCurrentProcessId();
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+	THREADENTRY32 entry;
+	entry.dwSize = sizeof(entry);
+	if (snapshot != INVALID_HANDLE_VALUE && Thread32First(snapshot, &entry)) {
+		do {
+			count += entry.th32OwnerProcessID == processId ? 1 : 0;
+		} while (Thread32Next(snapshot, &entry));
+	}
+	CloseHandle(snapshot);
+	return count;
+#else
+	std::ifstream status("/proc/self/status");
+	std::string key;
+	while (status >> key) {
+		if (key == "Threads:") {
+			int count = 0;
+			status >> count;
+			return count;
+		}
+	}
+	return -1;
+#endif
+}
+
+//	Read calls issued by the process so far, -1 when the platform does not report them.
+static int64_t getReadOperationCount() {
+#ifdef _WIN32
+	IO_COUNTERS counters;
+	return GetProcessIoCounters(GetCurrentProcess(), &counters) ? (int64_t)counters.ReadOperationCount : -1;
+#else
+	std::ifstream io("/proc/self/io");
+	std::string key;
+	while (io >> key) {
+		if (key == "syscr:") {
+			int64_t count = -1;
+			io >> count;
+			return count;
+		}
+	}
+	return -1;
+#endif
+}
+
+//	Synthetic frame with smooth gradients, so nearest and interpolated chroma upsampling stay comparable.
+struct YUVImage {
+	int width;
+	int height;
+	std::vector<uint8_t> y;
+	std::vector<uint8_t> u;
+	std::vector<uint8_t> v;
+	std::vector<uint8_t> uv;
+
+	YUVImage(int w, int h) : width(w), height(h), y(w * h), u((w / 2) * (h / 2)), v((w / 2) * (h / 2)), uv(w * (h / 2)) {
+		for (int row = 0; row < h; row++) {
+			for (int col = 0; col < w; col++) {
+				y[row * w + col] = (uint8_t)(16 + (col * 219 / w + row * 37 / h) % 220);
+			}
+		}
+		for (int row = 0; row < h / 2; row++) {
+			for (int col = 0; col < w / 2; col++) {
+				uint8_t cb = (uint8_t)(16 + col * 224 / (w / 2));
+				uint8_t cr = (uint8_t)(240 - row * 224 / (h / 2));
+				u[row * (w / 2) + col] = cb;
+				v[row * (w / 2) + col] = cr;
+				uv[row * w + col * 2] = cb;
+				uv[row * w + col * 2 + 1] = cr;
+			}
+		}
+	}
+};
+
+static void getPlanes(const YUVImage& image, bool isNV12, const uint8_t* planes[3], int strides[3]) {
+	planes[0] = image.y.data();
+	strides[0] = image.width;
+	if (isNV12) {
+		planes[1] = image.uv.data();
+		planes[2] = nullptr;
+		strides[1] = image.width;
+		strides[2] = 0;
+	} else {
+		planes[1] = image.u.data();
+		planes[2] = image.v.data();
+		strides[1] = image.width / 2;
+		strides[2] = image.width / 2;
+	}
+}
+
+//	Reference output through swscale with the same matrix and range, and the time per frame it took.
+static double convertWithSwscale(const YUVImage& image, bool isNV12, bool isRGBA, ColorConvert::Matrix matrix, bool isFullRange,
+	int frames, std::vector<uint8_t>& output) {
+	AVPixelFormat srcFormat = isNV12 ? AV_PIX_FMT_NV12 : AV_PIX_FMT_YUV420P;
+	AVPixelFormat dstFormat = isRGBA ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
+	SwsContext* context = sws_getContext(image.width, image.height, srcFormat, image.width, image.height, dstFormat,
+		SWS_POINT | SWS_ACCURATE_RND | SWS_FULL_CHR_H_INT, nullptr, nullptr, nullptr);
+	if (context == nullptr) {
+		return -1.0;
+	}
+
+	int colorspace = matrix == ColorConvert::BT709 ? SWS_CS_ITU709 : SWS_CS_ITU601;
+	sws_setColorspaceDetails(context, sws_getCoefficients(colorspace), isFullRange ? 1 : 0, sws_getCoefficients(SWS_CS_DEFAULT), 1, 0, 1 << 16, 1 << 16);
+
+	const uint8_t* planes[3];
+	int strides[3];
+	getPlanes(image, isNV12, planes, strides);
+	int dstStride = image.width * (isRGBA ? 4 : 3);
+	uint8_t* dst[4] = { output.data(), nullptr, nullptr, nullptr };
+	int dstStrides[4] = { dstStride, 0, 0, 0 };
+
+	double start = nowMs();
+	for (int i = 0; i < frames; i++) {
+		sws_scale(context, planes, strides, 0, image.height, dst, dstStrides);
+	}
+	double elapsed = (nowMs() - start) / frames;
+
+	sws_freeContext(context);
+	return elapsed;
+}
+
+static int getMaxDiff(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, bool isRGBA) {
+	int maxDiff = 0;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (isRGBA && i % 4 == 3) {
+			continue;
+		}
+		int diff = abs((int)a[i] - (int)b[i]);
+		maxDiff = diff > maxDiff ? diff : maxDiff;
+	}
+	return maxDiff;
+}
+
+static int runConvert(int argc, char** argv) {
+	int frames = atoi(getOption(argc, argv, "--frames", "50"));
+	int tolerance = atoi(getOption(argc, argv, "--tolerance", "4"));
+	const int sizes[][2] = { { 1280, 720 }, { 1920, 1080 } };
+	const ColorConvert::Kernel kernels[] = { ColorConvert::C, ColorConvert::SSE2, ColorConvert::AVX2, ColorConvert::NEON };
+	int failures = 0;
+
+	for (const auto& size : sizes) {
+		YUVImage image(size[0], size[1]);
+		for (int format = 0; format < 4; format++) {
+			bool isNV12 = (format & 1) != 0;
+			bool isRGBA = (format & 2) != 0;
+			for (int variant = 0; variant < 4; variant++) {
+				ColorConvert::Matrix matrix = (variant & 1) ? ColorConvert::BT709 : ColorConvert::BT601;
+				bool isFullRange = (variant & 2) != 0;
+				ColorConvert::Coefficients coef = ColorConvert::getCoefficients(matrix, isFullRange);
+				const char* label = isNV12 ? "nv12" : "yuv420p";
+				const char* dstLabel = isRGBA ? "rgba" : "rgb24";
+				const char* matrixLabel = matrix == ColorConvert::BT709 ? "bt709" : "bt601";
+				const char* rangeLabel = isFullRange ? "full" : "limited";
+
+				size_t outputSize = (size_t)image.width * image.height * (isRGBA ? 4 : 3);
+				std::vector<uint8_t> reference(outputSize);
+				std::vector<uint8_t> referenceC(outputSize);
+				std::vector<uint8_t> output(outputSize);
+				double swsMs = convertWithSwscale(image, isNV12, isRGBA, matrix, isFullRange, frames, reference);
+				printf("{\"mode\":\"convert\",\"kernel\":\"swscale\",\"width\":%d,\"height\":%d,\"src\":\"%s\",\"dst\":\"%s\",\"matrix\":\"%s\",\"range\":\"%s\",\"ms_per_frame\":%.3f}\n",
+					image.width, image.height, label, dstLabel, matrixLabel, rangeLabel, swsMs);
+
+				const uint8_t* planes[3];
+				int strides[3];
+				getPlanes(image, isNV12, planes, strides);
+				int dstStride = image.width * (isRGBA ? 4 : 3);
+
+				for (ColorConvert::Kernel kernel : kernels) {
+					if (!ColorConvert::setKernel(kernel)) {
+						continue;
+					}
+
+					std::vector<uint8_t>& target = kernel == ColorConvert::C ? referenceC : output;
+					double start = nowMs();
+					for (int i = 0; i < frames; i++) {
+						ColorConvert::convert(isNV12 ? ColorConvert::NV12 : ColorConvert::YUV420P, isRGBA ? ColorConvert::RGBA : ColorConvert::RGB24,
+							coef, planes, strides, target.data(), dstStride, image.width, 0, image.height);
+					}
+					double elapsed = (nowMs() - start) / frames;
+
+					int maxDiff = swsMs < 0.0 ? -1 : getMaxDiff(target, reference, isRGBA);
+					bool isBitExact = kernel == ColorConvert::C || target == referenceC;
+					bool isPassed = isBitExact && maxDiff <= tolerance;
+					failures += isPassed ? 0 : 1;
+
+					printf("{\"mode\":\"convert\",\"kernel\":\"%s\",\"width\":%d,\"height\":%d,\"src\":\"%s\",\"dst\":\"%s\",\"matrix\":\"%s\",\"range\":\"%s\","
+						"\"ms_per_frame\":%.3f,\"max_diff_vs_swscale\":%d,\"bit_exact_vs_c\":%s,\"pass\":%s}\n",
+						ColorConvert::getKernelName(kernel), image.width, image.height, label, dstLabel, matrixLabel, rangeLabel,
+						elapsed, maxDiff, isBitExact ? "true" : "false", isPassed ? "true" : "false");
+				}
+				ColorConvert::setKernel(ColorConvert::AUTO);
+			}
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
+
+static void fillFrame(AVFrame* frame, const YUVImage& image) {
+	for (int row = 0; row < image.height; row++) {
+		memcpy(frame->data[0] + row * frame->linesize[0], image.y.data() + row * image.width, image.width);
+	}
+	for (int row = 0; row < image.height / 2; row++) {
+		memcpy(frame->data[1] + row * frame->linesize[1], image.u.data() + row * (image.width / 2), image.width / 2);
+		memcpy(frame->data[2] + row * frame->linesize[2], image.v.data() + row * (image.width / 2), image.width / 2);
+	}
+}
+
+//	Every frame is sliced here, the thread count includes the calling thread.
+static int runSlices(int argc, char** argv) {
+	int frames = atoi(getOption(argc, argv, "--frames", "30"));
+	const int sizes[][2] = { { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+	int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	for (const auto& size : sizes) {
+		YUVImage image(size[0], size[1]);
+		AVFrame* srcFrame = av_frame_alloc();
+		srcFrame->format = AV_PIX_FMT_YUV420P;
+		srcFrame->width = image.width;
+		srcFrame->height = image.height;
+		srcFrame->colorspace = AVCOL_SPC_BT709;
+		av_frame_get_buffer(srcFrame, 32);
+		fillFrame(srcFrame, image);
+
+		AVFrame* dstFrame = av_frame_alloc();
+		dstFrame->format = AV_PIX_FMT_RGB24;
+		dstFrame->width = image.width;
+		dstFrame->height = image.height;
+		av_frame_get_buffer(dstFrame, 32);
+
+		for (int path = 0; path < 2; path++) {
+			bool isKernel = path == 0;
+			for (int threads : threadCounts) {
+				SliceWorkerPool::instance()->setThreadCount(threads - 1);
+				VideoConverter converter;
+				converter.setSliceThreshold(0);
+				converter.setKernelEnabled(isKernel);
+				converter.convert(srcFrame, dstFrame, AV_PIX_FMT_RGB24);
+
+				double start = nowMs();
+				for (int i = 0; i < frames; i++) {
+					converter.convert(srcFrame, dstFrame, AV_PIX_FMT_RGB24);
+				}
+				double elapsed = (nowMs() - start) / frames;
+
+				printf("{\"mode\":\"slices\",\"path\":\"%s\",\"width\":%d,\"height\":%d,\"threads\":%d,\"ms_per_frame\":%.3f}\n",
+					isKernel ? ColorConvert::getKernelName(ColorConvert::getKernel()) : "swscale", image.width, image.height, threads, elapsed);
+			}
+		}
+
+		av_frame_free(&srcFrame);
+		av_frame_free(&dstFrame);
+	}
+
+	return 0;
+}
+
+//	Wait for the async init the way the engine polls it. Returns false on failure or timeout.
+static bool waitInitialized(int id, int timeoutMs) {
+	double start = nowMs();
+	while (nowMs() - start < timeoutMs) {
+		int state = nativeGetDecoderState(id);
+		if (state >= 1) {
+			return true;
+		} else if (state < 0) {
+			return false;
+		}
+		sleepMs(1);
+	}
+	return false;
+}
+
+//	Grab and release whatever is due, returns true when a video frame was presented or, without video, an audio frame was pulled.
+static bool pullFrames(int id, bool hasVideo, bool hasAudio, int& videoFrames, int& audioFrames) {
+	bool isPresented = false;
+	if (hasVideo) {
+		void* frameData = nullptr;
+		bool isFrameReady = false;
+		nativeSetVideoTime(id, FLT_MAX);
+		nativeGrabVideoFrame(id, &frameData, isFrameReady);
+		if (isFrameReady) {
+			nativeReleaseVideoFrame(id);
+			videoFrames++;
+			isPresented = true;
+		}
+	}
+
+	if (hasAudio) {
+		unsigned char* audioData = nullptr;
+		int frameSize = 0;
+		while (nativeGetAudioData(id, &audioData, frameSize) != -1.0f) {
+			nativeFreeAudioData(id);
+			audioFrames++;
+			isPresented = isPresented || !hasVideo;
+		}
+	}
+	return isPresented;
+}
+
+static int runDecode(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	double duration = atof(getOption(argc, argv, "--duration", "5"));
+	std::string clipFilter = getOption(argc, argv, "--clip", "");
+	const int timeoutMs = 120000;
+	int failures = 0;
+
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (!clipFilter.empty() && spec.name.find(clipFilter) == std::string::npos) {
+			continue;
+		}
+
+		std::string path = prepareClip(spec, mediaDirectory, duration);
+		if (path.empty()) {
+			printf("{\"mode\":\"decode\",\"clip\":\"%s\",\"error\":\"clip generation failed\"}\n", spec.name.c_str());
+			failures++;
+			continue;
+		}
+
+		double createTime = nowMs();
+		int id = -1;
+		nativeCreateDecoderAsync(path.c_str(), id);
+		if (!waitInitialized(id, timeoutMs)) {
+			printf("{\"mode\":\"decode\",\"clip\":\"%s\",\"error\":\"init failed\"}\n", spec.name.c_str());
+			nativeDestroyDecoder(id);
+			failures++;
+			continue;
+		}
+
+		int width = 0, height = 0;
+		float totalTime = 0.0f;
+		nativeGetVideoFormat(id, width, height, totalTime);
+		bool hasVideo = nativeIsVideoEnabled(id);
+		bool hasAudio = nativeIsAudioEnabled(id);
+		if (!hasVideo) {
+			int channels = 0, frequency = 0;
+			nativeGetAudioFormat(id, channels, frequency, totalTime);
+		}
+		nativeStartDecoding(id);
+
+		//	Present as fast as possible until the end of the clip.
+		int videoFrames = 0, audioFrames = 0;
+		double firstFrameMs = -1.0;
+		double decodeStart = nowMs();
+		while (nowMs() - decodeStart < timeoutMs) {
+			if (pullFrames(id, hasVideo, hasAudio, videoFrames, audioFrames) && firstFrameMs < 0.0) {
+				firstFrameMs = nowMs() - createTime;
+			}
+			if (nativeIsEOF(id) && (!hasVideo || nativeIsVideoBufferEmpty(id))) {
+				pullFrames(id, hasVideo, hasAudio, videoFrames, audioFrames);
+				break;
+			}
+			std::this_thread::yield();
+		}
+		double decodeSeconds = (nowMs() - decodeStart) / 1000.0;
+
+		//	Seek latency is measured up to the first frame presented after the seek.
+		double seekTotal = 0.0, seekMax = 0.0;
+		int seekCount = 0;
+		const float seekPoints[] = { 0.75f, 0.25f, 0.5f };
+		for (float point : seekPoints) {
+			double seekStart = nowMs();
+			nativeSetSeekTime(id, totalTime * point);
+			int unusedVideo = 0, unusedAudio = 0;
+			bool isPresented = false;
+			while (!isPresented && nowMs() - seekStart < timeoutMs) {
+				isPresented = nativeIsSeekOver(id) && pullFrames(id, hasVideo, hasAudio, unusedVideo, unusedAudio);
+				std::this_thread::yield();
+			}
+			if (isPresented) {
+				double latency = nowMs() - seekStart;
+				seekTotal += latency;
+				seekMax = std::max(seekMax, latency);
+				seekCount++;
+			}
+		}
+		NativeDecoderStats stats;
+		memset(&stats, 0, sizeof(stats));
+		nativeGetDecoderStats(id, stats);
+		nativeDestroyDecoder(id);
+
+		double convertMs = stats.conversionTime.count > 0 ? stats.conversionTime.sumUs / 1000.0 / stats.conversionTime.count : -1.0;
+		int presented = hasVideo ? videoFrames : audioFrames;
+		printf("{\"mode\":\"decode\",\"clip\":\"%s\",\"width\":%d,\"height\":%d,\"frame_rate\":%d,\"audio_channels\":%d,"
+			"\"video_frames\":%d,\"audio_frames\":%d,\"decode_fps\":%.2f,\"convert_ms_per_frame\":%.3f,\"time_to_first_frame_ms\":%.2f,"
+			"\"seek_latency_ms\":%.2f,\"seek_latency_max_ms\":%.2f,\"underruns\":%lld,\"video_queue_target\":%d,\"video_queue_peak\":%d,"
+			"\"audio_queue_target\":%d,\"audio_queue_peak\":%d,\"peak_rss_kb\":%lld}\n",
+			spec.name.c_str(), width, height, spec.frameRate, spec.channels, videoFrames, audioFrames,
+			decodeSeconds > 0.0 ? presented / decodeSeconds : 0.0, convertMs, firstFrameMs,
+			seekCount > 0 ? seekTotal / seekCount : -1.0, seekCount > 0 ? seekMax : -1.0, (long long)stats.bufferUnderruns,
+			stats.videoQueueTarget, stats.videoQueuePeak, stats.audioQueueTarget, stats.audioQueuePeak, (long long)getPeakRssKb());
+		fflush(stdout);
+
+		if (presented == 0 || seekCount == 0) {
+			failures++;
+		}
+	}
+
+	nativeCleanAll();
+	return failures == 0 ? 0 : 1;
+}
+
+//	One decoder of the soak scene. Playback follows a wall clock like the host does, restarted by seeks and loops.
+struct SoakDecoder {
+	int slot;
+	int id;
+	const ClipSpec* spec;
+	std::string path;
+	bool isPlaying;
+	bool hasVideo;
+	bool hasAudio;
+	float totalTime;
+	double createMs;
+	double segmentOriginMs;		//	Wall time at which the current segment started playing.
+	double segmentStart;		//	Media time the current segment started from.
+	int64_t expectedFrames;		//	Frames due in finished segments.
+	int presentedFrames;
+	int lateFrames;				//	Ticks on which a frame was due but not decoded yet.
+	int seeks;
+	double nextSeekMs;
+	double destroyMs;
+};
+
+static double getSegmentPosition(const SoakDecoder& decoder, double now) {
+	return std::min((double)decoder.totalTime, decoder.segmentStart + (now - decoder.segmentOriginMs) / 1000.0);
+}
+
+static void startSegment(SoakDecoder& decoder, double now, double mediaTime) {
+	if (decoder.isPlaying) {
+		decoder.expectedFrames += (int64_t)((getSegmentPosition(decoder, now) - decoder.segmentStart) * decoder.spec->frameRate);
+	}
+	decoder.segmentOriginMs = now;
+	decoder.segmentStart = mediaTime;
+}
+
+static void reportSoakDecoder(const SoakDecoder& decoder, double now) {
+	int64_t expected = decoder.expectedFrames;
+	if (decoder.isPlaying) {
+		expected += (int64_t)((getSegmentPosition(decoder, now) - decoder.segmentStart) * decoder.spec->frameRate);
+	}
+	double seconds = (now - decoder.createMs) / 1000.0;
+	printf("{\"mode\":\"soak\",\"event\":\"decoder\",\"slot\":%d,\"clip\":\"%s\",\"seconds\":%.2f,\"presented_fps\":%.2f,\"content_fps\":%d,"
+		"\"presented_frames\":%d,\"dropped_frames\":%lld,\"late_frames\":%d,\"seeks\":%d}\n",
+		decoder.slot, decoder.spec->name.c_str(), seconds, seconds > 0.0 ? decoder.presentedFrames / seconds : 0.0, decoder.spec->frameRate,
+		decoder.presentedFrames, (long long)std::max<int64_t>(0, expected - decoder.presentedFrames), decoder.lateFrames, decoder.seeks);
+}
+
+static int runSoak(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	int decoderCount = atoi(getOption(argc, argv, "--decoders", "16"));
+	double seconds = atof(getOption(argc, argv, "--seconds", "30"));
+	int tickRate = std::max(1, atoi(getOption(argc, argv, "--tick-hz", "60")));
+	double seekInterval = atof(getOption(argc, argv, "--seek-interval", "10"));
+	double lifetime = atof(getOption(argc, argv, "--lifetime", "20"));
+	double sampleInterval = atof(getOption(argc, argv, "--sample-interval", "1"));
+	std::mt19937 random((unsigned int)atoi(getOption(argc, argv, "--seed", "1")));
+
+	//	Video clips only, the scene is about presenting frames.
+	std::vector<ClipSpec> specs;
+	std::vector<std::string> paths;
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (spec.videoCodec == AV_CODEC_ID_NONE) {
+			continue;
+		}
+		std::string path = prepareClip(spec, mediaDirectory, 10.0);
+		if (!path.empty()) {
+			specs.push_back(spec);
+			paths.push_back(path);
+		}
+	}
+	if (specs.empty()) {
+		fprintf(stderr, "No clip could be generated.\n");
+		return 1;
+	}
+
+	//	Exponential intervals around the configured means, <= 0 disables the event.
+	auto drawDelayMs = [&random](double mean) {
+		if (mean <= 0.0) {
+			return DBL_MAX;
+		}
+		return std::exponential_distribution<double>(1.0 / mean)(random) * 1000.0;
+	};
+	auto createDecoder = [&](SoakDecoder& decoder, int slot, double now) {
+		size_t index = (size_t)slot % specs.size();
+		decoder = SoakDecoder();
+		decoder.slot = slot;
+		decoder.spec = &specs[index];
+		decoder.path = paths[index];
+		decoder.createMs = now;
+		decoder.nextSeekMs = now + drawDelayMs(seekInterval);
+		decoder.destroyMs = now + drawDelayMs(lifetime);
+		nativeCreateDecoderAsync(decoder.path.c_str(), decoder.id);
+	};
+
+	double startMs = nowMs();
+	std::vector<SoakDecoder> decoders(decoderCount);
+	for (int i = 0; i < decoderCount; i++) {
+		createDecoder(decoders[i], i, startMs);
+	}
+
+	double startCpu = getCpuSeconds();
+	double lastSampleMs = startMs, lastSampleCpu = startCpu;
+	int peakThreads = 0, failures = 0;
+	int64_t peakRss = 0;
+	double tickMs = 1000.0 / tickRate;
+	double nextTickMs = startMs;
+	while (nowMs() - startMs < seconds * 1000.0) {
+		double now = nowMs();
+		for (SoakDecoder& decoder : decoders) {
+			if (!decoder.isPlaying) {
+				int state = nativeGetDecoderState(decoder.id);
+				if (state < 0) {
+					failures++;
+					nativeScheduleDestroyDecoder(decoder.id);
+					createDecoder(decoder, decoder.slot, now);
+				} else if (state >= 1) {
+					decoder.hasVideo = nativeIsVideoEnabled(decoder.id);
+					decoder.hasAudio = nativeIsAudioEnabled(decoder.id);
+					int width = 0, height = 0;
+					nativeGetVideoFormat(decoder.id, width, height, decoder.totalTime);
+					nativeStartDecoding(decoder.id);
+					startSegment(decoder, now, 0.0);
+					decoder.isPlaying = true;
+				}
+				continue;
+			}
+
+			if (now >= decoder.destroyMs) {
+				reportSoakDecoder(decoder, now);
+				nativeScheduleDestroyDecoder(decoder.id);
+				createDecoder(decoder, decoder.slot, now);
+				continue;
+			}
+
+			if (!nativeIsSeekOver(decoder.id)) {
+				continue;
+			}
+
+			if (now >= decoder.nextSeekMs) {
+				double target = std::uniform_real_distribution<double>(0.0, decoder.totalTime * 0.9)(random);
+				nativeSetSeekTime(decoder.id, (float)target);
+				startSegment(decoder, now, target);
+				decoder.seeks++;
+				decoder.nextSeekMs = now + drawDelayMs(seekInterval);
+				continue;
+			}
+
+			double position = getSegmentPosition(decoder, now);
+			void* frameData = nullptr;
+			bool isFrameReady = false;
+			nativeSetVideoTime(decoder.id, (float)position);
+			nativeGrabVideoFrame(decoder.id, &frameData, isFrameReady);
+			if (isFrameReady) {
+				nativeReleaseVideoFrame(decoder.id);
+				decoder.presentedFrames++;
+			} else if (!nativeIsEOF(decoder.id) && nativeIsVideoBufferEmpty(decoder.id)) {
+				decoder.lateFrames++;
+			}
+
+			if (decoder.hasAudio) {
+				unsigned char* audioData = nullptr;
+				int frameSize = 0;
+				while (nativeGetAudioData(decoder.id, &audioData, frameSize) != -1.0f) {
+					nativeFreeAudioData(decoder.id);
+				}
+			}
+
+			//	Loop at the end like a looping video player.
+			if (nativeIsEOF(decoder.id) && nativeIsVideoBufferEmpty(decoder.id) && position >= decoder.totalTime) {
+				nativeSetSeekTime(decoder.id, 0.0f);
+				startSegment(decoder, now, 0.0);
+			}
+		}
+		nativeCleanDestroyedDecoders();
+
+		if (now - lastSampleMs >= sampleInterval * 1000.0) {
+			double cpu = getCpuSeconds();
+			int threads = getThreadCount();
+			int64_t rss = getCurrentRssKb();
+			int pendingCount = 0;
+			long long pendingBytes = 0;
+			nativeGetPendingTeardowns(pendingCount, pendingBytes);
+			int playing = (int)std::count_if(decoders.begin(), decoders.end(), [](const SoakDecoder& decoder) { return decoder.isPlaying; });
+			printf("{\"mode\":\"soak\",\"event\":\"sample\",\"time_s\":%.2f,\"decoders\":%d,\"playing\":%d,\"cpu_percent\":%.1f,"
+				"\"threads\":%d,\"rss_kb\":%lld,\"pending_teardowns\":%d}\n",
+				(now - startMs) / 1000.0, decoderCount, playing, 100.0 * (cpu - lastSampleCpu) / ((now - lastSampleMs) / 1000.0),
+				threads, (long long)rss, pendingCount);
+			fflush(stdout);
+			peakThreads = std::max(peakThreads, threads);
+			peakRss = std::max(peakRss, rss);
+			lastSampleMs = now;
+			lastSampleCpu = cpu;
+		}
+
+		nextTickMs += tickMs;
+		double sleepTime = nextTickMs - nowMs();
+		if (sleepTime > 0.0) {
+			sleepMs((int)sleepTime);
+		} else {
+			nextTickMs = nowMs();
+		}
+	}
+
+	double endMs = nowMs();
+	for (SoakDecoder& decoder : decoders) {
+		reportSoakDecoder(decoder, endMs);
+	}
+	double cpuSeconds = getCpuSeconds() - startCpu;
+	nativeCleanAll();
+
+	printf("{\"mode\":\"soak\",\"event\":\"summary\",\"decoders\":%d,\"seconds\":%.2f,\"tick_hz\":%d,\"cpu_seconds\":%.2f,"
+		"\"cpu_percent\":%.1f,\"peak_threads\":%d,\"peak_rss_kb\":%lld,\"init_failures\":%d}\n",
+		decoderCount, (endMs - startMs) / 1000.0, tickRate, cpuSeconds, 100.0 * cpuSeconds / ((endMs - startMs) / 1000.0),
+		peakThreads, (long long)std::max(peakRss, getPeakRssKb()), failures);
+	return failures == 0 ? 0 : 1;
+}
+
+//	Decode the same clip with every decoder as fast as possible and report the aggregate throughput.
+static bool runThreadsPass(const std::string& path, int decoderCount, int budget, const char* label) {
+	nativeSetCodecThreadBudget(budget);
+	double startMs = nowMs();
+	double startCpu = getCpuSeconds();
+	std::vector<int> ids;
+	for (int i = 0; i < decoderCount; i++) {
+		int id = -1;
+		nativeCreateDecoderAsync(path.c_str(), id);
+		ids.push_back(id);
+	}
+
+	int failures = 0;
+	for (int id : ids) {
+		if (waitInitialized(id, 120000)) {
+			nativeStartDecoding(id);
+		} else {
+			failures++;
+		}
+	}
+
+	int threadBudget = 0, liveDecoders = 0, allocatedThreads = 0;
+	nativeGetCodecThreadStats(threadBudget, liveDecoders, allocatedThreads);
+
+	int frames = 0, peakThreads = 0;
+	std::vector<bool> isDone(ids.size(), false);
+	size_t doneCount = failures;
+	while (doneCount < ids.size() && nowMs() - startMs < 600000) {
+		for (size_t i = 0; i < ids.size(); i++) {
+			if (isDone[i] || nativeGetDecoderState(ids[i]) < 1) {
+				continue;
+			}
+			int unusedAudio = 0;
+			pullFrames(ids[i], true, false, frames, unusedAudio);
+			if (nativeIsEOF(ids[i]) && nativeIsVideoBufferEmpty(ids[i])) {
+				isDone[i] = true;
+				doneCount++;
+			}
+		}
+		peakThreads = std::max(peakThreads, getThreadCount());
+		std::this_thread::yield();
+	}
+	double seconds = (nowMs() - startMs) / 1000.0;
+	double cpuSeconds = getCpuSeconds() - startCpu;
+
+	for (int id : ids) {
+		nativeDestroyDecoder(id);
+	}
+	nativeCleanAll();
+
+	printf("{\"mode\":\"threads\",\"config\":\"%s\",\"decoders\":%d,\"budget\":%d,\"allocated_threads\":%d,\"frames\":%d,"
+		"\"seconds\":%.2f,\"aggregate_fps\":%.2f,\"cpu_percent\":%.1f,\"peak_threads\":%d,\"init_failures\":%d}\n",
+		label, decoderCount, threadBudget, allocatedThreads, frames, seconds, seconds > 0.0 ? frames / seconds : 0.0,
+		seconds > 0.0 ? 100.0 * cpuSeconds / seconds : 0.0, peakThreads, failures);
+	fflush(stdout);
+	return failures == 0 && frames > 0;
+}
+
+static int runThreads(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	int decoderCount = atoi(getOption(argc, argv, "--decoders", std::to_string(2 * hardwareThreads).c_str()));
+	std::string clipName = getOption(argc, argv, "--clip", "mpeg4_1440p30_video");
+	double duration = atof(getOption(argc, argv, "--duration", "5"));
+	int budget = atoi(getOption(argc, argv, "--budget", "0"));
+
+	std::string path;
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (spec.name == clipName && spec.videoCodec != AV_CODEC_ID_NONE) {
+			path = prepareClip(spec, mediaDirectory, duration);
+		}
+	}
+	if (path.empty()) {
+		printf("{\"mode\":\"threads\",\"clip\":\"%s\",\"error\":\"no such video clip\"}\n", clipName.c_str());
+		return 1;
+	}
+
+	bool isSuccess = runThreadsPass(path, decoderCount, -1, "auto_per_decoder");
+	isSuccess = runThreadsPass(path, decoderCount, budget, "budget") && isSuccess;
+	return isSuccess ? 0 : 1;
+}
+
+//	Local stand-in for a live source, serves a clip as paced MPEG-TS over HTTP and loops it. After stallAt seconds the
+//	sender pauses for stallSeconds and then bursts to catch up, like a congested network. Timestamps are written as
+//	sent, so the media time of a decoded frame is directly comparable with edgeTime, the newest media time sent.
+struct LiveServer {
+	std::thread thread;
+	std::atomic<bool> isStopped{ false };
+	std::atomic<bool> isFailed{ false };
+	std::atomic<bool> isConnected{ false };
+	std::atomic<double> edgeTime{ -1.0 };
+};
+
+static int isLiveServerStopped(void* opaque) {
+	return ((LiveServer*)opaque)->isStopped ? 1 : 0;
+}
+
+static void serveLive(LiveServer* server, const std::string& path, const std::string& url, double stallAt, double stallSeconds) {
+	AVFormatContext* input = nullptr;
+	AVFormatContext* output = nullptr;
+	if (avformat_open_input(&input, path.c_str(), nullptr, nullptr) < 0 || avformat_find_stream_info(input, nullptr) < 0 ||
+		avformat_alloc_output_context2(&output, nullptr, "mpegts", url.c_str()) < 0) {
+		server->isFailed = true;
+		avformat_close_input(&input);
+		return;
+	}
+
+	for (unsigned int i = 0; i < input->nb_streams; i++) {
+		AVStream* stream = avformat_new_stream(output, nullptr);
+		avcodec_parameters_copy(stream->codecpar, input->streams[i]->codecpar);
+		stream->codecpar->codec_tag = 0;
+	}
+
+	//	Blocks until the decoder connects.
+	AVIOInterruptCB interrupt = { isLiveServerStopped, server };
+	AVDictionary* options = nullptr;
+	av_dict_set(&options, "listen", "1", 0);
+	bool isOpen = avio_open2(&output->pb, url.c_str(), AVIO_FLAG_WRITE, &interrupt, &options) >= 0;
+	av_dict_free(&options);
+	server->isConnected = isOpen;
+	av_dict_set(&options, "mpegts_copyts", "1", 0);
+	av_dict_set(&options, "flush_packets", "1", 0);
+	if (!isOpen || avformat_write_header(output, &options) < 0) {
+		server->isFailed = true;
+	}
+	av_dict_free(&options);
+
+	AVPacket packet;
+	av_init_packet(&packet);
+	packet.data = nullptr;
+	packet.size = 0;
+	double startMs = nowMs();
+	double loopOffset = 0.0;
+	bool isStallDone = stallSeconds <= 0.0;
+	while (!server->isFailed && !server->isStopped) {
+		if (av_read_frame(input, &packet) < 0) {
+			loopOffset = server->edgeTime + 0.05;
+			av_seek_frame(input, -1, 0, AVSEEK_FLAG_BACKWARD);
+			continue;
+		}
+
+		AVStream* inStream = input->streams[packet.stream_index];
+		AVStream* outStream = output->streams[packet.stream_index];
+		int64_t startPts = inStream->start_time != AV_NOPTS_VALUE ? inStream->start_time : 0;
+		int64_t shift = (int64_t)(loopOffset / av_q2d(inStream->time_base)) - startPts;
+		if (packet.pts != AV_NOPTS_VALUE) {
+			packet.pts += shift;
+		}
+		if (packet.dts != AV_NOPTS_VALUE) {
+			packet.dts += shift;
+		}
+		double mediaTime = av_q2d(inStream->time_base) * (packet.dts != AV_NOPTS_VALUE ? packet.dts : packet.pts);
+
+		if (!isStallDone && nowMs() - startMs >= stallAt * 1000.0) {
+			sleepMs((int)(stallSeconds * 1000.0));
+			isStallDone = true;
+		}
+		while (!server->isStopped && nowMs() < startMs + mediaTime * 1000.0) {
+			sleepMs(1);
+		}
+
+		av_packet_rescale_ts(&packet, inStream->time_base, outStream->time_base);
+		if (av_interleaved_write_frame(output, &packet) < 0) {
+			break;
+		}
+		server->edgeTime = std::max(server->edgeTime.load(), mediaTime);
+	}
+
+	av_packet_unref(&packet);
+	if (isOpen) {
+		av_write_trailer(output);
+		avio_closep(&output->pb);
+	}
+	avformat_free_context(output);
+	avformat_close_input(&input);
+}
+
+//	One pass against a fresh server. The host is simulated like FFMPEGDecoder.cs: its clock stops while the video queue
+//	is empty and resumes once it reports full, so in the default mode every stall is added to the latency for good.
+static bool runLivePass(const std::string& path, int port, bool isLive, int targetMs, double seconds, double stallAt, double stallSeconds) {
+	const char* label = isLive ? "live" : "default";
+	std::string url = "http://127.0.0.1:" + std::to_string(port) + "/live.ts";
+	LiveServer server;
+	server.thread = std::thread(serveLive, &server, path, url, stallAt, stallSeconds);
+	sleepMs(200);
+
+	NativeDecoderOptions options;
+	nativeGetDefaultDecoderOptions(options);
+	options.liveMode = isLive ? 1 : 0;
+	options.liveTargetDelayMs = targetMs;
+	int id = -1;
+	nativeCreateDecoderWithOptionsAsync(url.c_str(), options, -1.0f, id);
+	bool isInitialized = waitInitialized(id, 30000);
+	if (isInitialized) {
+		nativeStartDecoding(id);
+	}
+
+	bool hasAudio = isInitialized && nativeIsAudioEnabled(id);
+	double hostTime = 0.0, maxLatency = 0.0, lastLatency = -1.0, rate = 1.0;
+	bool isBuffering = true;
+	int videoFrames = 0, audioFrames = 0;
+	double startMs = nowMs(), lastTickMs = startMs, nextSampleMs = startMs + 1000.0;
+	while (isInitialized && nowMs() - startMs < seconds * 1000.0) {
+		double now = nowMs();
+		if (isBuffering) {
+			isBuffering = !(nativeIsVideoBufferFull(id) || nativeIsEOF(id));
+		} else {
+			hostTime += (now - lastTickMs) / 1000.0;
+			nativeSetVideoTime(id, (float)hostTime);
+			void* frameData = nullptr;
+			bool isFrameReady = false;
+			nativeGrabVideoFrame(id, &frameData, isFrameReady);
+			if (isFrameReady) {
+				nativeReleaseVideoFrame(id);
+				videoFrames++;
+			}
+			isBuffering = nativeIsVideoBufferEmpty(id) && !nativeIsEOF(id);
+		}
+		lastTickMs = now;
+
+		unsigned char* audioData = nullptr;
+		int frameSize = 0;
+		while (hasAudio && nativeGetAudioData(id, &audioData, frameSize) != -1.0f) {
+			nativeFreeAudioData(id);
+			audioFrames++;
+		}
+
+		if (now >= nextSampleMs) {
+			float liveLatency = 0.0f, liveRate = 1.0f;
+			if (nativeGetLiveLatency(id, liveLatency, liveRate)) {
+				lastLatency = liveLatency;
+				rate = liveRate;
+			} else {
+				lastLatency = server.edgeTime - hostTime;
+			}
+			maxLatency = std::max(maxLatency, lastLatency);
+			printf("{\"mode\":\"live\",\"config\":\"%s\",\"t\":%.1f,\"latency\":%.3f,\"rate\":%.3f,\"edge\":%.3f,\"buffering\":%s}\n",
+				label, (now - startMs) / 1000.0, lastLatency, rate, server.edgeTime.load(), isBuffering ? "true" : "false");
+			fflush(stdout);
+			nextSampleMs += 1000.0;
+		}
+		sleepMs(16);
+	}
+
+	NativeDecoderStats stats;
+	memset(&stats, 0, sizeof(stats));
+	nativeGetDecoderStats(id, stats);
+	nativeDestroyDecoder(id);
+	nativeCleanAll();
+	server.isStopped = true;
+	server.thread.join();
+
+	printf("{\"mode\":\"live\",\"config\":\"%s\",\"event\":\"summary\",\"target_ms\":%d,\"final_latency\":%.3f,\"max_latency\":%.3f,"
+		"\"video_frames\":%d,\"audio_frames\":%d,\"frames_dropped\":%lld,\"server_failed\":%s}\n",
+		label, targetMs, lastLatency, maxLatency, videoFrames, audioFrames, (long long)stats.videoFramesDropped,
+		server.isFailed ? "true" : "false");
+	fflush(stdout);
+
+	//	Only live mode has to recover from the stall.
+	bool isRecovered = !isLive || (lastLatency >= 0.0 && lastLatency <= targetMs / 1000.0 + 0.5);
+	return isInitialized && !server.isFailed && videoFrames > 0 && isRecovered;
+}
+
+static int runLive(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	std::string clipName = getOption(argc, argv, "--clip", "mpeg2_720p60_mono");
+	int port = atoi(getOption(argc, argv, "--port", "18080"));
+	int targetMs = atoi(getOption(argc, argv, "--target-ms", "500"));
+	double seconds = atof(getOption(argc, argv, "--seconds", "20"));
+	double stallAt = atof(getOption(argc, argv, "--stall-at", "6"));
+	double stallSeconds = atof(getOption(argc, argv, "--stall", "3"));
+
+	std::string path;
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (spec.name == clipName && spec.videoCodec != AV_CODEC_ID_NONE) {
+			path = prepareClip(spec, mediaDirectory, 10.0);
+		}
+	}
+	if (path.empty()) {
+		printf("{\"mode\":\"live\",\"clip\":\"%s\",\"error\":\"no such video clip\"}\n", clipName.c_str());
+		return 1;
+	}
+
+	avformat_network_init();
+	bool isSuccess = runLivePass(path, port, false, targetMs, seconds, stallAt, stallSeconds);
+	isSuccess = runLivePass(path, port + 1, true, targetMs, seconds, stallAt, stallSeconds) && isSuccess;
+	return isSuccess ? 0 : 1;
+}
+
+//	Pull every audio frame of the clip with video disabled. Bytes count the audio in the planes handed to the host,
+//	the queue peak is the deepest audio queue times the average frame size.
+static bool runAudioPass(const std::string& path, int format, bool isAllChannels, const char* label) {
+	NativeDecoderOptions options;
+	nativeGetDefaultDecoderOptions(options);
+	options.audioOutputFormat = format;
+	int id = -1;
+	nativeCreateDecoderWithOptionsAsync(path.c_str(), options, -1.0f, id);
+	if (!waitInitialized(id, 120000) || !nativeIsAudioEnabled(id)) {
+		printf("{\"mode\":\"audio\",\"format\":\"%s\",\"error\":\"init failed\"}\n", label);
+		nativeDestroyDecoder(id);
+		return false;
+	}
+	nativeSetVideoEnable(id, false);
+	nativeSetAudioAllChDataEnable(id, isAllChannels);
+	nativeStartDecoding(id);
+
+	const int maxPlanes = 64;
+	unsigned char* planes[maxPlanes];
+	NativeAudioLayout layout;
+	int64_t bytes = 0, samples = 0;
+	int frames = 0, channels = 0, sampleRate = 0, planeCount = 0, badLayouts = 0;
+	double startMs = nowMs();
+	while (nowMs() - startMs < 120000) {
+		bool isEOF = nativeIsEOF(id);
+		while (nativeGetAudioPlanes(id, planes, maxPlanes, layout) != -1.0f) {
+			bool isPlanar = format == AUDIO_OUTPUT_FLTP;
+			if (layout.sampleFormat != format || layout.planeCount != (isPlanar ? layout.channels : 1) || planes[0] == nullptr) {
+				badLayouts++;
+			}
+			bytes += (int64_t)layout.planeSize * layout.planeCount;
+			samples += layout.samples;
+			channels = layout.channels;
+			sampleRate = layout.sampleRate;
+			planeCount = layout.planeCount;
+			frames++;
+			nativeFreeAudioData(id);
+		}
+		if (isEOF) {
+			break;
+		}
+		std::this_thread::yield();
+	}
+	double seconds = (nowMs() - startMs) / 1000.0;
+
+	NativeDecoderStats stats;
+	memset(&stats, 0, sizeof(stats));
+	nativeGetDecoderStats(id, stats);
+	nativeDestroyDecoder(id);
+
+	double audioSeconds = sampleRate > 0 ? (double)samples / sampleRate : 0.0;
+	printf("{\"mode\":\"audio\",\"format\":\"%s\",\"all_channels\":%s,\"channels\":%d,\"planes\":%d,\"frames\":%d,"
+		"\"audio_seconds\":%.2f,\"bytes_per_audio_second\":%.0f,\"queue_peak_bytes\":%.0f,\"pull_seconds\":%.3f,\"bad_layouts\":%d}\n",
+		label, isAllChannels ? "true" : "false", channels, planeCount, frames, audioSeconds,
+		audioSeconds > 0.0 ? bytes / audioSeconds : 0.0, frames > 0 ? (double)bytes / frames * stats.audioQueuePeak : 0.0,
+		seconds, badLayouts);
+	fflush(stdout);
+	return frames > 0 && badLayouts == 0;
+}
+
+static int runAudio(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	std::string clipName = getOption(argc, argv, "--clip", "mjpeg_1080p24_5.1");
+	double duration = atof(getOption(argc, argv, "--duration", "10"));
+
+	std::string path;
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (spec.name == clipName && spec.audioCodec != AV_CODEC_ID_NONE) {
+			path = prepareClip(spec, mediaDirectory, duration);
+		}
+	}
+	if (path.empty()) {
+		printf("{\"mode\":\"audio\",\"clip\":\"%s\",\"error\":\"no such audio clip\"}\n", clipName.c_str());
+		return 1;
+	}
+
+	const struct { int format; const char* label; } formats[] = {
+		{ AUDIO_OUTPUT_FLT, "flt" }, { AUDIO_OUTPUT_S16, "s16" }, { AUDIO_OUTPUT_FLTP, "fltp" }
+	};
+	bool isSuccess = true;
+	for (bool isAllChannels : { false, true }) {
+		for (const auto& format : formats) {
+			isSuccess = runAudioPass(path, format.format, isAllChannels, format.label) && isSuccess;
+		}
+	}
+	nativeCleanAll();
+	return isSuccess ? 0 : 1;
+}
+
+//	Decode the whole clip with every decoder at once. Read calls cover the process, so the pass with the lower
+//	count and demux time is the input backend doing less work for the same packets.
+static bool runMmapPass(const std::string& path, int decoderCount, bool isMapped) {
+	const char* label = isMapped ? "mapped" : "file";
+	NativeDecoderOptions options;
+	nativeGetDefaultDecoderOptions(options);
+	options.mappedInput = isMapped ? 1 : 0;
+
+	int64_t startReads = getReadOperationCount();
+	double startMs = nowMs();
+	double startCpu = getCpuSeconds();
+	std::vector<int> ids;
+	for (int i = 0; i < decoderCount; i++) {
+		int id = -1;
+		nativeCreateDecoderWithOptionsAsync(path.c_str(), options, -1.0f, id);
+		ids.push_back(id);
+	}
+
+	int failures = 0;
+	for (int id : ids) {
+		if (waitInitialized(id, 120000)) {
+			nativeStartDecoding(id);
+		} else {
+			failures++;
+		}
+	}
+
+	int frames = 0;
+	std::vector<bool> isDone(ids.size(), false);
+	size_t doneCount = failures;
+	while (doneCount < ids.size() && nowMs() - startMs < 600000) {
+		for (size_t i = 0; i < ids.size(); i++) {
+			if (isDone[i] || nativeGetDecoderState(ids[i]) < 1) {
+				continue;
+			}
+			int audioFrames = 0;
+			pullFrames(ids[i], true, true, frames, audioFrames);
+			if (nativeIsEOF(ids[i]) && nativeIsVideoBufferEmpty(ids[i])) {
+				isDone[i] = true;
+				doneCount++;
+			}
+		}
+		std::this_thread::yield();
+	}
+	double seconds = (nowMs() - startMs) / 1000.0;
+	double cpuSeconds = getCpuSeconds() - startCpu;
+	int64_t endReads = getReadOperationCount();
+
+	int64_t demuxUs = 0, packets = 0;
+	for (int id : ids) {
+		NativeDecoderStats stats;
+		memset(&stats, 0, sizeof(stats));
+		if (nativeGetDecoderStats(id, stats)) {
+			demuxUs += stats.demuxTime.sumUs;
+			packets += stats.demuxTime.count;
+		}
+		nativeDestroyDecoder(id);
+	}
+	nativeCleanAll();
+
+	printf("{\"mode\":\"mmap\",\"input\":\"%s\",\"decoders\":%d,\"frames\":%d,\"read_syscalls\":%lld,\"packets\":%lld,"
+		"\"demux_ms\":%.1f,\"demux_us_per_packet\":%.2f,\"cpu_seconds\":%.2f,\"seconds\":%.2f,\"init_failures\":%d}\n",
+		label, decoderCount, frames, startReads >= 0 && endReads >= 0 ? (long long)(endReads - startReads) : -1LL,
+		(long long)packets, demuxUs / 1000.0, packets > 0 ? (double)demuxUs / packets : 0.0, cpuSeconds, seconds, failures);
+	fflush(stdout);
+	return failures == 0 && frames > 0;
+}
+
+static int runMmap(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	std::string clipName = getOption(argc, argv, "--clip", "mjpeg_1080p24_5.1");
+	double duration = atof(getOption(argc, argv, "--duration", "10"));
+	int decoderCount = std::max(1, atoi(getOption(argc, argv, "--decoders", "4")));
+
+	std::string path;
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (spec.name == clipName && spec.videoCodec != AV_CODEC_ID_NONE) {
+			path = prepareClip(spec, mediaDirectory, duration);
+		}
+	}
+	if (path.empty()) {
+		printf("{\"mode\":\"mmap\",\"clip\":\"%s\",\"error\":\"no such video clip\"}\n", clipName.c_str());
+		return 1;
+	}
+
+	bool isSuccess = runMmapPass(path, decoderCount, false);
+	isSuccess = runMmapPass(path, decoderCount, true) && isSuccess;
+	return isSuccess ? 0 : 1;
+}
+
+//	Decode the whole clip with every decoder capped at maxFrameRate, 0 for no cap. Audio is pulled as well,
+//	its frame count has to be the same whatever the cap.
+static bool runCapPass(const std::string& path, int decoderCount, double clipSeconds, float maxFrameRate, int& audioFrames) {
+	double startMs = nowMs();
+	double startCpu = getCpuSeconds();
+	std::vector<int> ids;
+	for (int i = 0; i < decoderCount; i++) {
+		int id = -1;
+		nativeCreateDecoderAsync(path.c_str(), id);
+		nativeSetMaxFrameRate(id, maxFrameRate);
+		ids.push_back(id);
+	}
+
+	int failures = 0;
+	for (int id : ids) {
+		if (waitInitialized(id, 120000)) {
+			nativeStartDecoding(id);
+		} else {
+			failures++;
+		}
+	}
+
+	int frames = 0;
+	audioFrames = 0;
+	std::vector<bool> isDone(ids.size(), false);
+	size_t doneCount = failures;
+	while (doneCount < ids.size() && nowMs() - startMs < 600000) {
+		for (size_t i = 0; i < ids.size(); i++) {
+			if (isDone[i] || nativeGetDecoderState(ids[i]) < 1) {
+				continue;
+			}
+			pullFrames(ids[i], true, true, frames, audioFrames);
+			if (nativeIsEOF(ids[i]) && nativeIsVideoBufferEmpty(ids[i])) {
+				isDone[i] = true;
+				doneCount++;
+			}
+		}
+		std::this_thread::yield();
+	}
+	double seconds = (nowMs() - startMs) / 1000.0;
+	double cpuSeconds = getCpuSeconds() - startCpu;
+
+	int64_t decoded = 0, capped = 0, conversionUs = 0;
+	for (int id : ids) {
+		NativeDecoderStats stats;
+		memset(&stats, 0, sizeof(stats));
+		if (nativeGetDecoderStats(id, stats)) {
+			decoded += stats.videoFramesDecoded;
+			capped += stats.videoFramesCapped;
+			conversionUs += stats.conversionTime.sumUs;
+		}
+		nativeDestroyDecoder(id);
+	}
+	nativeCleanAll();
+
+	double outputFps = clipSeconds > 0.0 && decoderCount > 0 ? frames / clipSeconds / decoderCount : 0.0;
+	bool isOverCap = maxFrameRate > 0.0f && outputFps > maxFrameRate * 1.05;
+	printf("{\"mode\":\"cap\",\"max_fps\":%.1f,\"decoders\":%d,\"frames\":%d,\"output_fps\":%.2f,\"decoded\":%lld,\"capped\":%lld,"
+		"\"audio_frames\":%d,\"conversion_ms\":%.1f,\"cpu_seconds\":%.2f,\"seconds\":%.2f,\"over_cap\":%s,\"init_failures\":%d}\n",
+		maxFrameRate, decoderCount, frames, outputFps, (long long)decoded, (long long)capped, audioFrames, conversionUs / 1000.0,
+		cpuSeconds, seconds, isOverCap ? "true" : "false", failures);
+	fflush(stdout);
+	return failures == 0 && frames > 0 && !isOverCap;
+}
+
+static int runCap(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	std::string clipName = getOption(argc, argv, "--clip", "mpeg2_720p60_mono");
+	double duration = atof(getOption(argc, argv, "--duration", "10"));
+	int decoderCount = std::max(1, atoi(getOption(argc, argv, "--decoders", "4")));
+
+	std::string path;
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (spec.name == clipName && spec.videoCodec != AV_CODEC_ID_NONE) {
+			path = prepareClip(spec, mediaDirectory, duration);
+		}
+	}
+	if (path.empty()) {
+		printf("{\"mode\":\"cap\",\"clip\":\"%s\",\"error\":\"no such video clip\"}\n", clipName.c_str());
+		return 1;
+	}
+
+	int uncappedAudioFrames = 0;
+	bool isSuccess = runCapPass(path, decoderCount, duration, 0.0f, uncappedAudioFrames);
+	for (float maxFrameRate : { 30.0f, 15.0f }) {
+		int audioFrames = 0;
+		isSuccess = runCapPass(path, decoderCount, duration, maxFrameRate, audioFrames) && isSuccess;
+		if (audioFrames != uncappedAudioFrames) {
+			printf("{\"mode\":\"cap\",\"max_fps\":%.1f,\"error\":\"audio frames %d, uncapped %d\"}\n", maxFrameRate, audioFrames, uncappedAudioFrames);
+			isSuccess = false;
+		}
+	}
+	return isSuccess ? 0 : 1;
+}
+
+//	Background decoders are created first at low priority, the visible ones last at high priority, as on a scene load.
+static bool runOpenPass(const std::string& path, int decoderCount, int visibleCount, int concurrency, const char* label) {
+	nativeSetOpenConcurrency(concurrency);
+	nativeResetOpenStats();
+	NativeDecoderOptions options;
+	nativeGetDefaultDecoderOptions(options);
+
+	double startMs = nowMs();
+	std::vector<int> ids;
+	for (int i = 0; i < decoderCount + visibleCount; i++) {
+		options.priority = i < decoderCount ? 0 : 2;
+		int id = -1;
+		nativeCreateDecoderWithOptionsAsync(path.c_str(), options, -1.0f, id);
+		ids.push_back(id);
+	}
+
+	std::vector<double> readyMs(ids.size(), -1.0);
+	size_t doneCount = 0;
+	int failures = 0;
+	while (doneCount < ids.size() && nowMs() - startMs < 120000) {
+		for (size_t i = 0; i < ids.size(); i++) {
+			int state = readyMs[i] < 0 ? nativeGetDecoderState(ids[i]) : 0;
+			if (readyMs[i] < 0 && state != 0) {
+				readyMs[i] = nowMs() - startMs;
+				failures += state < 0 ? 1 : 0;
+				doneCount++;
+			}
+		}
+		sleepMs(1);
+	}
+
+	int concurrencyUsed = 0, queued = 0, running = 0;
+	long long cancelled = 0;
+	NativeHistogram queueWait, openTime;
+	nativeGetOpenStats(concurrencyUsed, queued, running, cancelled, queueWait, openTime);
+	for (int id : ids) {
+		nativeDestroyDecoder(id);
+	}
+	nativeCleanAll();
+
+	double visibleSum = 0.0, visibleMax = 0.0, backgroundSum = 0.0, backgroundMax = 0.0;
+	for (size_t i = 0; i < ids.size(); i++) {
+		bool isVisible = (int)i >= decoderCount;
+		double& sum = isVisible ? visibleSum : backgroundSum;
+		double& maxMs = isVisible ? visibleMax : backgroundMax;
+		sum += readyMs[i];
+		maxMs = std::max(maxMs, readyMs[i]);
+	}
+
+	printf("{\"mode\":\"open\",\"config\":\"%s\",\"concurrency\":%d,\"background\":%d,\"visible\":%d,"
+		"\"visible_ready_ms\":%.1f,\"visible_ready_max_ms\":%.1f,\"background_ready_ms\":%.1f,\"background_ready_max_ms\":%.1f,"
+		"\"queue_wait_ms\":%.1f,\"open_ms\":%.1f,\"opens\":%lld,\"init_failures\":%d,\"timeouts\":%d}\n",
+		label, concurrencyUsed, decoderCount, visibleCount, visibleCount > 0 ? visibleSum / visibleCount : 0.0, visibleMax,
+		decoderCount > 0 ? backgroundSum / decoderCount : 0.0, backgroundMax,
+		queueWait.count > 0 ? queueWait.sumUs / 1000.0 / queueWait.count : 0.0,
+		openTime.count > 0 ? openTime.sumUs / 1000.0 / openTime.count : 0.0,
+		(long long)openTime.count, failures, (int)(ids.size() - doneCount));
+	fflush(stdout);
+	return failures == 0 && doneCount == ids.size();
+}
+
+static int runOpen(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	std::string clipName = getOption(argc, argv, "--clip", "mpeg4_360p30_stereo");
+	int decoderCount = std::max(0, atoi(getOption(argc, argv, "--decoders", "50")));
+	int visibleCount = std::max(1, atoi(getOption(argc, argv, "--visible", "4")));
+	int concurrency = atoi(getOption(argc, argv, "--concurrency", "0"));
+
+	std::string path;
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (spec.name == clipName) {
+			path = prepareClip(spec, mediaDirectory, 5.0);
+		}
+	}
+	if (path.empty()) {
+		printf("{\"mode\":\"open\",\"clip\":\"%s\",\"error\":\"no such clip\"}\n", clipName.c_str());
+		return 1;
+	}
+
+	bool isSuccess = runOpenPass(path, decoderCount, visibleCount, -1, "unbounded");
+	isSuccess = runOpenPass(path, decoderCount, visibleCount, concurrency, "executor") && isSuccess;
+	nativeSetOpenConcurrency(0);
+	return isSuccess ? 0 : 1;
+}
+
+//	Accepts one TCP connection and never sends a byte, like a server that hangs after the handshake.
+static void serveStall(LiveServer* server, const std::string& url) {
+	AVIOInterruptCB interrupt = { isLiveServerStopped, server };
+	AVDictionary* options = nullptr;
+	av_dict_set(&options, "listen", "1", 0);
+	AVIOContext* connection = nullptr;
+	bool isOpen = avio_open2(&connection, url.c_str(), AVIO_FLAG_READ_WRITE, &interrupt, &options) >= 0;
+	av_dict_free(&options);
+	server->isConnected = isOpen;
+	server->isFailed = !isOpen && !server->isStopped;
+
+	while (isOpen && !server->isStopped) {
+		sleepMs(10);
+	}
+	if (isOpen) {
+		avio_closep(&connection);
+	}
+}
+
+//	With a timeout the open has to fail on its own. Without one the decoder stays stuck in the open and is torn down
+//	with nativeDestroyDecoder and nativeCleanAll, or with nativeCleanAll alone.
+static bool runStallPass(int port, int timeoutMs, int boundMs, const char* label) {
+	std::string url = "http://127.0.0.1:" + std::to_string(port) + "/stall.ts";
+	LiveServer server;
+	server.thread = std::thread(serveStall, &server, "tcp://127.0.0.1:" + std::to_string(port));
+	sleepMs(200);
+
+	NativeDecoderOptions options;
+	nativeGetDefaultDecoderOptions(options);
+	bool isTimeoutPass = strcmp(label, "timeout") == 0;
+	options.openTimeoutMs = isTimeoutPass ? timeoutMs : 0;
+	int id = -1;
+	double startMs = nowMs();
+	nativeCreateDecoderWithOptionsAsync(url.c_str(), options, -1.0f, id);
+
+	int state = 0;
+	double failMs = -1.0;
+	if (isTimeoutPass) {
+		while (state == 0 && nowMs() - startMs < timeoutMs + boundMs * 4) {
+			state = nativeGetDecoderState(id);
+			sleepMs(1);
+		}
+		failMs = state < 0 ? nowMs() - startMs : -1.0;
+	} else {
+		//	Let the request reach the listener, the open then waits for a reply that never comes.
+		while (!server.isConnected && !server.isFailed && nowMs() - startMs < 5000) {
+			sleepMs(1);
+		}
+		sleepMs(200);
+		state = nativeGetDecoderState(id);
+	}
+
+	double destroyMs = 0.0;
+	if (strcmp(label, "destroy") == 0) {
+		double destroyStart = nowMs();
+		nativeDestroyDecoder(id);
+		destroyMs = nowMs() - destroyStart;
+	}
+	double cleanStart = nowMs();
+	nativeCleanAll();
+	double cleanMs = nowMs() - cleanStart;
+
+	server.isStopped = true;
+	server.thread.join();
+
+	bool isSuccess = server.isConnected && !server.isFailed && destroyMs <= boundMs && cleanMs <= boundMs;
+	if (isTimeoutPass) {
+		isSuccess = isSuccess && state == -1 && failMs <= timeoutMs + boundMs;
+	} else {
+		isSuccess = isSuccess && state == 0;
+	}
+
+	printf("{\"mode\":\"stall\",\"config\":\"%s\",\"timeout_ms\":%d,\"bound_ms\":%d,\"state\":%d,\"fail_ms\":%.1f,"
+		"\"destroy_ms\":%.1f,\"clean_all_ms\":%.1f,\"connected\":%s,\"ok\":%s}\n",
+		label, options.openTimeoutMs, boundMs, state, failMs, destroyMs, cleanMs,
+		server.isConnected ? "true" : "false", isSuccess ? "true" : "false");
+	fflush(stdout);
+	return isSuccess;
+}
+
+static int runStall(int argc, char** argv) {
+	int port = atoi(getOption(argc, argv, "--port", "18090"));
+	int timeoutMs = std::max(1, atoi(getOption(argc, argv, "--timeout-ms", "2000")));
+	int boundMs = std::max(1, atoi(getOption(argc, argv, "--bound-ms", "1000")));
+
+	avformat_network_init();
+	bool isSuccess = runStallPass(port, timeoutMs, boundMs, "timeout");
+	isSuccess = runStallPass(port + 1, timeoutMs, boundMs, "destroy") && isSuccess;
+	isSuccess = runStallPass(port + 2, timeoutMs, boundMs, "clean_all") && isSuccess;
+	return isSuccess ? 0 : 1;
+}
+
+//	Polls until the decoder reaches state, false on INIT_FAIL or timeout.
+static bool waitState(int id, int state, int timeoutMs) {
+	double start = nowMs();
+	while (nowMs() - start < timeoutMs) {
+		int current = nativeGetDecoderState(id);
+		if (current == state) {
+			return true;
+		} else if (current < 0) {
+			return false;
+		}
+		sleepMs(1);
+	}
+	return false;
+}
+
+//	Presents frames until count more are out, false if none comes within timeoutMs.
+static bool playFrames(int id, int count, int timeoutMs) {
+	int videoFrames = 0, audioFrames = 0;
+	double start = nowMs();
+	while (videoFrames < count && nowMs() - start < timeoutMs) {
+		pullFrames(id, true, true, videoFrames, audioFrames);
+		sleepMs(1);
+	}
+	return videoFrames >= count;
+}
+
+//	Each cycle times the hibernate call itself, the release running behind it until HIBERNATED, and the resume until
+//	the first frame is presented again.
+static bool runResumePass(const std::string& path, int decoderCount, int cycleCount, bool isCloseInput) {
+	const char* label = isCloseInput ? "close_input" : "keep_input";
+	double callSum = 0.0, callMax = 0.0, releaseSum = 0.0, readySum = 0.0, firstFrameSum = 0.0, firstFrameMax = 0.0;
+	int cycles = 0, failures = 0;
+	int64_t resumeCount = 0, resumeSumUs = 0, resumeMaxUs = 0;
+	for (int d = 0; d < decoderCount; d++) {
+		int id = -1;
+		nativeCreateDecoderAsync(path.c_str(), id);
+		bool isReady = waitInitialized(id, 30000) && nativeStartDecoding(id) && playFrames(id, 10, 10000);
+		for (int c = 0; isReady && c < cycleCount; c++) {
+			double startMs = nowMs();
+			isReady = nativeHibernateDecoder(id, isCloseInput);
+			double callMs = nowMs() - startMs;
+			isReady = isReady && waitState(id, 8, 10000);
+			double releaseMs = nowMs() - startMs;
+
+			startMs = nowMs();
+			nativeResumeDecoderAsync(id);
+			isReady = isReady && waitState(id, 1, 10000);
+			double readyMs = nowMs() - startMs;
+			isReady = isReady && nativeStartDecoding(id) && playFrames(id, 1, 10000);
+			double firstFrameMs = nowMs() - startMs;
+			if (!isReady) {
+				break;
+			}
+
+			callSum += callMs;
+			callMax = std::max(callMax, callMs);
+			releaseSum += releaseMs;
+			readySum += readyMs;
+			firstFrameSum += firstFrameMs;
+			firstFrameMax = std::max(firstFrameMax, firstFrameMs);
+			cycles++;
+			playFrames(id, 10, 10000);
+		}
+		failures += isReady ? 0 : 1;
+
+		NativeDecoderStats stats;
+		memset(&stats, 0, sizeof(stats));
+		if (nativeGetDecoderStats(id, stats)) {
+			resumeCount += stats.resumeLatency.count;
+			resumeSumUs += stats.resumeLatency.sumUs;
+			resumeMaxUs = std::max(resumeMaxUs, stats.resumeLatency.maxUs);
+		}
+		nativeDestroyDecoder(id);
+	}
+	nativeCleanAll();
+
+	double count = std::max(cycles, 1);
+	printf("{\"mode\":\"resume\",\"config\":\"%s\",\"decoders\":%d,\"cycles\":%d,\"hibernate_call_ms\":%.2f,\"hibernate_call_max_ms\":%.2f,"
+		"\"hibernated_ms\":%.1f,\"resume_ready_ms\":%.1f,\"first_frame_ms\":%.1f,\"first_frame_max_ms\":%.1f,"
+		"\"resume_latency_ms\":%.1f,\"resume_latency_max_ms\":%.1f,\"failures\":%d}\n",
+		label, decoderCount, cycles, callSum / count, callMax, releaseSum / count, readySum / count, firstFrameSum / count,
+		firstFrameMax, resumeCount > 0 ? resumeSumUs / 1000.0 / resumeCount : 0.0, resumeMaxUs / 1000.0, failures);
+	fflush(stdout);
+	return failures == 0 && cycles > 0;
+}
+
+static int runResume(int argc, char** argv) {
+	std::string mediaDirectory = getOption(argc, argv, "--media", "benchmark_media");
+	std::string clipName = getOption(argc, argv, "--clip", "mpeg4_360p30_stereo");
+	int decoderCount = std::max(1, atoi(getOption(argc, argv, "--decoders", "4")));
+	int cycleCount = std::max(1, atoi(getOption(argc, argv, "--cycles", "5")));
+
+	std::string path;
+	for (const ClipSpec& spec : getBenchmarkClips()) {
+		if (spec.name == clipName && spec.videoCodec != AV_CODEC_ID_NONE) {
+			path = prepareClip(spec, mediaDirectory, 10.0);
+		}
+	}
+	if (path.empty()) {
+		printf("{\"mode\":\"resume\",\"clip\":\"%s\",\"error\":\"no such video clip\"}\n", clipName.c_str());
+		return 1;
+	}
+
+	bool isSuccess = runResumePass(path, decoderCount, cycleCount, false);
+	isSuccess = runResumePass(path, decoderCount, cycleCount, true) && isSuccess;
+	return isSuccess ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+	std::string mode = argc > 1 ? argv[1] : "";
+	if (mode == "convert") {
+		return runConvert(argc, argv);
+	} else if (mode == "slices") {
+		return runSlices(argc, argv);
+	} else if (mode == "decode") {
+		return runDecode(argc, argv);
+	} else if (mode == "soak") {
+		return runSoak(argc, argv);
+	} else if (mode == "threads") {
+		return runThreads(argc, argv);
+	} else if (mode == "live") {
+		return runLive(argc, argv);
+	} else if (mode == "audio") {
+		return runAudio(argc, argv);
+	} else if (mode == "mmap") {
+		return runMmap(argc, argv);
+	} else if (mode == "cap") {
+		return runCap(argc, argv);
+	} else if (mode == "open") {
+		return runOpen(argc, argv);
+	} else if (mode == "stall") {
+		return runStall(argc, argv);
+	} else if (mode == "resume") {
+		return runResume(argc, argv);
+	}
+
+	fprintf(stderr, "Usage: %s convert|slices|decode|soak|threads|live|audio|mmap|cap|open|stall|resume [options], see Benchmark.cpp\n", argv[0]);
+	return 2;
+}
\ No newline at end of file
@@ -0,0 +1,265 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "BenchmarkMedia.h"
+#include <filesystem>
+#include <math.h>
+#include <stdio.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/mathematics.h>
+}
+
+namespace {
+
+struct OutputStream {
+	AVStream* stream;
+	AVCodecContext* context;
+	AVFrame* frame;
+	int64_t nextPts;
+};
+
+bool openStream(AVFormatContext* formatContext, AVCodecContext* context, const AVCodec* codec, OutputStream& output) {
+	if (formatContext->oformat->flags & AVFMT_GLOBALHEADER) {
+		context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+	}
+
+	if (avcodec_open2(context, codec, nullptr) < 0) {
+		return false;
+	}
+
+	output.stream = avformat_new_stream(formatContext, nullptr);
+	if (output.stream == nullptr || avcodec_parameters_from_context(output.stream->codecpar, context) < 0) {
+		return false;
+	}
+	output.stream->time_base = context->time_base;
+	output.context = context;
+	output.frame = av_frame_alloc();
+	output.nextPts = 0;
+	return true;
+}
+
+bool addVideoStream(AVFormatContext* formatContext, const ClipSpec& spec, OutputStream& output) {
+	AVCodec* codec = avcodec_find_encoder(spec.videoCodec);
+	if (codec == nullptr) {
+		return false;
+	}
+
+	AVCodecContext* context = avcodec_alloc_context3(codec);
+	context->width = spec.width;
+	context->height = spec.height;
+	context->time_base = { 1, spec.frameRate };
+	context->framerate = { spec.frameRate, 1 };
+	context->gop_size = spec.frameRate;
+	context->pix_fmt = spec.videoCodec == AV_CODEC_ID_MJPEG ? AV_PIX_FMT_YUVJ420P : AV_PIX_FMT_YUV420P;
+	context->bit_rate = (int64_t)spec.width * spec.height * spec.frameRate / 8;
+	context->max_b_frames = spec.videoCodec == AV_CODEC_ID_MPEG2VIDEO ? 2 : 0;
+	if (!openStream(formatContext, context, codec, output)) {
+		avcodec_free_context(&context);
+		return false;
+	}
+
+	output.frame->format = context->pix_fmt;
+	output.frame->width = context->width;
+	output.frame->height = context->height;
+	return av_frame_get_buffer(output.frame, 32) >= 0;
+}
+
+bool addAudioStream(AVFormatContext* formatContext, const ClipSpec& spec, OutputStream& output) {
+	AVCodec* codec = avcodec_find_encoder(spec.audioCodec);
+	if (codec == nullptr) {
+		return false;
+	}
+
+	AVCodecContext* context = avcodec_alloc_context3(codec);
+	context->sample_fmt = codec->sample_fmts != nullptr ? codec->sample_fmts[0] : AV_SAMPLE_FMT_S16;
+	context->sample_rate = spec.sampleRate;
+	context->channels = spec.channels;
+	context->channel_layout = av_get_default_channel_layout(spec.channels);
+	context->time_base = { 1, spec.sampleRate };
+	context->bit_rate = 64000 * spec.channels;
+	if (!openStream(formatContext, context, codec, output)) {
+		avcodec_free_context(&context);
+		return false;
+	}
+
+	output.frame->format = context->sample_fmt;
+	output.frame->channels = context->channels;
+	output.frame->channel_layout = context->channel_layout;
+	output.frame->sample_rate = context->sample_rate;
+	//	PCM encoders report no frame size and take any.
+	output.frame->nb_samples = context->frame_size > 0 ? context->frame_size : 1024;
+	return av_frame_get_buffer(output.frame, 0) >= 0;
+}
+
+//	Moving gradients with a bright square, so motion compensation and scene content are not trivial.
+void fillVideoFrame(AVFrame* frame, int64_t index) {
+	av_frame_make_writable(frame);
+	int width = frame->width;
+	int height = frame->height;
+	int squareSize = height / 6;
+	int squareX = (int)(index * 7 % (width - squareSize));
+	int squareY = (int)(index * 3 % (height - squareSize));
+	for (int y = 0; y < height; y++) {
+		uint8_t* row = frame->data[0] + y * frame->linesize[0];
+		for (int x = 0; x < width; x++) {
+			bool isSquare = x >= squareX && x < squareX + squareSize && y >= squareY && y < squareY + squareSize;
+			row[x] = isSquare ? 235 : (uint8_t)(x + y + index * 3);
+		}
+	}
+	for (int y = 0; y < height / 2; y++) {
+		uint8_t* rowU = frame->data[1] + y * frame->linesize[1];
+		uint8_t* rowV = frame->data[2] + y * frame->linesize[2];
+		for (int x = 0; x < width / 2; x++) {
+			rowU[x] = (uint8_t)(128 + y + index * 2);
+			rowV[x] = (uint8_t)(64 + x + index * 5);
+		}
+	}
+}
+
+//	A different sine tone per channel.
+void fillAudioFrame(AVFrame* frame, int64_t firstSample) {
+	av_frame_make_writable(frame);
+	AVSampleFormat format = (AVSampleFormat)frame->format;
+	bool isPlanar = av_sample_fmt_is_planar(format) != 0;
+	for (int i = 0; i < frame->nb_samples; i++) {
+		double time = (double)(firstSample + i) / frame->sample_rate;
+		for (int ch = 0; ch < frame->channels; ch++) {
+			double value = 0.25 * sin(2.0 * M_PI * (220.0 * (ch + 1)) * time);
+			int index = isPlanar ? i : i * frame->channels + ch;
+			uint8_t* plane = frame->data[isPlanar ? ch : 0];
+			switch (format) {
+			case AV_SAMPLE_FMT_FLT:
+			case AV_SAMPLE_FMT_FLTP:
+				((float*)plane)[index] = (float)value;
+				break;
+			case AV_SAMPLE_FMT_S32:
+			case AV_SAMPLE_FMT_S32P:
+				((int32_t*)plane)[index] = (int32_t)(value * 2147483647.0);
+				break;
+			default:
+				((int16_t*)plane)[index] = (int16_t)(value * 32767.0);
+				break;
+			}
+		}
+	}
+}
+
+//	frame is nullptr to drain the encoder.
+bool encodeAndWrite(AVFormatContext* formatContext, OutputStream& output, AVFrame* frame) {
+	if (avcodec_send_frame(output.context, frame) < 0) {
+		return false;
+	}
+
+	AVPacket packet;
+	av_init_packet(&packet);
+	packet.data = nullptr;
+	packet.size = 0;
+	while (avcodec_receive_packet(output.context, &packet) == 0) {
+		av_packet_rescale_ts(&packet, output.context->time_base, output.stream->time_base);
+		packet.stream_index = output.stream->index;
+		if (av_interleaved_write_frame(formatContext, &packet) < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void closeStream(OutputStream& output) {
+	av_frame_free(&output.frame);
+	avcodec_free_context(&output.context);
+}
+
+bool generateClip(const ClipSpec& spec, const std::string& path, double duration) {
+	AVFormatContext* formatContext = nullptr;
+	if (avformat_alloc_output_context2(&formatContext, nullptr, nullptr, path.c_str()) < 0) {
+		return false;
+	}
+
+	OutputStream video = {};
+	OutputStream audio = {};
+	bool hasVideo = spec.videoCodec != AV_CODEC_ID_NONE;
+	bool hasAudio = spec.audioCodec != AV_CODEC_ID_NONE;
+	bool isSuccess = (!hasVideo || addVideoStream(formatContext, spec, video)) && (!hasAudio || addAudioStream(formatContext, spec, audio));
+	if (isSuccess && !(formatContext->oformat->flags & AVFMT_NOFILE)) {
+		isSuccess = avio_open(&formatContext->pb, path.c_str(), AVIO_FLAG_WRITE) >= 0;
+	}
+	isSuccess = isSuccess && avformat_write_header(formatContext, nullptr) >= 0;
+
+	//	Interleave by presentation time until both streams reach the duration.
+	int64_t videoEnd = (int64_t)(duration * spec.frameRate);
+	int64_t audioEnd = (int64_t)(duration * spec.sampleRate);
+	bool isVideoDone = !hasVideo;
+	bool isAudioDone = !hasAudio;
+	while (isSuccess && !(isVideoDone && isAudioDone)) {
+		bool isVideoNext = !isVideoDone && (isAudioDone ||
+			av_compare_ts(video.nextPts, video.context->time_base, audio.nextPts, audio.context->time_base) <= 0);
+		if (isVideoNext) {
+			if (video.nextPts >= videoEnd) {
+				isSuccess = encodeAndWrite(formatContext, video, nullptr);
+				isVideoDone = true;
+				continue;
+			}
+			fillVideoFrame(video.frame, video.nextPts);
+			video.frame->pts = video.nextPts++;
+			isSuccess = encodeAndWrite(formatContext, video, video.frame);
+		} else {
+			if (audio.nextPts >= audioEnd) {
+				isSuccess = encodeAndWrite(formatContext, audio, nullptr);
+				isAudioDone = true;
+				continue;
+			}
+			fillAudioFrame(audio.frame, audio.nextPts);
+			audio.frame->pts = audio.nextPts;
+			audio.nextPts += audio.frame->nb_samples;
+			isSuccess = encodeAndWrite(formatContext, audio, audio.frame);
+		}
+	}
+
+	if (isSuccess) {
+		isSuccess = av_write_trailer(formatContext) >= 0;
+	}
+
+	if (hasVideo) {
+		closeStream(video);
+	}
+	if (hasAudio) {
+		closeStream(audio);
+	}
+	if (formatContext->pb != nullptr && !(formatContext->oformat->flags & AVFMT_NOFILE)) {
+		avio_closep(&formatContext->pb);
+	}
+	avformat_free_context(formatContext);
+	return isSuccess;
+}
+
+}
+
+std::vector<ClipSpec> getBenchmarkClips() {
+	return {
+		{ "mpeg4_360p30_stereo", "mp4", AV_CODEC_ID_MPEG4, 640, 360, 30, AV_CODEC_ID_AAC, 2, 48000 },
+		{ "mpeg2_720p60_mono", "ts", AV_CODEC_ID_MPEG2VIDEO, 1280, 720, 60, AV_CODEC_ID_MP2, 1, 44100 },
+		{ "mjpeg_1080p24_5.1", "avi", AV_CODEC_ID_MJPEG, 1920, 1080, 24, AV_CODEC_ID_PCM_S16LE, 6, 48000 },
+		{ "mpeg4_1440p30_video", "mkv", AV_CODEC_ID_MPEG4, 2560, 1440, 30, AV_CODEC_ID_NONE, 0, 0 },
+		{ "aac_stereo_audio", "m4a", AV_CODEC_ID_NONE, 0, 0, 0, AV_CODEC_ID_AAC, 2, 44100 },
+	};
+}
+
+std::string prepareClip(const ClipSpec& spec, const std::string& directory, double duration) {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), "_%ds.", (int)duration);
+	std::string path = directory + "/" + spec.name + suffix + spec.extension;
+	if (std::filesystem::exists(path, error)) {
+		return path;
+	}
+
+	av_register_all();
+	if (!generateClip(spec, path, duration)) {
+		std::filesystem::remove(path, error);
+		return "";
+	}
+	return path;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+//	Synthetic clips for the offline benchmark, encoded locally with the FFmpeg built-in encoders.
+struct ClipSpec {
+	std::string name;
+	std::string extension;
+	AVCodecID videoCodec;		//	AV_CODEC_ID_NONE for audio only clips.
+	int width;
+	int height;
+	int frameRate;
+	AVCodecID audioCodec;		//	AV_CODEC_ID_NONE for video only clips.
+	int channels;
+	int sampleRate;
+};
+
+//	A spread of codecs, resolutions, frame rates and channel layouts.
+std::vector<ClipSpec> getBenchmarkClips();
+
+//	Path of the clip inside directory, encoding it first when it does not exist yet. Empty on failure.
+std::string prepareClip(const ClipSpec& spec, const std::string& directory, double duration);
\ No newline at end of file
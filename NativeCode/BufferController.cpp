@@ -0,0 +1,100 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "BufferController.h"
+#include <algorithm>
+#include <math.h>
+
+namespace {
+	const double BASE_SECONDS = 0.2;			//	Covers scheduling noise of the host and the decode thread.
+	const double INITIAL_SECONDS = 1.0;			//	Until there is a measurement.
+	const double SLOW_SOURCE_SECONDS = 1.0e6;	//	Reaches the configured maximum.
+	const double STALL_DECAY = 0.9;
+	const double HEADROOM_SMOOTHING = 0.3;
+	const int64_t UPDATE_INTERVAL_US = 500000;
+	const int64_t UNDERRUN_DECAY_US = 10000000;
+	const int MAX_UNDERRUN_LEVEL = 3;
+}
+
+BufferController::BufferController() {
+	reset();
+	mTargetSeconds = INITIAL_SECONDS;
+	mStallSeconds = 0.0;
+	mHeadroom = -1.0;
+	mUnderrunLevel = 0;
+	mLastUnderrunUs = 0;
+}
+
+//	Starts a new measurement window, the learned state is kept so a seek does not forget a slow source.
+void BufferController::reset() {
+	mHasUnderrun = false;
+	mWindowStartUs = -1;
+	mWindowBusyUs = 0;
+	mWindowMaxReadUs = 0;
+	mWindowMediaSeconds = 0.0;
+}
+
+void BufferController::onPacket(int64_t readUs, int64_t busyUs) {
+	mWindowBusyUs += busyUs;
+	mWindowMaxReadUs = std::max(mWindowMaxReadUs, readUs);
+}
+
+void BufferController::onMediaProduced(double seconds) {
+	mWindowMediaSeconds += seconds;
+}
+
+void BufferController::onUnderrun() {
+	mHasUnderrun = true;
+}
+
+bool BufferController::update(int64_t nowUs) {
+	if (mWindowStartUs < 0) {
+		mWindowStartUs = nowUs;
+		return false;
+	}
+	if (nowUs - mWindowStartUs < UPDATE_INTERVAL_US && !mHasUnderrun) {
+		return false;
+	}
+
+	mStallSeconds = std::max(mWindowMaxReadUs / 1.0e6, mStallSeconds * STALL_DECAY);
+
+	if (mWindowBusyUs > 0 && mWindowMediaSeconds > 0.0) {
+		double headroom = mWindowMediaSeconds / (mWindowBusyUs / 1.0e6);
+		mHeadroom = mHeadroom < 0.0 ? headroom : mHeadroom + HEADROOM_SMOOTHING * (headroom - mHeadroom);
+	}
+
+	if (mHasUnderrun) {
+		mUnderrunLevel = std::min(mUnderrunLevel + 1, MAX_UNDERRUN_LEVEL);
+		mLastUnderrunUs = nowUs;
+	} else if (mUnderrunLevel > 0 && nowUs - mLastUnderrunUs > UNDERRUN_DECAY_US) {
+		mUnderrunLevel--;
+		mLastUnderrunUs = nowUs;
+	}
+
+	double targetSeconds = INITIAL_SECONDS;
+	if (mHeadroom >= 0.0) {
+		//	A pipeline only just faster than real time refills slowly after a stall, so it needs a deeper queue.
+		//	At or below real time no depth is enough, keep as much as allowed for the longest smooth stretch.
+		double refillSeconds = mHeadroom > 1.1 ? 0.25 / (mHeadroom - 1.0) : SLOW_SOURCE_SECONDS;
+		targetSeconds = BASE_SECONDS + 2.0 * mStallSeconds + refillSeconds;
+	}
+	mTargetSeconds = targetSeconds * (1 << mUnderrunLevel);
+
+	mHasUnderrun = false;
+	mWindowStartUs = nowUs;
+	mWindowBusyUs = 0;
+	mWindowMaxReadUs = 0;
+	mWindowMediaSeconds = 0.0;
+	return true;
+}
+
+double BufferController::getTargetSeconds() const {
+	return mTargetSeconds;
+}
+
+unsigned int BufferController::toFrames(double seconds, double framesPerSecond, unsigned int minFrames, unsigned int maxFrames) {
+	double frames = ceil(seconds * framesPerSecond);
+	if (!(frames < maxFrames)) {
+		return std::max(maxFrames, minFrames);
+	}
+	return std::max((unsigned int)frames, minFrames);
+}
\ No newline at end of file
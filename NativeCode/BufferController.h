@@ -0,0 +1,38 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+
+//	Picks how many seconds of decoded media a decoder should keep queued.
+//	Measured on the decode thread: the worst recent read stall, how much faster than real time
+//	the pipeline produces media, and underruns reported by the consumer.
+class BufferController {
+public:
+	BufferController();
+
+	void reset();
+
+	//	One pass of the decode loop, busyUs covers reading, decoding and conversion, readUs only the read.
+	void onPacket(int64_t readUs, int64_t busyUs);
+	void onMediaProduced(double seconds);
+	void onUnderrun();
+
+	//	Recompute the target at most every half second or right after an underrun, true if it was recomputed.
+	bool update(int64_t nowUs);
+	double getTargetSeconds() const;
+
+	static unsigned int toFrames(double seconds, double framesPerSecond, unsigned int minFrames, unsigned int maxFrames);
+
+private:
+	double mTargetSeconds;
+	double mStallSeconds;		//	Decaying peak of single read durations.
+	double mHeadroom;			//	Smoothed media seconds produced per busy second, < 0 until measured.
+	int mUnderrunLevel;			//	Each level doubles the target.
+	bool mHasUnderrun;
+
+	int64_t mWindowStartUs;
+	int64_t mLastUnderrunUs;
+	int64_t mWindowBusyUs;
+	int64_t mWindowMaxReadUs;
+	double mWindowMediaSeconds;
+};
\ No newline at end of file
@@ -0,0 +1,123 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "CodecPool.h"
+#include "Logger.h"
+
+bool CodecPool::Key::operator==(const Key& other) const {
+	return type == other.type &&
+		codecId == other.codecId &&
+		format == other.format &&
+		width == other.width &&
+		height == other.height &&
+		profile == other.profile &&
+		sampleRate == other.sampleRate &&
+		channels == other.channels &&
+		channelLayout == other.channelLayout &&
+		threadCount == other.threadCount &&
+		threadType == other.threadType &&
+		flags == other.flags &&
+		extradata == other.extradata;
+}
+
+CodecPool* CodecPool::_instance;
+CodecPool::CodecPool() {
+	mCapacity = 4;
+	mHitCount = 0;
+	mMissCount = 0;
+}
+
+CodecPool* CodecPool::instance() {
+	static std::once_flag once;
+	std::call_once(once, []() { _instance = new CodecPool(); });
+	return _instance;
+}
+
+//	Extradata is part of the key, an opened decoder keeps the parameter sets it was opened with.
+CodecPool::Key CodecPool::makeKey(const AVCodecParameters* params, int threadCount, int threadType, int flags) {
+	Key key;
+	key.type = params->codec_type;
+	key.codecId = params->codec_id;
+	key.format = params->format;
+	key.width = params->width;
+	key.height = params->height;
+	key.profile = params->profile;
+	key.sampleRate = params->sample_rate;
+	key.channels = params->channels;
+	key.channelLayout = params->channel_layout;
+	key.threadCount = threadCount;
+	key.threadType = threadType;
+	key.flags = flags;
+	if (params->extradata != nullptr && params->extradata_size > 0) {
+		key.extradata.assign((const char*)params->extradata, params->extradata_size);
+	}
+
+	return key;
+}
+
+void CodecPool::freeEntry(Entry& entry) {
+	if (entry.codecContext != nullptr) {
+		avcodec_free_context(&entry.codecContext);
+	}
+
+	if (entry.videoConverter != nullptr) {
+		delete entry.videoConverter;
+		entry.videoConverter = nullptr;
+	}
+
+	if (entry.bufferPool != nullptr) {
+		av_buffer_pool_uninit(&entry.bufferPool);
+	}
+
+	if (entry.swrContext != nullptr) {
+		swr_free(&entry.swrContext);
+	}
+}
+
+//	On hit the entry is removed from the pool and its codec context is flushed.
+bool CodecPool::acquire(const Key& key, Entry& entry) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto it = mIdleEntries.begin(); it != mIdleEntries.end(); it++) {
+		if (it->first == key) {
+			entry = it->second;
+			mIdleEntries.erase(it);
+			avcodec_flush_buffers(entry.codecContext);
+			mHitCount++;
+			return true;
+		}
+	}
+
+	mMissCount++;
+	return false;
+}
+
+//	Takes ownership of the entry. The least recently released entry is freed when the pool is over capacity.
+void CodecPool::release(const Key& key, Entry& entry) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mCapacity <= 0) {
+		freeEntry(entry);
+		return;
+	}
+
+	mIdleEntries.push_front(std::make_pair(key, entry));
+	while ((int)mIdleEntries.size() > mCapacity) {
+		freeEntry(mIdleEntries.back().second);
+		mIdleEntries.pop_back();
+	}
+	LOG_INFO(Logger::CATEGORY_DECODER, "Codec pool idle count %d. \n", (int)mIdleEntries.size());
+}
+
+void CodecPool::setCapacity(int capacity) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCapacity = capacity;
+	while ((int)mIdleEntries.size() > (mCapacity > 0 ? mCapacity : 0)) {
+		freeEntry(mIdleEntries.back().second);
+		mIdleEntries.pop_back();
+	}
+}
+
+void CodecPool::getStats(int& idleCount, int& hitCount, int& missCount) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	idleCount = (int)mIdleEntries.size();
+	hitCount = mHitCount;
+	missCount = mMissCount;
+}
\ No newline at end of file
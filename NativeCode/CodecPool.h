@@ -0,0 +1,66 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <mutex>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
+}
+
+#include "VideoConverter.h"
+
+//	Keeps opened codec contexts of destroyed decoders, together with their conversion state and output buffers,
+//	so a following source with the same codec parameters skips avcodec_open2 and reuses the codec worker threads.
+class CodecPool {
+public:
+	struct Key {
+		AVMediaType type;
+		AVCodecID codecId;
+		int format;
+		int width;
+		int height;
+		int profile;
+		int sampleRate;
+		int channels;
+		uint64_t channelLayout;
+		int threadCount;
+		int threadType;
+		int flags;				//	AVCodecContext flags set at open.
+		std::string extradata;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct Entry {
+		AVCodecContext* codecContext;
+		VideoConverter* videoConverter;
+		AVBufferPool* bufferPool;
+		int bufferSize;
+		SwrContext* swrContext;
+	};
+
+	static CodecPool* instance();
+	static Key makeKey(const AVCodecParameters* params, int threadCount, int threadType, int flags = 0);
+	static void freeEntry(Entry& entry);
+
+	bool acquire(const Key& key, Entry& entry);
+	void release(const Key& key, Entry& entry);
+
+	void setCapacity(int capacity);
+	void getStats(int& idleCount, int& hitCount, int& missCount);
+
+private:
+	CodecPool();
+
+	std::mutex mMutex;
+	std::list<std::pair<Key, Entry>> mIdleEntries;	//	Most recently released first.
+	int mCapacity;
+	int mHitCount;
+	int mMissCount;
+
+	static CodecPool* _instance;
+};
\ No newline at end of file
@@ -0,0 +1,103 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "CodecThreadBudget.h"
+#include "Logger.h"
+#include <algorithm>
+#include <thread>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace {
+	const int PRIORITY_WEIGHTS[] = { 1, 2, 4 };
+	const int64_t PIXELS_PER_THREAD = 640 * 360;
+	const int MAX_THREADS_PER_DECODER = 16;
+
+	int getHardwareThreads() {
+		int threads = (int)std::thread::hardware_concurrency();
+		return threads > 0 ? threads : 4;
+	}
+}
+
+CodecThreadBudget* CodecThreadBudget::_instance;
+CodecThreadBudget::CodecThreadBudget() {
+	mBudget = 0;
+	mAllocated = 0;
+}
+
+CodecThreadBudget* CodecThreadBudget::instance() {
+	static std::once_flag once;
+	std::call_once(once, []() { _instance = new CodecThreadBudget(); });
+	return _instance;
+}
+
+void CodecThreadBudget::setBudget(int budget) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mBudget = budget;
+}
+
+int CodecThreadBudget::getBudget() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mBudget == 0 ? getHardwareThreads() : mBudget;
+}
+
+//	The fair share is weighted by priority over all live decoders, and capped by resolution because small frames
+//	do not scale over many threads. Frame threading gives the best throughput but delays every frame by one frame
+//	per thread, so high priority decoders use slice threading when the codec supports it for faster seeks and startup.
+CodecThreadBudget::Allocation CodecThreadBudget::acquire(const void* owner, int width, int height, Priority priority, int codecCapabilities, int requestedThreads) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	releaseLocked(owner);
+
+	Allocation allocation;
+	allocation.threadType = FF_THREAD_FRAME | FF_THREAD_SLICE;
+	if (mBudget < 0) {
+		allocation.threadCount = std::max(requestedThreads, 0);
+		mReservations[owner] = { 0, priority };
+		return allocation;
+	}
+
+	int budget = mBudget == 0 ? getHardwareThreads() : mBudget;
+	int totalWeight = PRIORITY_WEIGHTS[priority];
+	for (auto& reservation : mReservations) {
+		totalWeight += PRIORITY_WEIGHTS[reservation.second.priority];
+	}
+
+	int fairShare = budget * PRIORITY_WEIGHTS[priority] / totalWeight;
+	int64_t pixels = (int64_t)width * height;
+	int resolutionCap = (int)std::min<int64_t>((pixels + PIXELS_PER_THREAD - 1) / PIXELS_PER_THREAD, MAX_THREADS_PER_DECODER);
+	int available = budget - mAllocated;
+	allocation.threadCount = std::max(1, std::min({ fairShare, resolutionCap, available }));
+	if (requestedThreads > 0) {
+		allocation.threadCount = requestedThreads;
+	}
+
+	if (priority == PRIORITY_HIGH && (codecCapabilities & AV_CODEC_CAP_SLICE_THREADS)) {
+		allocation.threadType = FF_THREAD_SLICE;
+	}
+
+	mReservations[owner] = { allocation.threadCount, priority };
+	mAllocated += allocation.threadCount;
+	LOG_INFO(Logger::CATEGORY_DECODER, "Codec threads %d (%s), %d of %d allocated to %d decoders. \n", allocation.threadCount,
+		allocation.threadType == FF_THREAD_SLICE ? "slice" : "frame", mAllocated, budget, (int)mReservations.size());
+	return allocation;
+}
+
+void CodecThreadBudget::release(const void* owner) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	releaseLocked(owner);
+}
+
+void CodecThreadBudget::releaseLocked(const void* owner) {
+	auto it = mReservations.find(owner);
+	if (it != mReservations.end()) {
+		mAllocated -= it->second.threadCount;
+		mReservations.erase(it);
+	}
+}
+
+void CodecThreadBudget::getStats(int& liveDecoders, int& allocatedThreads) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	liveDecoders = (int)mReservations.size();
+	allocatedThreads = mAllocated;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <mutex>
+#include <map>
+
+//	Process wide number of codec worker threads shared by all live video decoders.
+//	With threads=auto every decoder would start about one thread per core, so many decoders oversubscribe the CPU.
+class CodecThreadBudget {
+public:
+	enum Priority { PRIORITY_LOW, PRIORITY_NORMAL, PRIORITY_HIGH };
+
+	struct Allocation {
+		int threadCount;	//	0 lets the codec choose, only used when the budget is unlimited.
+		int threadType;		//	FF_THREAD_FRAME and/or FF_THREAD_SLICE.
+	};
+
+	static CodecThreadBudget* instance();
+
+	//	Total codec threads, 0 for the hardware concurrency, negative for unlimited threads=auto per decoder.
+	void setBudget(int budget);
+	int getBudget();
+
+	//	Called before the video codec of decoder owner opens. The count can not change afterwards, so decoders
+	//	opened later only get what is left and every decoder gets at least one thread.
+	//	codecCapabilities are the AVCodec capabilities of the decoder about to open, requestedThreads > 0 fixes the count.
+	Allocation acquire(const void* owner, int width, int height, Priority priority, int codecCapabilities, int requestedThreads = 0);
+	void release(const void* owner);
+
+	void getStats(int& liveDecoders, int& allocatedThreads);
+
+private:
+	CodecThreadBudget();
+
+	struct Reservation {
+		int threadCount;
+		Priority priority;
+	};
+
+	void releaseLocked(const void* owner);
+
+	std::mutex mMutex;
+	std::map<const void*, Reservation> mReservations;
+	int mBudget;
+	int mAllocated;
+
+	static CodecThreadBudget* _instance;
+};
\ No newline at end of file
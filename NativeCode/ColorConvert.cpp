@@ -0,0 +1,181 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "ColorConvert.h"
+#include <math.h>
+#include <stddef.h>
+
+#if defined(COLOR_CONVERT_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+ColorConvert::Kernel ColorConvert::mKernel = ColorConvert::detectKernel();
+
+//	Coefficients are derived from Kr/Kb of the matrix, limited range also scales Y by 255/219 and chroma by 255/224.
+ColorConvert::Coefficients ColorConvert::getCoefficients(Matrix matrix, bool isFullRange) {
+	double kr = matrix == BT709 ? 0.2126 : 0.299;
+	double kb = matrix == BT709 ? 0.0722 : 0.114;
+	double kg = 1.0 - kr - kb;
+	double yScale = isFullRange ? 1.0 : 255.0 / 219.0;
+	double cScale = isFullRange ? 1.0 : 255.0 / 224.0;
+	const double one = 1 << 13;
+
+	Coefficients coef;
+	coef.yOffset = isFullRange ? 0 : 16;
+	coef.yScale = (int16_t)lround(yScale * one);
+	coef.crR = (int16_t)lround(2.0 * (1.0 - kr) * cScale * one);
+	coef.cbG = (int16_t)lround(2.0 * (1.0 - kb) * kb / kg * cScale * one);
+	coef.crG = (int16_t)lround(2.0 * (1.0 - kr) * kr / kg * cScale * one);
+	coef.cbB = (int16_t)lround(2.0 * (1.0 - kb) * cScale * one);
+	return coef;
+}
+
+void ColorConvert::convert(SourceFormat srcFormat, DestFormat dstFormat, const Coefficients& coef,
+	const uint8_t* const src[], const int srcStride[], uint8_t* dst, int dstStride, int width, int rowBegin, int rowEnd) {
+	RowFunc rowFunc = getRowFunc(mKernel, srcFormat, dstFormat);
+	for (int row = rowBegin; row < rowEnd; row++) {
+		const uint8_t* y = src[0] + (ptrdiff_t)row * srcStride[0];
+		const uint8_t* u = src[1] + (ptrdiff_t)(row >> 1) * srcStride[1];
+		const uint8_t* v = srcFormat == NV12 ? nullptr : src[2] + (ptrdiff_t)(row >> 1) * srcStride[2];
+		rowFunc(y, u, v, dst + (ptrdiff_t)row * dstStride, width, coef);
+	}
+}
+
+//	Force a kernel, mainly for benchmarks and comparisons. AUTO restores the detected one.
+bool ColorConvert::setKernel(Kernel kernel) {
+	if (kernel == AUTO) {
+		mKernel = detectKernel();
+		return true;
+	}
+
+	if (!isKernelSupported(kernel)) {
+		return false;
+	}
+
+	mKernel = kernel;
+	return true;
+}
+
+ColorConvert::Kernel ColorConvert::getKernel() {
+	return mKernel;
+}
+
+const char* ColorConvert::getKernelName(Kernel kernel) {
+	switch (kernel) {
+	case C: return "c";
+	case SSE2: return "sse2";
+	case AVX2: return "avx2";
+	case NEON: return "neon";
+	default: return "auto";
+	}
+}
+
+#if defined(COLOR_CONVERT_X86)
+static void cpuid(int info[4], int leaf, int subleaf) {
+#if defined(_MSC_VER)
+	__cpuidex(info, leaf, subleaf);
+#else
+	unsigned int a = 0, b = 0, c = 0, d = 0;
+	__cpuid_count(leaf, subleaf, a, b, c, d);
+	info[0] = (int)a;
+	info[1] = (int)b;
+	info[2] = (int)c;
+	info[3] = (int)d;
+#endif
+}
+
+//	AVX state has to be enabled by the OS as well, which is reported through XCR0.
+static uint64_t xgetbv0() {
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax = 0, edx = 0;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+bool ColorConvert::isKernelSupported(Kernel kernel) {
+	switch (kernel) {
+	case C:
+		return true;
+#if defined(COLOR_CONVERT_X86)
+	case SSE2: {
+		int info[4];
+		cpuid(info, 1, 0);
+		return (info[3] & (1 << 26)) != 0;
+	}
+	case AVX2: {
+		int info[4];
+		cpuid(info, 0, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+
+		cpuid(info, 1, 0);
+		bool isOSXSave = (info[2] & (1 << 27)) != 0;
+		bool isAVX = (info[2] & (1 << 28)) != 0;
+		if (!isOSXSave || !isAVX || (xgetbv0() & 6) != 6) {
+			return false;
+		}
+
+		cpuid(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}
+#elif defined(COLOR_CONVERT_NEON)
+	case NEON:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+ColorConvert::Kernel ColorConvert::detectKernel() {
+	const Kernel preferred[] = { AVX2, SSE2, NEON };
+	for (Kernel kernel : preferred) {
+		if (isKernelSupported(kernel)) {
+			return kernel;
+		}
+	}
+
+	return C;
+}
+
+#define COLOR_CONVERT_SELECT_ROW(isa) \
+	if (srcFormat == NV12) { \
+		return dstFormat == RGBA ? nv12ToRGBARow_##isa : nv12ToRGB24Row_##isa; \
+	} \
+	return dstFormat == RGBA ? yuv420pToRGBARow_##isa : yuv420pToRGB24Row_##isa;
+
+ColorConvert::RowFunc ColorConvert::getRowFunc(Kernel kernel, SourceFormat srcFormat, DestFormat dstFormat) {
+	switch (kernel) {
+#if defined(COLOR_CONVERT_X86)
+	case SSE2: { COLOR_CONVERT_SELECT_ROW(SSE2) }
+	case AVX2: { COLOR_CONVERT_SELECT_ROW(AVX2) }
+#elif defined(COLOR_CONVERT_NEON)
+	case NEON: { COLOR_CONVERT_SELECT_ROW(NEON) }
+#endif
+	default: { COLOR_CONVERT_SELECT_ROW(C) }
+	}
+}
+
+void yuv420pToRGB24Row_C(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	colorConvertRowTail<false, false>(y, u, v, dst, 0, width, coef);
+}
+
+void yuv420pToRGBARow_C(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	colorConvertRowTail<false, true>(y, u, v, dst, 0, width, coef);
+}
+
+void nv12ToRGB24Row_C(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	colorConvertRowTail<true, false>(y, u, v, dst, 0, width, coef);
+}
+
+void nv12ToRGBARow_C(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	colorConvertRowTail<true, true>(y, u, v, dst, 0, width, coef);
+}
\ No newline at end of file
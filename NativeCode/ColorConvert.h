@@ -0,0 +1,94 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COLOR_CONVERT_X86
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define COLOR_CONVERT_NEON
+#endif
+
+//	Same size YUV420P/NV12 to RGB24/RGBA conversion with nearest chroma upsampling, the common case of updateVideoFrame.
+//	SIMD kernels are chosen at runtime by CPU features and are bit exact with the C kernel.
+//	Everything else goes through swscale.
+class ColorConvert {
+public:
+	enum SourceFormat { YUV420P, NV12 };
+	enum DestFormat { RGB24, RGBA };
+	enum Matrix { BT601, BT709 };
+	enum Kernel { AUTO, C, SSE2, AVX2, NEON };
+
+	//	Fixed point Q13 factors, Y' = (Y - yOffset) * yScale, chroma is centered at 128.
+	struct Coefficients {
+		int16_t yOffset;
+		int16_t yScale;
+		int16_t crR;
+		int16_t cbG;
+		int16_t crG;
+		int16_t cbB;
+	};
+
+	typedef void (*RowFunc)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const Coefficients& coef);
+
+	static Coefficients getCoefficients(Matrix matrix, bool isFullRange);
+
+	//	Convert rows [rowBegin, rowEnd). src holds Y, U, V planes for YUV420P and Y, UV for NV12.
+	static void convert(SourceFormat srcFormat, DestFormat dstFormat, const Coefficients& coef,
+		const uint8_t* const src[], const int srcStride[], uint8_t* dst, int dstStride, int width, int rowBegin, int rowEnd);
+
+	static bool setKernel(Kernel kernel);
+	static Kernel getKernel();
+	static const char* getKernelName(Kernel kernel);
+	static bool isKernelSupported(Kernel kernel);
+
+private:
+	static RowFunc getRowFunc(Kernel kernel, SourceFormat srcFormat, DestFormat dstFormat);
+	static Kernel detectKernel();
+	static Kernel mKernel;
+};
+
+//	Kernel entry points, implemented per instruction set in ColorConvert*.cpp.
+//	NV12 variants receive the interleaved UV row in u and ignore v.
+#define COLOR_CONVERT_DECLARE_ROWS(isa) \
+	void yuv420pToRGB24Row_##isa(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef); \
+	void yuv420pToRGBARow_##isa(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef); \
+	void nv12ToRGB24Row_##isa(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef); \
+	void nv12ToRGBARow_##isa(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef);
+
+COLOR_CONVERT_DECLARE_ROWS(C)
+#if defined(COLOR_CONVERT_X86)
+COLOR_CONVERT_DECLARE_ROWS(SSE2)
+COLOR_CONVERT_DECLARE_ROWS(AVX2)
+#elif defined(COLOR_CONVERT_NEON)
+COLOR_CONVERT_DECLARE_ROWS(NEON)
+#endif
+
+//	Scalar conversion of one pixel, shared by the C kernel and the SIMD tails.
+static inline uint8_t colorConvertClamp(int value) {
+	return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+static inline void colorConvertPixel(int y, int u, int v, const ColorConvert::Coefficients& coef, uint8_t* rgb) {
+	int yTerm = (y - coef.yOffset) * coef.yScale + (1 << 12);
+	u -= 128;
+	v -= 128;
+	rgb[0] = colorConvertClamp((yTerm + v * coef.crR) >> 13);
+	rgb[1] = colorConvertClamp((yTerm - u * coef.cbG - v * coef.crG) >> 13);
+	rgb[2] = colorConvertClamp((yTerm + u * coef.cbB) >> 13);
+}
+
+template<bool isNV12, bool isRGBA>
+static inline void colorConvertRowTail(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int begin, int width, const ColorConvert::Coefficients& coef) {
+	const int pixelSize = isRGBA ? 4 : 3;
+	for (int x = begin; x < width; x++) {
+		int c = x >> 1;
+		int cb = isNV12 ? u[c * 2] : u[c];
+		int cr = isNV12 ? u[c * 2 + 1] : v[c];
+		uint8_t* rgb = dst + x * pixelSize;
+		colorConvertPixel(y[x], cb, cr, coef, rgb);
+		if (isRGBA) {
+			rgb[3] = 255;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+//	Built with AVX2 code generation enabled (see CMakeLists.txt), only called after the runtime check in ColorConvert.
+#include "ColorConvert.h"
+
+#if defined(COLOR_CONVERT_X86)
+#include <immintrin.h>
+#include <string.h>
+
+struct AVX2Coefs {
+	__m256i yOffset;
+	__m256i y;
+	__m256i r;
+	__m256i g;
+	__m256i b;
+};
+
+static inline __m256i pair(int lo, int hi) {
+	return _mm256_set1_epi32((int)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo));
+}
+
+static inline AVX2Coefs makeCoefs(const ColorConvert::Coefficients& coef) {
+	AVX2Coefs k;
+	k.yOffset = _mm256_set1_epi16(coef.yOffset);
+	k.y = pair(coef.yScale, 1 << 12);
+	k.r = pair(0, coef.crR);
+	k.g = pair(-coef.cbG, -coef.crG);
+	k.b = pair(coef.cbB, 0);
+	return k;
+}
+
+//	Unpack and pack both work within 128-bit lanes, so the pixel order is restored by the final pack.
+static inline __m128i madd2(__m256i yLo, __m256i yHi, __m256i uvLo, __m256i uvHi, __m256i coef) {
+	__m256i lo = _mm256_srai_epi32(_mm256_add_epi32(yLo, _mm256_madd_epi16(uvLo, coef)), 13);
+	__m256i hi = _mm256_srai_epi32(_mm256_add_epi32(yHi, _mm256_madd_epi16(uvHi, coef)), 13);
+	__m256i packed = _mm256_packs_epi32(lo, hi);
+	return _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+}
+
+//	16 pixels, y8 as bytes, u16/v16 as 16-bit with one chroma sample per pixel.
+static inline void convert16(__m128i y8, __m256i u16, __m256i v16, const AVX2Coefs& k, __m128i& r, __m128i& g, __m128i& b) {
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i chromaOffset = _mm256_set1_epi16(128);
+	__m256i y16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(y8), k.yOffset);
+	u16 = _mm256_sub_epi16(u16, chromaOffset);
+	v16 = _mm256_sub_epi16(v16, chromaOffset);
+
+	__m256i yLo = _mm256_madd_epi16(_mm256_unpacklo_epi16(y16, one), k.y);
+	__m256i yHi = _mm256_madd_epi16(_mm256_unpackhi_epi16(y16, one), k.y);
+	__m256i uvLo = _mm256_unpacklo_epi16(u16, v16);
+	__m256i uvHi = _mm256_unpackhi_epi16(u16, v16);
+	r = madd2(yLo, yHi, uvLo, uvHi, k.r);
+	g = madd2(yLo, yHi, uvLo, uvHi, k.g);
+	b = madd2(yLo, yHi, uvLo, uvHi, k.b);
+}
+
+static inline __m256i combine(__m128i lo, __m128i hi) {
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+static inline void storeRGB4(uint8_t* dst, __m128i rgba) {
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	__m128i out = _mm_shuffle_epi8(rgba, shuffle);
+	_mm_storel_epi64((__m128i*)dst, out);
+	int tail = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+	memcpy(dst + 8, &tail, 4);
+}
+
+template<bool isRGBA>
+static inline void store16(uint8_t* dst, __m128i r, __m128i g, __m128i b) {
+	const __m128i a = _mm_set1_epi8((char)0xFF);
+	__m128i rgLo = _mm_unpacklo_epi8(r, g);
+	__m128i rgHi = _mm_unpackhi_epi8(r, g);
+	__m128i baLo = _mm_unpacklo_epi8(b, a);
+	__m128i baHi = _mm_unpackhi_epi8(b, a);
+	__m128i q0 = _mm_unpacklo_epi16(rgLo, baLo);
+	__m128i q1 = _mm_unpackhi_epi16(rgLo, baLo);
+	__m128i q2 = _mm_unpacklo_epi16(rgHi, baHi);
+	__m128i q3 = _mm_unpackhi_epi16(rgHi, baHi);
+	if (isRGBA) {
+		_mm256_storeu_si256((__m256i*)dst, combine(q0, q1));
+		_mm256_storeu_si256((__m256i*)(dst + 32), combine(q2, q3));
+	} else {
+		storeRGB4(dst, q0);
+		storeRGB4(dst + 12, q1);
+		storeRGB4(dst + 24, q2);
+		storeRGB4(dst + 36, q3);
+	}
+}
+
+template<bool isNV12, bool isRGBA>
+static void convertRow(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	const int pixelSize = isRGBA ? 4 : 3;
+	AVX2Coefs k = makeCoefs(coef);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i y8 = _mm_loadu_si128((const __m128i*)(y + x));
+		__m256i u16, v16;
+		if (isNV12) {
+			__m128i uv = _mm_loadu_si128((const __m128i*)(u + x));
+			__m128i cb = _mm_and_si128(uv, lowBytes);
+			__m128i cr = _mm_srli_epi16(uv, 8);
+			u16 = combine(_mm_unpacklo_epi16(cb, cb), _mm_unpackhi_epi16(cb, cb));
+			v16 = combine(_mm_unpacklo_epi16(cr, cr), _mm_unpackhi_epi16(cr, cr));
+		} else {
+			__m128i cb = _mm_loadl_epi64((const __m128i*)(u + x / 2));
+			__m128i cr = _mm_loadl_epi64((const __m128i*)(v + x / 2));
+			u16 = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(cb, cb));
+			v16 = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(cr, cr));
+		}
+
+		__m128i r, g, b;
+		convert16(y8, u16, v16, k, r, g, b);
+		store16<isRGBA>(dst + x * pixelSize, r, g, b);
+	}
+
+	colorConvertRowTail<isNV12, isRGBA>(y, u, v, dst, x, width, coef);
+}
+
+void yuv420pToRGB24Row_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<false, false>(y, u, v, dst, width, coef);
+}
+
+void yuv420pToRGBARow_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<false, true>(y, u, v, dst, width, coef);
+}
+
+void nv12ToRGB24Row_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<true, false>(y, u, v, dst, width, coef);
+}
+
+void nv12ToRGBARow_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<true, true>(y, u, v, dst, width, coef);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "ColorConvert.h"
+
+#if defined(COLOR_CONVERT_NEON)
+#include <arm_neon.h>
+
+//	8 pixels, inputs as signed 16-bit with offsets removed. vqshrn/vqmovun saturate like the C kernel clamps.
+static inline uint8x8_t convert8(int32x4_t yLo, int32x4_t yHi, int16x8_t u, int16x8_t v, int16_t cu, int16_t cv) {
+	int32x4_t lo = vmlal_n_s16(vmlal_n_s16(yLo, vget_low_s16(u), cu), vget_low_s16(v), cv);
+	int32x4_t hi = vmlal_n_s16(vmlal_n_s16(yHi, vget_high_s16(u), cu), vget_high_s16(v), cv);
+	return vqmovun_s16(vcombine_s16(vqshrn_n_s32(lo, 13), vqshrn_n_s32(hi, 13)));
+}
+
+static inline void convert16(uint8x16_t y8, uint8x8_t cb, uint8x8_t cr, const ColorConvert::Coefficients& coef, uint8x16_t& r, uint8x16_t& g, uint8x16_t& b) {
+	const uint8x8_t yOffset = vdup_n_u8((uint8_t)coef.yOffset);
+	const uint8x8_t chromaOffset = vdup_n_u8(128);
+	const int32x4_t round = vdupq_n_s32(1 << 12);
+
+	int16x8_t u = vreinterpretq_s16_u16(vsubl_u8(cb, chromaOffset));
+	int16x8_t v = vreinterpretq_s16_u16(vsubl_u8(cr, chromaOffset));
+	int16x8x2_t uu = vzipq_s16(u, u);
+	int16x8x2_t vv = vzipq_s16(v, v);
+
+	int16x8_t y16[2] = {
+		vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(y8), yOffset)),
+		vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(y8), yOffset))
+	};
+
+	uint8x8_t rgb[3][2];
+	for (int i = 0; i < 2; i++) {
+		int32x4_t yLo = vmlal_n_s16(round, vget_low_s16(y16[i]), coef.yScale);
+		int32x4_t yHi = vmlal_n_s16(round, vget_high_s16(y16[i]), coef.yScale);
+		rgb[0][i] = convert8(yLo, yHi, uu.val[i], vv.val[i], 0, coef.crR);
+		rgb[1][i] = convert8(yLo, yHi, uu.val[i], vv.val[i], (int16_t)-coef.cbG, (int16_t)-coef.crG);
+		rgb[2][i] = convert8(yLo, yHi, uu.val[i], vv.val[i], coef.cbB, 0);
+	}
+
+	r = vcombine_u8(rgb[0][0], rgb[0][1]);
+	g = vcombine_u8(rgb[1][0], rgb[1][1]);
+	b = vcombine_u8(rgb[2][0], rgb[2][1]);
+}
+
+template<bool isNV12, bool isRGBA>
+static void convertRow(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	const int pixelSize = isRGBA ? 4 : 3;
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16_t y8 = vld1q_u8(y + x);
+		uint8x8_t cb, cr;
+		if (isNV12) {
+			uint8x8x2_t uv = vld2_u8(u + x);
+			cb = uv.val[0];
+			cr = uv.val[1];
+		} else {
+			cb = vld1_u8(u + x / 2);
+			cr = vld1_u8(v + x / 2);
+		}
+
+		if (isRGBA) {
+			uint8x16x4_t rgba;
+			convert16(y8, cb, cr, coef, rgba.val[0], rgba.val[1], rgba.val[2]);
+			rgba.val[3] = vdupq_n_u8(255);
+			vst4q_u8(dst + x * pixelSize, rgba);
+		} else {
+			uint8x16x3_t rgb;
+			convert16(y8, cb, cr, coef, rgb.val[0], rgb.val[1], rgb.val[2]);
+			vst3q_u8(dst + x * pixelSize, rgb);
+		}
+	}
+
+	colorConvertRowTail<isNV12, isRGBA>(y, u, v, dst, x, width, coef);
+}
+
+void yuv420pToRGB24Row_NEON(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<false, false>(y, u, v, dst, width, coef);
+}
+
+void yuv420pToRGBARow_NEON(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<false, true>(y, u, v, dst, width, coef);
+}
+
+void nv12ToRGB24Row_NEON(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<true, false>(y, u, v, dst, width, coef);
+}
+
+void nv12ToRGBARow_NEON(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<true, true>(y, u, v, dst, width, coef);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,147 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "ColorConvert.h"
+
+#if defined(COLOR_CONVERT_X86)
+#include <emmintrin.h>
+#include <string.h>
+
+//	Coefficient pairs for _mm_madd_epi16. Luma is interleaved with 1 so the rounding term comes with the same madd.
+struct SSE2Coefs {
+	__m128i yOffset;
+	__m128i y;
+	__m128i r;
+	__m128i g;
+	__m128i b;
+};
+
+static inline __m128i pair(int lo, int hi) {
+	return _mm_set1_epi32((int)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo));
+}
+
+static inline SSE2Coefs makeCoefs(const ColorConvert::Coefficients& coef) {
+	SSE2Coefs k;
+	k.yOffset = _mm_set1_epi16(coef.yOffset);
+	k.y = pair(coef.yScale, 1 << 12);
+	k.r = pair(0, coef.crR);
+	k.g = pair(-coef.cbG, -coef.crG);
+	k.b = pair(coef.cbB, 0);
+	return k;
+}
+
+static inline __m128i madd2(__m128i yLo, __m128i yHi, __m128i uvLo, __m128i uvHi, __m128i coef) {
+	__m128i lo = _mm_srai_epi32(_mm_add_epi32(yLo, _mm_madd_epi16(uvLo, coef)), 13);
+	__m128i hi = _mm_srai_epi32(_mm_add_epi32(yHi, _mm_madd_epi16(uvHi, coef)), 13);
+	return _mm_packs_epi32(lo, hi);
+}
+
+//	8 pixels, y/u/v as 16-bit with offsets removed, results as 16-bit.
+static inline void convert8(__m128i y, __m128i u, __m128i v, const SSE2Coefs& k, __m128i& r, __m128i& g, __m128i& b) {
+	const __m128i one = _mm_set1_epi16(1);
+	__m128i yLo = _mm_madd_epi16(_mm_unpacklo_epi16(y, one), k.y);
+	__m128i yHi = _mm_madd_epi16(_mm_unpackhi_epi16(y, one), k.y);
+	__m128i uvLo = _mm_unpacklo_epi16(u, v);
+	__m128i uvHi = _mm_unpackhi_epi16(u, v);
+	r = madd2(yLo, yHi, uvLo, uvHi, k.r);
+	g = madd2(yLo, yHi, uvLo, uvHi, k.g);
+	b = madd2(yLo, yHi, uvLo, uvHi, k.b);
+}
+
+//	16 pixels, u16/v16 hold the 8 chroma samples as 16-bit.
+static inline void convert16(__m128i y8, __m128i u16, __m128i v16, const SSE2Coefs& k, __m128i& r, __m128i& g, __m128i& b) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i chromaOffset = _mm_set1_epi16(128);
+	__m128i yLo = _mm_sub_epi16(_mm_unpacklo_epi8(y8, zero), k.yOffset);
+	__m128i yHi = _mm_sub_epi16(_mm_unpackhi_epi8(y8, zero), k.yOffset);
+	u16 = _mm_sub_epi16(u16, chromaOffset);
+	v16 = _mm_sub_epi16(v16, chromaOffset);
+
+	__m128i rLo, gLo, bLo, rHi, gHi, bHi;
+	convert8(yLo, _mm_unpacklo_epi16(u16, u16), _mm_unpacklo_epi16(v16, v16), k, rLo, gLo, bLo);
+	convert8(yHi, _mm_unpackhi_epi16(u16, u16), _mm_unpackhi_epi16(v16, v16), k, rHi, gHi, bHi);
+	r = _mm_packus_epi16(rLo, rHi);
+	g = _mm_packus_epi16(gLo, gHi);
+	b = _mm_packus_epi16(bLo, bHi);
+}
+
+//	Pack 4 RGBA pixels into 12 RGB bytes without SSSE3 shuffles.
+static inline void storeRGB4(uint8_t* dst, __m128i rgba) {
+	const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i lowDwords = _mm_set_epi32(0, -1, 0, -1);
+	rgba = _mm_and_si128(rgba, rgbMask);
+	__m128i packed = _mm_or_si128(_mm_and_si128(rgba, lowDwords), _mm_srli_epi64(_mm_andnot_si128(lowDwords, rgba), 8));
+	__m128i out = _mm_or_si128(_mm_move_epi64(packed), _mm_slli_si128(_mm_srli_si128(packed, 8), 6));
+	_mm_storel_epi64((__m128i*)dst, out);
+	int tail = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+	memcpy(dst + 8, &tail, 4);
+}
+
+template<bool isRGBA>
+static inline void store16(uint8_t* dst, __m128i r, __m128i g, __m128i b) {
+	const __m128i a = _mm_set1_epi8((char)0xFF);
+	__m128i rgLo = _mm_unpacklo_epi8(r, g);
+	__m128i rgHi = _mm_unpackhi_epi8(r, g);
+	__m128i baLo = _mm_unpacklo_epi8(b, a);
+	__m128i baHi = _mm_unpackhi_epi8(b, a);
+	__m128i q0 = _mm_unpacklo_epi16(rgLo, baLo);
+	__m128i q1 = _mm_unpackhi_epi16(rgLo, baLo);
+	__m128i q2 = _mm_unpacklo_epi16(rgHi, baHi);
+	__m128i q3 = _mm_unpackhi_epi16(rgHi, baHi);
+	if (isRGBA) {
+		_mm_storeu_si128((__m128i*)dst, q0);
+		_mm_storeu_si128((__m128i*)(dst + 16), q1);
+		_mm_storeu_si128((__m128i*)(dst + 32), q2);
+		_mm_storeu_si128((__m128i*)(dst + 48), q3);
+	} else {
+		storeRGB4(dst, q0);
+		storeRGB4(dst + 12, q1);
+		storeRGB4(dst + 24, q2);
+		storeRGB4(dst + 36, q3);
+	}
+}
+
+template<bool isNV12, bool isRGBA>
+static void convertRow(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	const int pixelSize = isRGBA ? 4 : 3;
+	SSE2Coefs k = makeCoefs(coef);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i y8 = _mm_loadu_si128((const __m128i*)(y + x));
+		__m128i u16, v16;
+		if (isNV12) {
+			__m128i uv = _mm_loadu_si128((const __m128i*)(u + x));
+			u16 = _mm_and_si128(uv, lowBytes);
+			v16 = _mm_srli_epi16(uv, 8);
+		} else {
+			u16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(u + x / 2)), zero);
+			v16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(v + x / 2)), zero);
+		}
+
+		__m128i r, g, b;
+		convert16(y8, u16, v16, k, r, g, b);
+		store16<isRGBA>(dst + x * pixelSize, r, g, b);
+	}
+
+	colorConvertRowTail<isNV12, isRGBA>(y, u, v, dst, x, width, coef);
+}
+
+void yuv420pToRGB24Row_SSE2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<false, false>(y, u, v, dst, width, coef);
+}
+
+void yuv420pToRGBARow_SSE2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<false, true>(y, u, v, dst, width, coef);
+}
+
+void nv12ToRGB24Row_SSE2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<true, false>(y, u, v, dst, width, coef);
+}
+
+void nv12ToRGBARow_SSE2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, const ColorConvert::Coefficients& coef) {
+	convertRow<true, true>(y, u, v, dst, width, coef);
+}
+
+#endif
\ No newline at end of file
@@ -2,10 +2,56 @@
 
 #include "DecoderFFmpeg.h"
 #include "Logger.h"
-#include <fstream>
-#include <string>
+#include "ColorConvert.h"
+#include "SliceWorkerPool.h"
+#include "Tracer.h"
+#include "CodecThreadBudget.h"
+#include <algorithm>
+#include <cmath>
+
+static int64_t steadyNowMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point since) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+//	With a cap at or below this share of the source rate, non-reference frames are not even decoded.
+//	Even one B frame in four is enough to leave the kept frames above the cap in usual GOP structures.
+static const double CAP_SKIP_NONREF_RATIO = 0.25;
+
+//	Live mode, frames this far behind the live clock are dropped and the queues hold about this long.
+static const double LIVE_LATE_SECONDS = 0.1;
+static const double LIVE_QUEUE_SECONDS = 0.15;
+
+//	Frames the host may hold at once, more is most likely a host leaking leases.
+static const int MAX_VIDEO_LEASES = 8;
+
+static AVSampleFormat getOutputSampleFormat(int audioOutputFormat) {
+	switch (audioOutputFormat) {
+	case AUDIO_OUTPUT_S16:
+		return AV_SAMPLE_FMT_S16;
+	case AUDIO_OUTPUT_FLTP:
+		return AV_SAMPLE_FMT_FLTP;
+	default:
+		return AV_SAMPLE_FMT_FLT;	//	For Unity format.
+	}
+}
+
+static void resetStartupTimings(IDecoder::StartupTimings& timings) {
+	timings.open = -1;
+	timings.streamInfo = -1;
+	timings.codecOpen = -1;
+	timings.firstPacket = -1;
+	timings.firstFrame = -1;
+}
 
-DecoderFFmpeg::DecoderFFmpeg() {
+DecoderFFmpeg::DecoderFFmpeg(int traceId, const NativeDecoderOptions* options) {
+	mTraceId = traceId;
+	mOptions = options != nullptr ? *options : DecoderOptions::getDefaults();
+	DecoderOptions::sanitize(mOptions);
+	mPriority = (CodecThreadBudget::Priority)mOptions.priority;
 	mAVFormatContext = nullptr;
 	mVideoStream = nullptr;
 	mAudioStream = nullptr;
@@ -16,16 +62,33 @@ DecoderFFmpeg::DecoderFFmpeg() {
 	av_init_packet(&mPacket);
 
 	mSwrContext = nullptr;
-
-	mVideoBuffMax = 64;
-	mAudioBuffMax = 128;
+	mVideoConverter = nullptr;
+	mVideoBufferPool = nullptr;
+	mVideoBufferSize = 0;
 
 	memset(&mVideoInfo, 0, sizeof(VideoInfo));
 	memset(&mAudioInfo, 0, sizeof(AudioInfo));
 	mIsInitialized = false;
 	mIsAudioAllChEnabled = false;
-	mUseTCP = false;
-	mIsSeekToAny = false;
+	mIsInterrupted = false;
+	mIODeadline = 0;
+	mVideoSkipUntil = -1;
+	mAudioSkipUntil = -1;
+	mIsStreamToggled = false;
+	mIsVideoDemuxed = false;
+	mIsAudioDemuxed = false;
+	mIsEndOfStream = false;
+	mIsUnderrun = false;
+	mSeekStartUs = -1;
+	mVideoBuffTarget = mOptions.videoBufferMax;
+	mAudioBuffTarget = mOptions.audioBufferMax;
+	mVideoFrameRate = 30.0;
+	mMaxFrameRate = 0.0;
+	mCapNextTime = -1;
+	mAudioFrameSeconds = 0.0;
+	mUnderrunsSeen = 0;
+	mLiveClock = -1;
+	resetStartupTimings(mStartupTimings);
 }
 
 DecoderFFmpeg::~DecoderFFmpeg() {
@@ -33,86 +96,159 @@ DecoderFFmpeg::~DecoderFFmpeg() {
 }
 
 bool DecoderFFmpeg::init(const char* filePath) {
+	TRACE_SCOPE("init", mTraceId);
 	if (mIsInitialized) {
-		LOG("Decoder has been init. \n");
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Decoder has been init. \n");
 		return true;
 	}
 
 	if (filePath == nullptr) {
-		LOG("File path is nullptr. \n");
+		LOG_ERROR(Logger::CATEGORY_DECODER, "File path is nullptr. \n");
 		return false;
 	}
 
+	mFilePath = filePath;
+	mInitStartTime = std::chrono::steady_clock::now();
+	LOG_INFO(Logger::CATEGORY_DECODER, "Color conversion kernel: %s, slice threads: %d \n", ColorConvert::getKernelName(ColorConvert::getKernel()),
+		SliceWorkerPool::instance()->getThreadCount() + 1);
+	resetStartupTimings(mStartupTimings);
+
 	av_register_all();
 
 	if (mAVFormatContext == nullptr) {
 		mAVFormatContext = avformat_alloc_context();
 	}
-
-	int errorCode = 0;
-	errorCode = loadConfig();
-	if (errorCode < 0) {
-		LOG("config loading error. \n");
-		LOG("Use default settings. \n");
-		mVideoBuffMax = 64;
-		mAudioBuffMax = 128;
-		mUseTCP = false;
-		mIsSeekToAny = false;
+	mAVFormatContext->interrupt_callback.callback = interruptCallback;
+	mAVFormatContext->interrupt_callback.opaque = this;
+
+	//	Local files are served from a mapping shared by every decoder of the path, libavformat then skips the file protocol.
+	mMappedInput = mOptions.mappedInput ? MappedInput::open(filePath) : nullptr;
+	if (mMappedInput != nullptr) {
+		mAVFormatContext->pb = mMappedInput->getIOContext();
+		mAVFormatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+		LOG_INFO(Logger::CATEGORY_IO, "Memory mapped input. \n");
 	}
 
+	int errorCode = 0;
 	AVDictionary* opts = nullptr;
-	if (mUseTCP) {
+	if (mOptions.useTCP) {
 		av_dict_set(&opts, "rtsp_transport", "tcp", 0);
 	}
+	if (mOptions.probeSize > 0) {
+		av_dict_set_int(&opts, "probesize", mOptions.probeSize, 0);
+	}
+	if (mOptions.analyzeDurationUs > 0) {
+		av_dict_set_int(&opts, "analyzeduration", mOptions.analyzeDurationUs, 0);
+	}
+	if (mOptions.liveMode) {
+		//	Start at the newest data with little probing and no reordering buffer, stream info is completed while decoding.
+		av_dict_set(&opts, "fflags", "nobuffer", 0);
+		av_dict_set_int(&opts, "max_delay", 100000, 0);
+		av_dict_set_int(&opts, "live_start_index", -1, 0);
+		if (mOptions.probeSize <= 0) {
+			av_dict_set_int(&opts, "probesize", 32768, 0);
+		}
+		if (mOptions.analyzeDurationUs <= 0) {
+			av_dict_set_int(&opts, "analyzeduration", 500000, 0);
+		}
+	}
+	if (mOptions.ioBufferSize > 0) {
+		//	Socket receive buffers of the UDP and TCP protocols, other protocols ignore them.
+		av_dict_set_int(&opts, "buffer_size", mOptions.ioBufferSize, 0);
+		av_dict_set_int(&opts, "recv_buffer_size", mOptions.ioBufferSize, 0);
+	}
 	
+	//	The open timeout covers both opening the input and probing the streams.
+	setIODeadline(mOptions.openTimeoutMs);
+	std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
 	errorCode = avformat_open_input(&mAVFormatContext, filePath, nullptr, &opts);
 	av_dict_free(&opts);
 	if (errorCode < 0) {
-		LOG("avformat_open_input error(%x). \n", errorCode);
+		LOG_ERROR(Logger::CATEGORY_IO, "avformat_open_input error(%x). \n", errorCode);
 		printErrorMsg(errorCode);
 		return false;
 	}
+	mStartupTimings.open = elapsedMs(phaseStart);
 
+	phaseStart = std::chrono::steady_clock::now();
 	errorCode = avformat_find_stream_info(mAVFormatContext, nullptr);
+	setIODeadline(0);
 	if (errorCode < 0) {
-		LOG("avformat_find_stream_info error(%x). \n", errorCode);
+		LOG_ERROR(Logger::CATEGORY_IO, "avformat_find_stream_info error(%x). \n", errorCode);
 		printErrorMsg(errorCode);
 		return false;
 	}
+	mStartupTimings.streamInfo = elapsedMs(phaseStart);
 
+	return openStreams();
+}
+
+//	Selects and opens the video and audio stream of the opened input, also used by resume when the input was kept.
+bool DecoderFFmpeg::openStreams() {
+	std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+	int errorCode = 0;
 	double ctxDuration = (double)(mAVFormatContext->duration) / AV_TIME_BASE;
 
 	/* Video initialization */
 	int videoStreamIndex = av_find_best_stream(mAVFormatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
 	if (videoStreamIndex < 0) {
-		LOG("video stream not found. \n");
+		LOG_INFO(Logger::CATEGORY_VIDEO, "video stream not found. \n");
 		mVideoInfo.isEnabled = false;
 	} else {
 		mVideoInfo.isEnabled = true;
 		mVideoStream = mAVFormatContext->streams[videoStreamIndex];
-		mVideoCodecContext = mVideoStream->codec;
-		mVideoCodecContext->refcounted_frames = 1;
-		mVideoCodec = avcodec_find_decoder(mVideoCodecContext->codec_id);
-		
-		if (mVideoCodec == nullptr) {
-			LOG("Video codec not available. \n");
-			return false;
+		AVCodec* videoDecoder = avcodec_find_decoder(mVideoStream->codecpar->codec_id);
+		CodecThreadBudget::Allocation threads = CodecThreadBudget::instance()->acquire(this, mVideoStream->codecpar->width,
+			mVideoStream->codecpar->height, mPriority, videoDecoder != nullptr ? videoDecoder->capabilities : 0, mOptions.codecThreads);
+		//	Frame threading delays every frame by one frame per thread, live sources decode with slice threads only.
+		int codecFlags = 0;
+		if (mOptions.liveMode) {
+			threads.threadType = FF_THREAD_SLICE;
+			codecFlags = AV_CODEC_FLAG_LOW_DELAY;
 		}
-		AVDictionary *autoThread = nullptr;
-		av_dict_set(&autoThread, "threads", "auto", 0);
-		errorCode = avcodec_open2(mVideoCodecContext, mVideoCodec, &autoThread);
-		av_dict_free(&autoThread);
-		if (errorCode < 0) {
-			LOG("Could not open video codec(%x). \n", errorCode);
-			printErrorMsg(errorCode);
-			return false;
+		mVideoCodecKey = CodecPool::makeKey(mVideoStream->codecpar, threads.threadCount, threads.threadType, codecFlags);
+
+		CodecPool::Entry pooled;
+		if (CodecPool::instance()->acquire(mVideoCodecKey, pooled)) {
+			LOG_INFO(Logger::CATEGORY_VIDEO, "Reuse pooled video codec. \n");
+			mVideoCodecContext = pooled.codecContext;
+			mVideoCodecContext->pkt_timebase = mVideoStream->time_base;
+			mVideoCodec = (AVCodec*)mVideoCodecContext->codec;
+			mVideoConverter = pooled.videoConverter;
+			mVideoBufferPool = pooled.bufferPool;
+			mVideoBufferSize = pooled.bufferSize;
+		} else {
+			AVDictionary *threadOptions = nullptr;
+			if (threads.threadCount > 0) {
+				av_dict_set_int(&threadOptions, "threads", threads.threadCount, 0);
+			} else {
+				av_dict_set(&threadOptions, "threads", "auto", 0);
+			}
+			av_dict_set_int(&threadOptions, "thread_type", threads.threadType, 0);
+			if (codecFlags & AV_CODEC_FLAG_LOW_DELAY) {
+				av_dict_set(&threadOptions, "flags", "low_delay", 0);
+			}
+			errorCode = openCodecContext(mVideoStream, &threadOptions, &mVideoCodec, &mVideoCodecContext);
+			av_dict_free(&threadOptions);
+			if (errorCode < 0) {
+				LOG_ERROR(Logger::CATEGORY_VIDEO, "Could not open video codec(%x). \n", errorCode);
+				printErrorMsg(errorCode);
+				return false;
+			}
+		}
+
+		if (mVideoConverter == nullptr) {
+			mVideoConverter = new VideoConverter();
 		}
+		mVideoConverter->setSliceThreshold(mOptions.sliceThresholdPixels);
 
 		//	Save the output video format
 		//	Duration / time_base = video time (seconds)
 		mVideoInfo.width = mVideoCodecContext->width;
 		mVideoInfo.height = mVideoCodecContext->height;
 		mVideoInfo.totalTime = mVideoStream->duration <= 0 ? ctxDuration : mVideoStream->duration * av_q2d(mVideoStream->time_base);
+		AVRational frameRate = av_guess_frame_rate(mAVFormatContext, mVideoStream, nullptr);
+		mVideoFrameRate = frameRate.num > 0 && frameRate.den > 0 ? av_q2d(frameRate) : 30.0;
 
 		//mVideoFrames.swap(decltype(mVideoFrames)());
 	}
@@ -120,29 +256,32 @@ bool DecoderFFmpeg::init(const char* filePath) {
 	/* Audio initialization */
 	int audioStreamIndex = av_find_best_stream(mAVFormatContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
 	if (audioStreamIndex < 0) {
-		LOG("audio stream not found. \n");
+		LOG_INFO(Logger::CATEGORY_AUDIO, "audio stream not found. \n");
 		mAudioInfo.isEnabled = false;
 	} else {
 		mAudioInfo.isEnabled = true;
 		mAudioStream = mAVFormatContext->streams[audioStreamIndex];
-		mAudioCodecContext = mAudioStream->codec;
-		mAudioCodec = avcodec_find_decoder(mAudioCodecContext->codec_id);
-
-		if (mAudioCodec == nullptr) {
-			LOG("Audio codec not available. \n");
-			return false;
-		}
-
-		errorCode = avcodec_open2(mAudioCodecContext, mAudioCodec, nullptr);
-		if (errorCode < 0) {
-			LOG("Could not open audio codec(%x). \n", errorCode);
-			printErrorMsg(errorCode);
-			return false;
+		mAudioCodecKey = CodecPool::makeKey(mAudioStream->codecpar, 0, 0);
+
+		CodecPool::Entry pooled;
+		if (CodecPool::instance()->acquire(mAudioCodecKey, pooled)) {
+			LOG_INFO(Logger::CATEGORY_AUDIO, "Reuse pooled audio codec. \n");
+			mAudioCodecContext = pooled.codecContext;
+			mAudioCodecContext->pkt_timebase = mAudioStream->time_base;
+			mAudioCodec = (AVCodec*)mAudioCodecContext->codec;
+			mSwrContext = pooled.swrContext;
+		} else {
+			errorCode = openCodecContext(mAudioStream, nullptr, &mAudioCodec, &mAudioCodecContext);
+			if (errorCode < 0) {
+				LOG_ERROR(Logger::CATEGORY_AUDIO, "Could not open audio codec(%x). \n", errorCode);
+				printErrorMsg(errorCode);
+				return false;
+			}
 		}
 
 		errorCode = initSwrContext();
 		if (errorCode < 0) {
-			LOG("Init SwrContext error.(%x) \n", errorCode);
+			LOG_ERROR(Logger::CATEGORY_AUDIO, "Init SwrContext error.(%x) \n", errorCode);
 			printErrorMsg(errorCode);
 			return false;
 		}
@@ -150,24 +289,91 @@ bool DecoderFFmpeg::init(const char* filePath) {
 		//mAudioFrames.swap(decltype(mAudioFrames)());
 	}
 
+	mStartupTimings.codecOpen = elapsedMs(phaseStart);
+	initStreamDiscard();
+	mLiveController.reset(mOptions.liveTargetDelayMs / 1000.0);
+	mLiveClock = -1;
+	mBufferController = BufferController();
+	applyBufferTarget();
 	mIsInitialized = true;
 
 	return true;
 }
 
+//	The decoder owns its codec contexts rather than using the deprecated stream->codec, so they can outlive the input in CodecPool.
+int DecoderFFmpeg::openCodecContext(AVStream* stream, AVDictionary** options, AVCodec** codec, AVCodecContext** codecContext) {
+	*codec = avcodec_find_decoder(stream->codecpar->codec_id);
+	if (*codec == nullptr) {
+		LOG_ERROR(Logger::CATEGORY_DECODER, "Codec not available. \n");
+		return AVERROR_DECODER_NOT_FOUND;
+	}
+
+	*codecContext = avcodec_alloc_context3(*codec);
+	if (*codecContext == nullptr) {
+		return AVERROR(ENOMEM);
+	}
+
+	int errorCode = avcodec_parameters_to_context(*codecContext, stream->codecpar);
+	if (errorCode < 0) {
+		return errorCode;
+	}
+
+	(*codecContext)->pkt_timebase = stream->time_base;
+	(*codecContext)->refcounted_frames = 1;
+	return avcodec_open2(*codecContext, *codec, options);
+}
+
 bool DecoderFFmpeg::decode() {
+	TRACE_SCOPE("decode", mTraceId);
 	if (!mIsInitialized) {
-		LOG("Not initialized. \n");
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Not initialized. \n");
 		return false;
 	}
 
+	bool isVideoResumed = false;
+	bool isAudioResumed = false;
+	if (applyStreamToggles(isVideoResumed, isAudioResumed)) {
+		resyncStreams(isVideoResumed, isAudioResumed);
+	}
+
 	if (!isBuffBlocked()) {
-		if (av_read_frame(mAVFormatContext, &mPacket) < 0) {
+		setIODeadline(mOptions.readTimeoutMs);
+		int64_t readStart = DecoderStats::nowUs();
+		int errorCode = 0;
+		{
+			TRACE_SCOPE("demux", mTraceId);
+			errorCode = av_read_frame(mAVFormatContext, &mPacket);
+		}
+		int64_t readUs = DecoderStats::nowUs() - readStart;
+		mStats.demuxTime.record(readUs);
+		setIODeadline(0);
+		if (errorCode < 0) {
+			if (errorCode == AVERROR_EXIT) {
+				LOG_WARNING(Logger::CATEGORY_IO, "Read interrupted or timed out. \n");
+			}
+			mIsEndOfStream = true;
 			updateVideoFrame();
-			LOG("End of file.\n");
+			LOG_INFO(Logger::CATEGORY_IO, "End of file.\n");
 			return false;
 		}
 
+		if (mStartupTimings.firstPacket < 0) {
+			mStartupTimings.firstPacket = elapsedMs(mInitStartTime);
+		}
+
+		if (mAVFormatContext->pb != nullptr) {
+			mStats.bytesRead.store(mAVFormatContext->pb->bytes_read, std::memory_order_relaxed);
+		} else {
+			mStats.bytesRead.fetch_add(mPacket.size, std::memory_order_relaxed);
+		}
+
+		//	Other streams are discarded, so every packet read moves the live edge.
+		int64_t packetTime = mPacket.pts != AV_NOPTS_VALUE ? mPacket.pts : mPacket.dts;
+		if (mOptions.liveMode && packetTime != AV_NOPTS_VALUE) {
+			AVStream* stream = mAVFormatContext->streams[mPacket.stream_index];
+			mLiveController.onMedia(av_q2d(stream->time_base) * packetTime, readStart + readUs);
+		}
+
 		if (mVideoInfo.isEnabled && mPacket.stream_index == mVideoStream->index) {
 			updateVideoFrame();
 		} else if (mAudioInfo.isEnabled && mPacket.stream_index == mAudioStream->index) {
@@ -175,8 +381,10 @@ bool DecoderFFmpeg::decode() {
 		}
 
 		av_packet_unref(&mPacket);
+		mBufferController.onPacket(readUs, DecoderStats::nowUs() - readStart);
 	}
 
+	updateBufferTarget();
 	return true;
 }
 
@@ -190,20 +398,22 @@ IDecoder::AudioInfo DecoderFFmpeg::getAudioInfo() {
 
 void DecoderFFmpeg::setVideoEnable(bool isEnable) {
 	if (mVideoStream == nullptr) {
-		LOG("Video stream not found. \n");
+		LOG_INFO(Logger::CATEGORY_VIDEO, "Video stream not found. \n");
 		return;
 	}
 
 	mVideoInfo.isEnabled = isEnable;
+	mIsStreamToggled = true;
 }
 
 void DecoderFFmpeg::setAudioEnable(bool isEnable) {
 	if (mAudioStream == nullptr) {
-		LOG("Audio stream not found. \n");
+		LOG_INFO(Logger::CATEGORY_AUDIO, "Audio stream not found. \n");
 		return;
 	}
 
 	mAudioInfo.isEnabled = isEnable;
+	mIsStreamToggled = true;
 }
 
 void DecoderFFmpeg::setAudioAllChDataEnable(bool isEnable) {
@@ -213,7 +423,7 @@ void DecoderFFmpeg::setAudioAllChDataEnable(bool isEnable) {
 
 int DecoderFFmpeg::initSwrContext() {
 	if (mAudioCodecContext == nullptr) {
-		LOG("Audio context is null. \n");
+		LOG_ERROR(Logger::CATEGORY_AUDIO, "Audio context is null. \n");
 		return -1;
 	}
 
@@ -221,17 +431,16 @@ int DecoderFFmpeg::initSwrContext() {
 	int64_t inChannelLayout = av_get_default_channel_layout(mAudioCodecContext->channels);
 	uint64_t outChannelLayout = mIsAudioAllChEnabled ? inChannelLayout : AV_CH_LAYOUT_STEREO;
 	AVSampleFormat inSampleFormat = mAudioCodecContext->sample_fmt;
-	AVSampleFormat outSampleFormat = AV_SAMPLE_FMT_FLT;
+	AVSampleFormat outSampleFormat = getOutputSampleFormat(mOptions.audioOutputFormat);
 	int inSampleRate = mAudioCodecContext->sample_rate;
 	int outSampleRate = inSampleRate;
 
+	//	An existing context, possibly taken from CodecPool, is reconfigured instead of reallocated.
 	if (mSwrContext != nullptr) {
 		swr_close(mSwrContext);
-		swr_free(&mSwrContext);
-		mSwrContext = nullptr;
 	}
 
-	mSwrContext = swr_alloc_set_opts(nullptr,
+	mSwrContext = swr_alloc_set_opts(mSwrContext,
 		outChannelLayout, outSampleFormat, outSampleRate,
 		inChannelLayout, inSampleFormat, inSampleRate,
 		0, nullptr);
@@ -244,43 +453,128 @@ int DecoderFFmpeg::initSwrContext() {
 	//	Save the output audio format
 	mAudioInfo.channels = av_get_channel_layout_nb_channels(outChannelLayout);
 	mAudioInfo.sampleRate = outSampleRate;
+	mAudioInfo.sampleFormat = mOptions.audioOutputFormat;
 	mAudioInfo.totalTime = mAudioStream->duration <= 0 ? (double)(mAVFormatContext->duration) / AV_TIME_BASE : mAudioStream->duration * av_q2d(mAudioStream->time_base);
 	
 	return errorCode;
 }
 
-double DecoderFFmpeg::getVideoFrame(void** frameData) {
+//	The frame leaves the queue here, so a flush after a seek can not free it while the host still reads it.
+bool DecoderFFmpeg::leaseVideoFrame(double time, NativeVideoLease& lease) {
+	memset(&lease, 0, sizeof(NativeVideoLease));
+	lease.time = -1;
 	std::lock_guard<std::mutex> lock(mVideoMutex);
-	
+
 	if (!mIsInitialized || mVideoFrames.size() == 0) {
-		LOG("Video frame not available. \n");
-        *frameData = nullptr;
-		return -1;
+		LOG_VERBOSE(Logger::CATEGORY_VIDEO, "Video frame not available. \n");
+		if (mIsInitialized && !mIsEndOfStream && !mIsUnderrun) {
+			mStats.bufferUnderruns.fetch_add(1, std::memory_order_relaxed);
+			mIsUnderrun = true;
+		}
+		return false;
+	}
+
+	if (mVideoLeases.getCount() >= MAX_VIDEO_LEASES) {
+		LOG_VERBOSE(Logger::CATEGORY_VIDEO, "Too many video frames leased, release one first. \n");
+		return false;
+	}
+
+	if (mOptions.liveMode) {
+		dropLateFrames(&mVideoFrames, mVideoStream);
+	}
+
+	//	Every frame followed by another frame that is already due would never be on screen.
+	double timeBase = av_q2d(mVideoStream->time_base);
+	if (time >= 0) {
+		size_t dropCount = 0;
+		while (mVideoFrames.size() > 1 && timeBase * av_frame_get_best_effort_timestamp(mVideoFrames[1]) <= time) {
+			AVFrame* frame = mVideoFrames.front();
+			av_frame_free(&frame);
+			mVideoFrames.pop_front();
+			dropCount++;
+		}
+		if (dropCount > 0) {
+			mStats.videoFramesDropped.fetch_add(dropCount, std::memory_order_relaxed);
+			updateBufferState();
+		}
+
+		if (timeBase * av_frame_get_best_effort_timestamp(mVideoFrames.front()) > time) {
+			return false;
+		}
 	}
 
 	AVFrame* frame = mVideoFrames.front();
-	*frameData = frame->data[0];
+	mVideoFrames.pop_front();
+	updateBufferState();
+	mIsUnderrun = false;
+
+	lease.time = timeBase * av_frame_get_best_effort_timestamp(frame);
+	lease.width = frame->width;
+	lease.height = frame->height;
+	lease.format = mOptions.videoOutputFormat;
+	for (int i = 0; i < 4 && frame->data[i] != nullptr; i++) {
+		lease.planes[i] = frame->data[i];
+		lease.strides[i] = frame->linesize[i];
+		lease.planeCount++;
+	}
+	lease.handle = mVideoLeases.add(frame);
+	mVideoInfo.lastTime = lease.time;
 
-	int64_t timeStamp = av_frame_get_best_effort_timestamp(frame);
-	double timeInSec = av_q2d(mVideoStream->time_base) * timeStamp;
-	mVideoInfo.lastTime = timeInSec;
+	return true;
+}
+
+bool DecoderFFmpeg::releaseVideoFrame(int64_t handle) {
+	if (!mVideoLeases.release(handle)) {
+		LOG_WARNING(Logger::CATEGORY_VIDEO, "Video lease %lld does not exist. \n", (long long)handle);
+		return false;
+	}
+	return true;
+}
 
-    printf("mVideoInfo.lastTime %f\n", timeInSec);
+double DecoderFFmpeg::getAudioFrame(unsigned char** outputFrame, int& frameSize) {
+	NativeAudioLayout layout;
+	double timeInSec = getAudioPlanes(outputFrame, 1, layout);
+	if (timeInSec >= 0) {
+		frameSize = layout.samples;
+	}
 
 	return timeInSec;
 }
 
-double DecoderFFmpeg::getAudioFrame(unsigned char** outputFrame, int& frameSize) {
+double DecoderFFmpeg::getAudioPlanes(unsigned char** planes, int maxPlanes, NativeAudioLayout& layout) {
 	std::lock_guard<std::mutex> lock(mAudioMutex);
+	memset(&layout, 0, sizeof(NativeAudioLayout));
+	for (int i = 0; i < maxPlanes; i++) {
+		planes[i] = nullptr;
+	}
+
 	if (!mIsInitialized || mAudioFrames.size() == 0) {
-		LOG("Audio frame not available. \n");
-		*outputFrame = nullptr;
+		LOG_VERBOSE(Logger::CATEGORY_AUDIO, "Audio frame not available. \n");
 		return -1;
 	}
 
+	if (mOptions.liveMode) {
+		dropLateFrames(&mAudioFrames, mAudioStream);
+		if (mAudioFrames.empty()) {
+			return -1;
+		}
+	}
+
+	//	Taken from the frame rather than mAudioInfo, frames queued before a channel change keep their layout.
 	AVFrame* frame = mAudioFrames.front();
-	*outputFrame = frame->data[0];
-	frameSize = frame->nb_samples;
+	AVSampleFormat format = (AVSampleFormat)frame->format;
+	bool isPlanar = av_sample_fmt_is_planar(format) != 0;
+	layout.sampleFormat = format == AV_SAMPLE_FMT_S16 ? AUDIO_OUTPUT_S16 : isPlanar ? AUDIO_OUTPUT_FLTP : AUDIO_OUTPUT_FLT;
+	layout.channels = av_get_channel_layout_nb_channels(frame->channel_layout);
+	layout.sampleRate = frame->sample_rate;
+	layout.samples = frame->nb_samples;
+	layout.bytesPerSample = av_get_bytes_per_sample(format);
+	layout.planeCount = isPlanar ? layout.channels : 1;
+	layout.planeSize = layout.samples * layout.bytesPerSample * (isPlanar ? 1 : layout.channels);
+	for (int i = 0; i < std::min(maxPlanes, layout.planeCount); i++) {
+		planes[i] = frame->extended_data[i];
+	}
+
 	int64_t timeStamp = av_frame_get_best_effort_timestamp(frame);
 	double timeInSec = av_q2d(mAudioStream->time_base) * timeStamp;
 	mAudioInfo.lastTime = timeInSec;
@@ -289,15 +583,25 @@ double DecoderFFmpeg::getAudioFrame(unsigned char** outputFrame, int& frameSize)
 }
 
 void DecoderFFmpeg::seek(double time) {
+	TRACE_SCOPE("seek", mTraceId);
 	if (!mIsInitialized) {
-		LOG("Not initialized. \n");
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Not initialized. \n");
 		return;
 	}
 
+	bool isVideoResumed = false;
+	bool isAudioResumed = false;
+	applyStreamToggles(isVideoResumed, isAudioResumed);
+	mVideoSkipUntil = -1;
+	mAudioSkipUntil = -1;
+	mIsEndOfStream = false;
+	mSeekStartUs = DecoderStats::nowUs();
+	mStats.seekCount.fetch_add(1, std::memory_order_relaxed);
+	mBufferController.reset();
 	uint64_t timeStamp = (uint64_t) time * AV_TIME_BASE;
 
-	if (0 > av_seek_frame(mAVFormatContext, -1, timeStamp, mIsSeekToAny ? AVSEEK_FLAG_ANY : AVSEEK_FLAG_BACKWARD)) {
-		LOG("Seek time fail.\n");
+	if (0 > av_seek_frame(mAVFormatContext, -1, timeStamp, mOptions.seekToAny ? AVSEEK_FLAG_ANY : AVSEEK_FLAG_BACKWARD)) {
+		LOG_ERROR(Logger::CATEGORY_DECODER, "Seek time fail.\n");
 		return;
 	}
 
@@ -339,34 +643,18 @@ int DecoderFFmpeg::getMetaData(char**& key, char**& value) {
 }
 
 void DecoderFFmpeg::destroy() {
-	if (mVideoCodecContext != nullptr) {
-		avcodec_close(mVideoCodecContext);
-		mVideoCodecContext = nullptr;
-	}
-	
-	if (mAudioCodecContext != nullptr) {
-		avcodec_close(mAudioCodecContext);
-		mAudioCodecContext = nullptr;
-	}
+	releaseCodecs();
 	
 	if (mAVFormatContext != nullptr) {
 		avformat_close_input(&mAVFormatContext);
 		avformat_free_context(mAVFormatContext);
 		mAVFormatContext = nullptr;
 	}
-	
-	if (mSwrContext != nullptr) {
-		swr_close(mSwrContext);
-		swr_free(&mSwrContext);
-		mSwrContext = nullptr;
-	}
+	mMappedInput = nullptr;
 	
 	flushBuffer(&mVideoFrames, &mVideoMutex);
 	flushBuffer(&mAudioFrames, &mAudioMutex);
 	
-	mVideoCodec = nullptr;
-	mAudioCodec = nullptr;
-	
 	mVideoStream = nullptr;
 	mAudioStream = nullptr;
 	av_packet_unref(&mPacket);
@@ -374,21 +662,306 @@ void DecoderFFmpeg::destroy() {
 	memset(&mVideoInfo, 0, sizeof(VideoInfo));
 	memset(&mAudioInfo, 0, sizeof(AudioInfo));
 	
+	mFilePath.clear();
 	mIsInitialized = false;
 	mIsAudioAllChEnabled = false;
-	mVideoBuffMax = 64;
-	mAudioBuffMax = 128;
-	mUseTCP = false;
-	mIsSeekToAny = false;
+	mIsInterrupted = false;
+	mIODeadline = 0;
+	mVideoSkipUntil = -1;
+	mAudioSkipUntil = -1;
+	mIsStreamToggled = false;
+	mIsVideoDemuxed = false;
+	mIsAudioDemuxed = false;
+	mIsEndOfStream = false;
+	mIsUnderrun = false;
+	mSeekStartUs = -1;
+	resetStartupTimings(mStartupTimings);
+}
+
+void DecoderFFmpeg::releaseCodecs() {
+	CodecThreadBudget::instance()->release(this);
+
+	//	Codecs of a successfully initialized decoder go back to the pool, CodecPool frees them when it is full.
+	CodecPool::Entry videoEntry = { mVideoCodecContext, mVideoConverter, mVideoBufferPool, mVideoBufferSize, nullptr };
+	if (mVideoCodecContext != nullptr && mIsInitialized) {
+		CodecPool::instance()->release(mVideoCodecKey, videoEntry);
+	} else {
+		CodecPool::freeEntry(videoEntry);
+	}
+	mVideoCodecContext = nullptr;
+	mVideoConverter = nullptr;
+	mVideoBufferPool = nullptr;
+	mVideoBufferSize = 0;
+
+	CodecPool::Entry audioEntry = { mAudioCodecContext, nullptr, nullptr, 0, mSwrContext };
+	if (mAudioCodecContext != nullptr && mSwrContext != nullptr && mIsInitialized) {
+		CodecPool::instance()->release(mAudioCodecKey, audioEntry);
+	} else {
+		CodecPool::freeEntry(audioEntry);
+	}
+	mAudioCodecContext = nullptr;
+	mSwrContext = nullptr;
+	mVideoCodec = nullptr;
+	mAudioCodec = nullptr;
+}
+
+//	Frees everything a paused decoder does not need: queued frames, codec contexts with their threads and the conversion state.
+//	The input stays open unless isCloseInput, closing it saves the demuxer buffers but resume has to reopen and probe again.
+//	The decode thread has to be stopped. Stream info and enable flags are kept, so the host can still query the format.
+bool DecoderFFmpeg::hibernate(bool isCloseInput) {
+	if (!mIsInitialized) {
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Not initialized. \n");
+		return false;
+	}
+
+	releaseCodecs();
+	flushBuffer(&mVideoFrames, &mVideoMutex);
+	flushBuffer(&mAudioFrames, &mAudioMutex);
+	av_packet_unref(&mPacket);
+
+	if (isCloseInput && mAVFormatContext != nullptr) {
+		avformat_close_input(&mAVFormatContext);
+		avformat_free_context(mAVFormatContext);
+		mAVFormatContext = nullptr;
+		mMappedInput = nullptr;
+		mVideoStream = nullptr;
+		mAudioStream = nullptr;
+	}
+
+	mIsInitialized = false;
+	mIsInterrupted = false;
+	mIODeadline = 0;
+	mVideoSkipUntil = -1;
+	mAudioSkipUntil = -1;
+	mIsEndOfStream = false;
+	mIsUnderrun = false;
+	mSeekStartUs = -1;
+	LOG_INFO(Logger::CATEGORY_DECODER, "Hibernated%s. \n", isCloseInput ? ", input closed" : "");
+	return true;
+}
+
+//	Reopens what hibernate freed and decodes forward from the key frame before position to the first frame at position.
+//	The codecs usually come back from CodecPool, so a resume right after hibernate skips the codec open. The stream
+//	toggles are the ones the host wants now, it may have changed them while hibernated.
+bool DecoderFFmpeg::resume(double position, bool isVideoEnabled, bool isAudioEnabled) {
+	TRACE_SCOPE("resume", mTraceId);
+	if (mIsInitialized || mFilePath.empty()) {
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Not hibernated. \n");
+		return false;
+	}
+
+	int64_t resumeStart = DecoderStats::nowUs();
+	bool isInputKept = mAVFormatContext != nullptr;
+	if (isInputKept) {
+		mInitStartTime = std::chrono::steady_clock::now();
+		resetStartupTimings(mStartupTimings);
+	}
+
+	std::string filePath = mFilePath;
+	if (!(isInputKept ? openStreams() : init(filePath.c_str()))) {
+		LOG_ERROR(Logger::CATEGORY_DECODER, "Resume fail. \n");
+		return false;
+	}
+
+	if (!isVideoEnabled) {
+		setVideoEnable(false);
+	}
+	if (!isAudioEnabled) {
+		setAudioEnable(false);
+	}
+
+	//	A kept input is at its last read position, preroll only seeks for a start time after the beginning.
+	if (isInputKept && position <= 0) {
+		seek(0);
+	}
+
+	if (!preroll(position)) {
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Resume preroll fail. \n");
+	}
+	mStats.resumeLatency.record(DecoderStats::nowUs() - resumeStart);
+	return true;
+}
+
+//	Abort pending and future blocking I/O. Safe to call from any thread, used to make stop and destroy return promptly.
+void DecoderFFmpeg::interrupt() {
+	mIsInterrupted = true;
+}
+
+void DecoderFFmpeg::setIODeadline(int timeout) {
+	mIODeadline = timeout > 0 ? steadyNowMs() + timeout : 0;
+}
+
+//	Polled by FFmpeg while blocked in I/O, a non-zero return makes the pending call fail with AVERROR_EXIT.
+int DecoderFFmpeg::interruptCallback(void* opaque) {
+	DecoderFFmpeg* decoder = (DecoderFFmpeg*)opaque;
+	if (decoder->mIsInterrupted) {
+		return 1;
+	}
+
+	int64_t deadline = decoder->mIODeadline;
+	return (deadline > 0 && steadyNowMs() > deadline) ? 1 : 0;
+}
+
+//	Decode until the first frame at or after startTime is converted and queued, so it is ready before the decode thread starts.
+//	Video frames are awaited when video is enabled, otherwise audio frames.
+bool DecoderFFmpeg::preroll(double startTime) {
+	if (!mIsInitialized) {
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Not initialized. \n");
+		return false;
+	}
+
+	if (!mVideoInfo.isEnabled && !mAudioInfo.isEnabled) {
+		LOG_WARNING(Logger::CATEGORY_DECODER, "No stream enabled. \n");
+		return false;
+	}
+
+	if (startTime > 0) {
+		seek(startTime);
+		mVideoSkipUntil = startTime;
+		mAudioSkipUntil = startTime;
+	}
+
+	bool isVideo = mVideoInfo.isEnabled;
+	std::deque<AVFrame*>* frameBuff = isVideo ? &mVideoFrames : &mAudioFrames;
+	std::mutex* mutex = isVideo ? &mVideoMutex : &mAudioMutex;
+	bool ret = true;
+	while (true) {
+		{
+			std::lock_guard<std::mutex> lock(*mutex);
+			if (!frameBuff->empty()) {
+				break;
+			}
+		}
+
+		if (isBuffBlocked() || !decode()) {
+			LOG_WARNING(Logger::CATEGORY_DECODER, "Preroll stopped before first frame. \n");
+			ret = false;
+			break;
+		}
+	}
+
+	mVideoSkipUntil = -1;
+	mAudioSkipUntil = -1;
+	return ret;
+}
+
+IDecoder::StartupTimings DecoderFFmpeg::getStartupTimings() {
+	return mStartupTimings;
+}
+
+bool DecoderFFmpeg::isSkippedFrame(AVFrame* frame, AVStream* stream) {
+	double skipUntil = stream == mVideoStream ? mVideoSkipUntil : mAudioSkipUntil;
+	if (mOptions.liveMode && mLiveClock >= 0) {
+		//	The live clock already passed these, converting them would only delay the frames that are due.
+		skipUntil = std::max(skipUntil, mLiveClock - LIVE_LATE_SECONDS);
+	}
+	if (skipUntil < 0) {
+		return false;
+	}
+
+	double timeInSec = av_q2d(stream->time_base) * av_frame_get_best_effort_timestamp(frame);
+	return timeInSec < skipUntil;
+}
+
+//	Only the selected video and audio stream are demuxed, packets of other audio tracks, subtitles and data streams
+//	are dropped inside the demuxer instead of being read and freed here.
+void DecoderFFmpeg::initStreamDiscard() {
+	for (unsigned int i = 0; i < mAVFormatContext->nb_streams; i++) {
+		AVStream* stream = mAVFormatContext->streams[i];
+		bool isSelected = (stream == mVideoStream && mVideoInfo.isEnabled) || (stream == mAudioStream && mAudioInfo.isEnabled);
+		stream->discard = isSelected ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+	}
+
+	mIsVideoDemuxed = mVideoStream != nullptr && mVideoInfo.isEnabled;
+	mIsAudioDemuxed = mAudioStream != nullptr && mAudioInfo.isEnabled;
+	mIsStreamToggled = false;
+}
+
+//	AVStream::discard is read by the demuxer, so the host only flags a toggle and the decode thread applies it between reads.
+//	A disabled stream drops its queue and codec state, a stale GOP would otherwise be decoded on resume.
+//	Returns true if a stream was resumed and needs a resync.
+bool DecoderFFmpeg::applyStreamToggles(bool& isVideoResumed, bool& isAudioResumed) {
+	if (!mIsStreamToggled.exchange(false)) {
+		return false;
+	}
+
+	bool isVideoWanted = mVideoStream != nullptr && mVideoInfo.isEnabled;
+	if (isVideoWanted != mIsVideoDemuxed) {
+		mVideoStream->discard = isVideoWanted ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+		if (mVideoCodecContext != nullptr) {
+			avcodec_flush_buffers(mVideoCodecContext);
+		}
+		flushBuffer(&mVideoFrames, &mVideoMutex);
+		mVideoInfo.lastTime = -1;
+		mVideoSkipUntil = -1;
+		mIsVideoDemuxed = isVideoWanted;
+		isVideoResumed = isVideoWanted;
+		LOG_INFO(Logger::CATEGORY_VIDEO, "Video stream %s. \n", isVideoWanted ? "resumed" : "discarded");
+	}
+
+	bool isAudioWanted = mAudioStream != nullptr && mAudioInfo.isEnabled;
+	if (isAudioWanted != mIsAudioDemuxed) {
+		mAudioStream->discard = isAudioWanted ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+		if (mAudioCodecContext != nullptr) {
+			avcodec_flush_buffers(mAudioCodecContext);
+		}
+		flushBuffer(&mAudioFrames, &mAudioMutex);
+		mAudioInfo.lastTime = -1;
+		mAudioSkipUntil = -1;
+		mIsAudioDemuxed = isAudioWanted;
+		isAudioResumed = isAudioWanted;
+		LOG_INFO(Logger::CATEGORY_AUDIO, "Audio stream %s. \n", isAudioWanted ? "resumed" : "discarded");
+	}
+
+	return isVideoResumed || isAudioResumed;
+}
+
+//	The packets of a resumed stream up to the read position were discarded, so the demuxer goes back to the key frame
+//	before the presented position. A resumed stream drops the frames before that position, a stream that kept playing
+//	drops the frames it already has queued, so its queue and the host are not interrupted.
+void DecoderFFmpeg::resyncStreams(bool isVideoResumed, bool isAudioResumed) {
+	double position = std::max({ mVideoInfo.lastTime, mAudioInfo.lastTime, 0.0 });
+	if (mIsVideoDemuxed) {
+		double queuedEnd = getQueuedEndTime(&mVideoFrames, &mVideoMutex, mVideoStream);
+		mVideoSkipUntil = (isVideoResumed || queuedEnd < 0) ? position : std::nextafter(queuedEnd, HUGE_VAL);
+	}
+	if (mIsAudioDemuxed) {
+		double queuedEnd = getQueuedEndTime(&mAudioFrames, &mAudioMutex, mAudioStream);
+		mAudioSkipUntil = (isAudioResumed || queuedEnd < 0) ? position : std::nextafter(queuedEnd, HUGE_VAL);
+	}
+
+	if (0 > av_seek_frame(mAVFormatContext, -1, (int64_t)(position * AV_TIME_BASE), AVSEEK_FLAG_BACKWARD)) {
+		LOG_WARNING(Logger::CATEGORY_DECODER, "Resync seek fail, resumed stream continues from the read position. \n");
+		return;
+	}
+
+	if (mIsVideoDemuxed && mVideoCodecContext != nullptr) {
+		avcodec_flush_buffers(mVideoCodecContext);
+	}
+	if (mIsAudioDemuxed && mAudioCodecContext != nullptr) {
+		avcodec_flush_buffers(mAudioCodecContext);
+	}
+	mIsEndOfStream = false;
+	mBufferController.reset();
+}
+
+//	Time of the newest queued frame, or of the presented frame if the queue is empty, -1 if there is none.
+double DecoderFFmpeg::getQueuedEndTime(std::deque<AVFrame*>* frameBuff, std::mutex* mutex, AVStream* stream) {
+	std::lock_guard<std::mutex> lock(*mutex);
+	if (frameBuff->empty()) {
+		return stream == mVideoStream ? mVideoInfo.lastTime : mAudioInfo.lastTime;
+	}
+
+	return av_q2d(stream->time_base) * av_frame_get_best_effort_timestamp(frameBuff->back());
 }
 
 bool DecoderFFmpeg::isBuffBlocked() {
 	bool ret = false;
-	if (mVideoInfo.isEnabled && mVideoFrames.size() >= mVideoBuffMax) {
+	if (mVideoInfo.isEnabled && mVideoFrames.size() >= mVideoBuffTarget) {
 		ret = true;
 	}
 
-	if (mAudioInfo.isEnabled && mAudioFrames.size() >= mAudioBuffMax) {
+	if (mAudioInfo.isEnabled && mAudioFrames.size() >= mAudioBuffTarget) {
 		ret = true;
 	}
 
@@ -396,11 +969,30 @@ bool DecoderFFmpeg::isBuffBlocked() {
 }
 
 void DecoderFFmpeg::updateVideoFrame() {
+	TRACE_SCOPE("updateVideoFrame", mTraceId);
+	applyFrameRateCap();
 	int isFrameAvailable = 0;
 	AVFrame* srcFrame = av_frame_alloc();
-	clock_t start = clock();
+	int64_t decodeStart = DecoderStats::nowUs();
 	if (avcodec_decode_video2(mVideoCodecContext, srcFrame, &isFrameAvailable, &mPacket) < 0) {
-		LOG("Error processing data. \n");
+		LOG_ERROR(Logger::CATEGORY_VIDEO, "Error processing data. \n");
+		return;
+	}
+	mStats.videoDecodeTime.record(DecoderStats::nowUs() - decodeStart);
+
+	if (isFrameAvailable) {
+		mStats.videoFramesDecoded.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (isFrameAvailable && isSkippedFrame(srcFrame, mVideoStream)) {
+		mStats.videoFramesDropped.fetch_add(1, std::memory_order_relaxed);
+		av_frame_free(&srcFrame);
+		return;
+	}
+
+	if (isFrameAvailable && isCappedFrame(srcFrame)) {
+		mStats.videoFramesCapped.fetch_add(1, std::memory_order_relaxed);
+		av_frame_free(&srcFrame);
 		return;
 	}
 
@@ -408,30 +1000,29 @@ void DecoderFFmpeg::updateVideoFrame() {
         int width = srcFrame->width;
         int height = srcFrame->height;
 
-        const AVPixelFormat dstFormat = AV_PIX_FMT_RGB24;
+        const AVPixelFormat dstFormat = mOptions.videoOutputFormat == VIDEO_OUTPUT_RGBA ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
         AVFrame* dstFrame = av_frame_alloc();
         av_frame_copy_props(dstFrame, srcFrame);
 
         dstFrame->format = dstFormat;
 
-        //av_image_alloc(dstFrame->data, dstFrame->linesize, dstFrame->width, dstFrame->height, dstFormat, 0)
+        //	Output buffers come from a pool and return to it when the frame is freed.
         int numBytes = avpicture_get_size(dstFormat, width, height);
-        AVBufferRef* buffer = av_buffer_alloc(numBytes*sizeof(uint8_t));
+        if (mVideoBufferPool == nullptr || mVideoBufferSize != numBytes) {
+            av_buffer_pool_uninit(&mVideoBufferPool);
+            mVideoBufferPool = av_buffer_pool_init(numBytes, av_buffer_alloc);
+            mVideoBufferSize = numBytes;
+        }
+        AVBufferRef* buffer = av_buffer_pool_get(mVideoBufferPool);
         avpicture_fill((AVPicture *)dstFrame,buffer->data,dstFormat,width,height);
         dstFrame->buf[0] = buffer;
 
-        SwsContext* conversion = sws_getContext(width,
-                                                height,
-                                                (AVPixelFormat)srcFrame->format,
-                                                width,
-                                                height,
-                                                dstFormat,
-                                                SWS_FAST_BILINEAR,
-                                                nullptr,
-                                                nullptr,
-                                                nullptr);
-        sws_scale(conversion, srcFrame->data, srcFrame->linesize, 0, height, dstFrame->data, dstFrame->linesize);
-        sws_freeContext(conversion);
+        int64_t convertStart = DecoderStats::nowUs();
+        {
+            TRACE_SCOPE("convert", mTraceId);
+            mVideoConverter->convert(srcFrame, dstFrame, dstFormat);
+        }
+        mStats.conversionTime.record(DecoderStats::nowUs() - convertStart);
 
         dstFrame->format = dstFormat;
         dstFrame->width = srcFrame->width;
@@ -439,69 +1030,180 @@ void DecoderFFmpeg::updateVideoFrame() {
 
         av_frame_free(&srcFrame);
 
-        LOG("updateVideoFrame = %f\n", (float)(clock() - start) / CLOCKS_PER_SEC);
-
 		std::lock_guard<std::mutex> lock(mVideoMutex);
-		mVideoFrames.push(dstFrame);
+		mVideoFrames.push_back(dstFrame);
 		updateBufferState();
+		mBufferController.onMediaProduced(1.0 / getOutputFrameRate());
+
+		if (mSeekStartUs >= 0) {
+			mStats.seekLatency.record(DecoderStats::nowUs() - mSeekStartUs);
+			mSeekStartUs = -1;
+		}
+
+		if (mStartupTimings.firstFrame < 0) {
+			mStartupTimings.firstFrame = elapsedMs(mInitStartTime);
+		}
 	}
 }
 
 void DecoderFFmpeg::updateAudioFrame() {
+	TRACE_SCOPE("updateAudioFrame", mTraceId);
 	int isFrameAvailable = 0;
 	AVFrame* frameDecoded = av_frame_alloc();
+	int64_t decodeStart = DecoderStats::nowUs();
 	if (avcodec_decode_audio4(mAudioCodecContext, frameDecoded, &isFrameAvailable, &mPacket) < 0) {
-		LOG("Error processing data. \n");
+		LOG_ERROR(Logger::CATEGORY_AUDIO, "Error processing data. \n");
+		return;
+	}
+	mStats.audioDecodeTime.record(DecoderStats::nowUs() - decodeStart);
+
+	if (isFrameAvailable) {
+		mStats.audioFramesDecoded.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (isFrameAvailable && frameDecoded->sample_rate > 0) {
+		mAudioFrameSeconds = (double)frameDecoded->nb_samples / frameDecoded->sample_rate;
+	}
+
+	if (isFrameAvailable && isSkippedFrame(frameDecoded, mAudioStream)) {
+		av_frame_free(&frameDecoded);
 		return;
 	}
 
 	AVFrame* frame = av_frame_alloc();
 	frame->sample_rate = frameDecoded->sample_rate;
 	frame->channel_layout = av_get_default_channel_layout(mAudioInfo.channels);
-	frame->format = AV_SAMPLE_FMT_FLT;	//	For Unity format.
+	frame->format = getOutputSampleFormat(mOptions.audioOutputFormat);
 	frame->best_effort_timestamp = frameDecoded->best_effort_timestamp;
 	swr_convert_frame(mSwrContext, frame, frameDecoded);
 
 	std::lock_guard<std::mutex> lock(mAudioMutex);
-	mAudioFrames.push(frame);
+	mAudioFrames.push_back(frame);
 	updateBufferState();
 	av_frame_free(&frameDecoded);
-}
 
-void DecoderFFmpeg::freeVideoFrame() {
-	freeFrontFrame(&mVideoFrames, &mVideoMutex);
+	if (!mVideoInfo.isEnabled) {
+		mBufferController.onMediaProduced(mAudioFrameSeconds);
+	}
+
+	if (!mVideoInfo.isEnabled && mStartupTimings.firstFrame < 0) {
+		mStartupTimings.firstFrame = elapsedMs(mInitStartTime);
+	}
+
+	if (!mVideoInfo.isEnabled && mSeekStartUs >= 0) {
+		mStats.seekLatency.record(DecoderStats::nowUs() - mSeekStartUs);
+		mSeekStartUs = -1;
+	}
 }
 
 void DecoderFFmpeg::freeAudioFrame() {
 	freeFrontFrame(&mAudioFrames, &mAudioMutex);
 }
 
-void DecoderFFmpeg::freeFrontFrame(std::queue<AVFrame*>* frameBuff, std::mutex* mutex) {
+void DecoderFFmpeg::freeFrontFrame(std::deque<AVFrame*>* frameBuff, std::mutex* mutex) {
 	std::lock_guard<std::mutex> lock(*mutex);
 	if (!mIsInitialized || frameBuff->size() == 0) {
-		LOG("Not initialized or buffer empty. \n");
+		LOG_VERBOSE(Logger::CATEGORY_DECODER, "Not initialized or buffer empty. \n");
 		return;
 	}
 
 	AVFrame* frame = frameBuff->front();
 	av_frame_free(&frame);
-	frameBuff->pop();
+	frameBuff->pop_front();
 	updateBufferState();
 }
 
 //	frameBuff.clear would only clean the pointer rather than whole resources. So we need to clear frameBuff by ourself.
-void DecoderFFmpeg::flushBuffer(std::queue<AVFrame*>* frameBuff, std::mutex* mutex) {
+void DecoderFFmpeg::flushBuffer(std::deque<AVFrame*>* frameBuff, std::mutex* mutex) {
 	std::lock_guard<std::mutex> lock(*mutex);
+	if (frameBuff == &mVideoFrames && mIsInitialized) {
+		mStats.videoFramesDropped.fetch_add(frameBuff->size(), std::memory_order_relaxed);
+	}
+
 	while (!frameBuff->empty()) {
 		av_frame_free(&(frameBuff->front()));
-		frameBuff->pop();
+		frameBuff->pop_front();
 	}
+	mStats.updateQueueDepth(mVideoFrames.size(), mAudioFrames.size());
+}
+
+//	Approximate bytes held by the queued frames.
+int64_t DecoderFFmpeg::getBufferSize(std::deque<AVFrame*>* frameBuff, std::mutex* mutex) {
+	std::lock_guard<std::mutex> lock(*mutex);
+	int64_t bytes = 0;
+	for (AVFrame* frame : *frameBuff) {
+		for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i] != nullptr; i++) {
+			bytes += frame->buf[i]->size;
+		}
+	}
+
+	return bytes;
+}
+
+//	Takes effect when the video codec opens, so it has to be set before init reaches it.
+void DecoderFFmpeg::setPriority(int priority) {
+	priority = std::max((int)CodecThreadBudget::PRIORITY_LOW, std::min(priority, (int)CodecThreadBudget::PRIORITY_HIGH));
+	mPriority = (CodecThreadBudget::Priority)priority;
+}
+
+void DecoderFFmpeg::setMaxFrameRate(double frameRate) {
+	mMaxFrameRate = std::max(frameRate, 0.0);
+}
+
+double DecoderFFmpeg::getOutputFrameRate() {
+	double maxFrameRate = mMaxFrameRate;
+	return maxFrameRate > 0.0 ? std::min(maxFrameRate, mVideoFrameRate) : mVideoFrameRate;
+}
+
+//	Reapplied before every video packet, so a codec context taken from CodecPool drops a previous owner's setting too.
+void DecoderFFmpeg::applyFrameRateCap() {
+	double maxFrameRate = mMaxFrameRate;
+	AVDiscard skipFrame = maxFrameRate > 0.0 && maxFrameRate <= mVideoFrameRate * CAP_SKIP_NONREF_RATIO ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+	if (mVideoCodecContext->skip_frame != skipFrame) {
+		mVideoCodecContext->skip_frame = skipFrame;
+		LOG_VERBOSE(Logger::CATEGORY_VIDEO, "Frame rate cap %.1f, non-reference frames %s. \n", maxFrameRate, skipFrame == AVDISCARD_NONREF ? "skipped" : "decoded");
+	}
+}
+
+//	Keeps the frames on a 1 / cap grid. Half a source frame early still counts as on time, so a 60 fps source capped
+//	at 30 keeps exactly every other frame. Timestamps are untouched, the kept frames are presented at their own time.
+bool DecoderFFmpeg::isCappedFrame(AVFrame* frame) {
+	double maxFrameRate = mMaxFrameRate;
+	if (maxFrameRate <= 0.0 || maxFrameRate >= mVideoFrameRate) {
+		mCapNextTime = -1;
+		return false;
+	}
+
+	double interval = 1.0 / maxFrameRate;
+	double timeInSec = av_q2d(mVideoStream->time_base) * av_frame_get_best_effort_timestamp(frame);
+	//	A seek, a loop or a gap moved the time off the grid, it restarts at this frame.
+	if (mCapNextTime < 0 || timeInSec < mCapNextTime - 2 * interval || timeInSec > mCapNextTime + interval) {
+		mCapNextTime = timeInSec + interval;
+		return false;
+	}
+
+	if (timeInSec < mCapNextTime - 0.5 / mVideoFrameRate) {
+		return true;
+	}
+	mCapNextTime += interval;
+	return false;
+}
+
+DecoderStats* DecoderFFmpeg::getStats() {
+	return &mStats;
+}
+
+int64_t DecoderFFmpeg::getMemoryUsage() {
+	return getBufferSize(&mVideoFrames, &mVideoMutex) + getBufferSize(&mAudioFrames, &mAudioMutex);
 }
 
 //	Record buffer state either FULL or EMPTY. It would be considered by ViveMediaDecoder.cs for buffering judgement.
+//	FULL means the adaptive target is reached, which is the depth expected to play smoothly.
 void DecoderFFmpeg::updateBufferState() {
+	mStats.updateQueueDepth(mVideoFrames.size(), mAudioFrames.size());
+
 	if (mVideoInfo.isEnabled) {
-		if (mVideoFrames.size() >= mVideoBuffMax) {
+		if (mVideoFrames.size() >= mVideoBuffTarget) {
 			mVideoInfo.bufferState = BufferState::FULL;
 		} else if(mVideoFrames.size() == 0) {
 			mVideoInfo.bufferState = BufferState::EMPTY;
@@ -511,7 +1213,7 @@ void DecoderFFmpeg::updateBufferState() {
 	}
 
 	if (mAudioInfo.isEnabled) {
-		if (mAudioFrames.size() >= mAudioBuffMax) {
+		if (mAudioFrames.size() >= mAudioBuffTarget) {
 			mAudioInfo.bufferState = BufferState::FULL;
 		} else if (mAudioFrames.size() == 0) {
 			mAudioInfo.bufferState = BufferState::EMPTY;
@@ -521,46 +1223,90 @@ void DecoderFFmpeg::updateBufferState() {
 	}
 }
 
-int DecoderFFmpeg::loadConfig() {
-	std::ifstream configFile("config", std::ifstream::in);
-	if (!configFile) {
-		LOG("config does not exist.\n");
-		return -1;
+//	Called on the decode thread after every pass. Underruns while a seek or the first frame is pending are expected and ignored.
+void DecoderFFmpeg::updateBufferTarget() {
+	int64_t underruns = mStats.bufferUnderruns.load(std::memory_order_relaxed);
+	if (underruns < mUnderrunsSeen) {
+		mUnderrunsSeen = underruns;
 	}
-
-	enum CONFIG { NONE, USE_TCP, BUFF_MIN, BUFF_MAX };
-	int buffVideoMax = 0, buffAudioMax = 0, tcp = 0, seekAny = 0;
-	std::string line;
-	while (configFile >> line) {
-		std::string token = line.substr(0, line.find("="));
-		CONFIG config = NONE;
-		std::string value = line.substr(line.find("=") + 1);
-		try {
-			if (token == "USE_TCP") { tcp = stoi(value); }
-			else if (token == "BUFF_VIDEO_MAX") { buffVideoMax = stoi(value); }
-			else if (token == "BUFF_AUDIO_MAX") { buffAudioMax = stoi(value); }
-			else if (token == "SEEK_ANY") { seekAny = stoi(value); }
-		
-		} catch (...) {
-			return -1;
+	if (underruns > mUnderrunsSeen) {
+		if (mSeekStartUs < 0 && mStartupTimings.firstFrame >= 0) {
+			mBufferController.onUnderrun();
 		}
+		mUnderrunsSeen = underruns;
+	}
+
+	if (mBufferController.update(DecoderStats::nowUs())) {
+		applyBufferTarget();
+	}
+}
+
+//	Live sources keep tiny queues regardless of the measured throughput, every queued frame is latency.
+void DecoderFFmpeg::applyBufferTarget() {
+	double seconds = mOptions.liveMode ? LIVE_QUEUE_SECONDS : mBufferController.getTargetSeconds();
+	unsigned int videoMin = mOptions.liveMode ? 2 : mOptions.videoBufferMin;
+	unsigned int audioMin = mOptions.liveMode ? 4 : mOptions.audioBufferMin;
+	unsigned int videoTarget = BufferController::toFrames(seconds, getOutputFrameRate(), videoMin, mOptions.videoBufferMax);
+	double audioFramesPerSecond = mAudioFrameSeconds > 0.0 ? 1.0 / mAudioFrameSeconds : mOptions.audioBufferMax;
+	unsigned int audioTarget = BufferController::toFrames(seconds, audioFramesPerSecond, audioMin, mOptions.audioBufferMax);
+	if (videoTarget != mVideoBuffTarget || audioTarget != mAudioBuffTarget) {
+		LOG_VERBOSE(Logger::CATEGORY_DECODER, "Buffer target %.2f s, video %u frames, audio %u frames. \n", seconds, videoTarget, audioTarget);
 	}
 
-	mUseTCP = tcp != 0;
-	mVideoBuffMax = buffVideoMax;
-	mAudioBuffMax = buffAudioMax;
-	mIsSeekToAny = seekAny != 0;
-	LOG("config loading success.\n");
-	LOG("USE_TCP=%s\n", mUseTCP ? "true" : "false");
-	LOG("BUFF_VIDEO_MAX=%d\n", mVideoBuffMax);
-	LOG("BUFF_AUDIO_MAX=%d\n", mAudioBuffMax);
-	LOG("SEEK_ANY=%s\n", mIsSeekToAny ? "true" : "false");
+	mVideoBuffTarget = videoTarget;
+	mAudioBuffTarget = audioTarget;
+	mStats.videoQueueTarget.store(videoTarget, std::memory_order_relaxed);
+	mStats.audioQueueTarget.store(audioTarget, std::memory_order_relaxed);
+}
+
+//	Called by the host with its playback clock, the returned clock is what is presented. Not live sources are not corrected.
+double DecoderFFmpeg::updateLiveClock(double hostTime) {
+	if (!mOptions.liveMode) {
+		return hostTime;
+	}
+
+	double clock = mLiveController.update(hostTime, DecoderStats::nowUs());
+	mLiveClock = clock;
+	return clock;
+}
 
-	return 0;
+bool DecoderFFmpeg::getLiveLatency(double& latency, double& rate) {
+	if (!mOptions.liveMode) {
+		return false;
+	}
+
+	latency = mLiveController.getLatency();
+	rate = mLiveController.getRate();
+	return true;
+}
+
+//	Called with the queue mutex held. The front frame is not leased here, the host grabs it after this returns.
+void DecoderFFmpeg::dropLateFrames(std::deque<AVFrame*>* frameBuff, AVStream* stream) {
+	double clock = mLiveClock;
+	if (clock < 0) {
+		return;
+	}
+
+	//	The newest video frame is kept, so there is always a frame to present.
+	size_t keep = frameBuff == &mVideoFrames ? 1 : 0;
+	while (frameBuff->size() > keep) {
+		AVFrame* frame = frameBuff->front();
+		double timeInSec = av_q2d(stream->time_base) * av_frame_get_best_effort_timestamp(frame);
+		if (timeInSec >= clock - LIVE_LATE_SECONDS) {
+			break;
+		}
+
+		if (frameBuff == &mVideoFrames) {
+			mStats.videoFramesDropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		av_frame_free(&frame);
+		frameBuff->pop_front();
+	}
+	updateBufferState();
 }
 
 void DecoderFFmpeg::printErrorMsg(int errorCode) {
 	char msg[500];
 	av_strerror(errorCode, msg, sizeof(msg));
-	LOG("Error massage: %s \n", msg);
+	LOG_ERROR(Logger::CATEGORY_DECODER, "Error massage: %s \n", msg);
 }
\ No newline at end of file
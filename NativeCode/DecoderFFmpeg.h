@@ -2,42 +2,63 @@
 
 #pragma once
 #include "IDecoder.h"
-#include <queue>
+#include "CodecPool.h"
+#include "BufferController.h"
+#include "CodecThreadBudget.h"
+#include "DecoderOptions.h"
+#include "FrameLeases.h"
+#include "LiveLatencyController.h"
+#include "MappedInput.h"
+#include <deque>
 #include <mutex>
-
-extern "C" {
-#include <libavformat/avformat.h>
-#include <libswresample/swresample.h>
-#include <libswscale/swscale.h>
-}
+#include <chrono>
+#include <atomic>
+#include <string>
 
 class DecoderFFmpeg : public virtual IDecoder
 {
 public:
-	DecoderFFmpeg();
+	//	Without options the process wide defaults of DecoderOptions are used.
+	DecoderFFmpeg(int traceId = -1, const NativeDecoderOptions* options = nullptr);
 	~DecoderFFmpeg();
 
 	bool init(const char* filePath);
 	bool decode();
 	void seek(double time);
 	void destroy();
+	bool preroll(double startTime);
+	void interrupt();
+	bool hibernate(bool isCloseInput);
+	bool resume(double position, bool isVideoEnabled, bool isAudioEnabled);
+	double updateLiveClock(double hostTime);
+	bool getLiveLatency(double& latency, double& rate);
 	
 	VideoInfo getVideoInfo();
 	AudioInfo getAudioInfo();
 	void setVideoEnable(bool isEnable);
 	void setAudioEnable(bool isEnable);
 	void setAudioAllChDataEnable(bool isEnable);
-	double getVideoFrame(void** frameData);
+	bool leaseVideoFrame(double time, NativeVideoLease& lease);
+	bool releaseVideoFrame(int64_t handle);
 	double getAudioFrame(unsigned char** outputFrame, int& frameSize);
-	void freeVideoFrame();
+	double getAudioPlanes(unsigned char** planes, int maxPlanes, NativeAudioLayout& layout);
 	void freeAudioFrame();
 
 	int getMetaData(char**& key, char**& value);
+	StartupTimings getStartupTimings();
+	int64_t getMemoryUsage();
+	DecoderStats* getStats();
+	void setPriority(int priority);
+	void setMaxFrameRate(double frameRate);
 	
 private:
 	bool mIsInitialized;
 	bool mIsAudioAllChEnabled;
-	bool mUseTCP;				//	For RTSP stream.
+	NativeDecoderOptions mOptions;
+	int mTraceId;				//	Decoder id attached to trace events.
+	std::string mFilePath;		//	Kept to reopen the input on resume.
+	std::unique_ptr<MappedInput> mMappedInput;	//	Custom IO of mAVFormatContext, outlives it.
+	std::atomic<CodecThreadBudget::Priority> mPriority;
 
 	AVFormatContext* mAVFormatContext;
 	AVStream*		mVideoStream;
@@ -46,16 +67,44 @@ private:
 	AVCodec*		mAudioCodec;
 	AVCodecContext*	mVideoCodecContext;
 	AVCodecContext*	mAudioCodecContext;
+	CodecPool::Key	mVideoCodecKey;
+	CodecPool::Key	mAudioCodecKey;
+	int openCodecContext(AVStream* stream, AVDictionary** options, AVCodec** codec, AVCodecContext** codecContext);
+	bool openStreams();
+	void releaseCodecs();
 
 	AVPacket	mPacket;
-	std::queue<AVFrame*> mVideoFrames;
-	std::queue<AVFrame*> mAudioFrames;
-	unsigned int mVideoBuffMax;
-	unsigned int mAudioBuffMax;
+	std::deque<AVFrame*> mVideoFrames;
+	std::deque<AVFrame*> mAudioFrames;
+	FrameLeases mVideoLeases;		//	Frames taken off mVideoFrames by the host, outlive flushes.
+	//	Queue depths between the configured bounds, FULL and the decode throttle follow these.
+	BufferController mBufferController;
+	std::atomic<unsigned int> mVideoBuffTarget;
+	std::atomic<unsigned int> mAudioBuffTarget;
+	double		mVideoFrameRate;
+	double getOutputFrameRate();
+	double		mAudioFrameSeconds;		//	Duration of the last decoded audio frame.
+	int64_t		mUnderrunsSeen;
+	void updateBufferTarget();
+	void applyBufferTarget();
+
+	//	Live mode only. The clock is the host time corrected by the controller, -1 until the host sets it.
+	LiveLatencyController mLiveController;
+	std::atomic<double> mLiveClock;
+	void dropLateFrames(std::deque<AVFrame*>* frameBuff, AVStream* stream);
 
 	SwrContext*	mSwrContext;
 	int initSwrContext();
 
+	VideoConverter*	mVideoConverter;
+	AVBufferPool*	mVideoBufferPool;	//	Output buffers of converted video frames.
+	int				mVideoBufferSize;
+
+	DecoderStats mStats;
+	std::atomic<bool> mIsEndOfStream;	//	The last read failed, so an empty video queue is not an underrun.
+	bool		mIsUnderrun;		//	An underrun is counted once until the next frame is presented.
+	int64_t		mSeekStartUs;		//	Pending seek latency measurement, -1 if none.
+
 	VideoInfo	mVideoInfo;
 	AudioInfo	mAudioInfo;
 	void updateBufferState();
@@ -65,13 +114,37 @@ private:
 	bool isBuffBlocked();
 	void updateVideoFrame();
 	void updateAudioFrame();
-	void freeFrontFrame(std::queue<AVFrame*>* frameBuff, std::mutex* mutex);
-	void flushBuffer(std::queue<AVFrame*>* frameBuff, std::mutex* mutex);
+	void freeFrontFrame(std::deque<AVFrame*>* frameBuff, std::mutex* mutex);
+	void flushBuffer(std::deque<AVFrame*>* frameBuff, std::mutex* mutex);
+	int64_t getBufferSize(std::deque<AVFrame*>* frameBuff, std::mutex* mutex);
 	std::mutex mVideoMutex;
 	std::mutex mAudioMutex;
-	
-	bool mIsSeekToAny;
 
-	int loadConfig();
+	std::atomic<bool> mIsInterrupted;
+	std::atomic<int64_t> mIODeadline;
+	void setIODeadline(int timeout);
+	static int interruptCallback(void* opaque);
+
+	std::chrono::steady_clock::time_point mInitStartTime;
+	StartupTimings mStartupTimings;
+	double mVideoSkipUntil;		//	Frames earlier than this are dropped before conversion, -1 to disable.
+	double mAudioSkipUntil;
+	bool isSkippedFrame(AVFrame* frame, AVStream* stream);
+
+	//	Set by the host at any time, the codec context is only touched on the decode thread.
+	std::atomic<double> mMaxFrameRate;
+	double mCapNextTime;		//	Earliest time of the next frame let through the cap, -1 to start at the next frame.
+	void applyFrameRateCap();
+	bool isCappedFrame(AVFrame* frame);
+
+	//	Streams the host disabled are discarded by the demuxer, the toggle is applied on the decode thread.
+	std::atomic<bool> mIsStreamToggled;
+	bool mIsVideoDemuxed;
+	bool mIsAudioDemuxed;
+	void initStreamDiscard();
+	bool applyStreamToggles(bool& isVideoResumed, bool& isAudioResumed);
+	void resyncStreams(bool isVideoResumed, bool isAudioResumed);
+	double getQueuedEndTime(std::deque<AVFrame*>* frameBuff, std::mutex* mutex, AVStream* stream);
+
 	void printErrorMsg(int errorCode);
 };
\ No newline at end of file
@@ -0,0 +1,147 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "DecoderOptions.h"
+#include "Logger.h"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace {
+	std::once_flag sOnce;
+	std::mutex sMutex;
+	NativeDecoderOptions sDefaults;
+
+	void loadDefaults() {
+		sDefaults = DecoderOptions::getBuiltInDefaults();
+		if (!DecoderOptions::loadFile("config", sDefaults)) {
+			LOG_WARNING(Logger::CATEGORY_GENERAL, "config loading error. \n");
+			LOG_WARNING(Logger::CATEGORY_GENERAL, "Use default settings. \n");
+			sDefaults = DecoderOptions::getBuiltInDefaults();
+		}
+	}
+}
+
+NativeDecoderOptions DecoderOptions::getDefaults() {
+	std::call_once(sOnce, loadDefaults);
+	std::lock_guard<std::mutex> lock(sMutex);
+	return sDefaults;
+}
+
+void DecoderOptions::setDefaults(const NativeDecoderOptions& options) {
+	std::call_once(sOnce, loadDefaults);
+	std::lock_guard<std::mutex> lock(sMutex);
+	sDefaults = options;
+	sanitize(sDefaults);
+}
+
+NativeDecoderOptions DecoderOptions::getBuiltInDefaults() {
+	NativeDecoderOptions options;
+	options.useTCP = 0;
+	options.seekToAny = 0;
+	options.videoBufferMin = 8;
+	options.videoBufferMax = 64;
+	options.audioBufferMin = 16;
+	options.audioBufferMax = 128;
+	options.openTimeoutMs = 10000;
+	options.readTimeoutMs = 0;
+	options.sliceThresholdPixels = 1920 * 1080;
+	options.videoOutputFormat = VIDEO_OUTPUT_RGB24;
+	options.codecThreads = 0;
+	options.priority = 1;
+	options.ioBufferSize = 0;
+	options.probeSize = 0;
+	options.analyzeDurationUs = 0;
+	options.liveMode = 0;
+	options.liveTargetDelayMs = 1000;
+	options.audioOutputFormat = AUDIO_OUTPUT_FLT;
+	options.mappedInput = 0;
+	return options;
+}
+
+//	Keys the file does not contain keep their value in options. On a parse error options is left unchanged.
+bool DecoderOptions::loadFile(const char* path, NativeDecoderOptions& options) {
+	std::ifstream configFile(path, std::ifstream::in);
+	if (!configFile) {
+		LOG_WARNING(Logger::CATEGORY_GENERAL, "config does not exist.\n");
+		return false;
+	}
+
+	NativeDecoderOptions loaded = options;
+	std::string line;
+	while (configFile >> line) {
+		std::string token = line.substr(0, line.find("="));
+		std::string value = line.substr(line.find("=") + 1);
+		try {
+			if (token == "USE_TCP") { loaded.useTCP = stoi(value); }
+			else if (token == "BUFF_VIDEO_MIN") { loaded.videoBufferMin = stoi(value); }
+			else if (token == "BUFF_VIDEO_MAX") { loaded.videoBufferMax = stoi(value); }
+			else if (token == "BUFF_AUDIO_MIN") { loaded.audioBufferMin = stoi(value); }
+			else if (token == "BUFF_AUDIO_MAX") { loaded.audioBufferMax = stoi(value); }
+			else if (token == "SEEK_ANY") { loaded.seekToAny = stoi(value); }
+			else if (token == "OPEN_TIMEOUT_MS") { loaded.openTimeoutMs = stoi(value); }
+			else if (token == "READ_TIMEOUT_MS") { loaded.readTimeoutMs = stoi(value); }
+			else if (token == "SLICE_THRESHOLD_PIXELS") { loaded.sliceThresholdPixels = stoll(value); }
+			else if (token == "VIDEO_OUTPUT_FORMAT") { loaded.videoOutputFormat = stoi(value); }
+			else if (token == "CODEC_THREADS") { loaded.codecThreads = stoi(value); }
+			else if (token == "PRIORITY") { loaded.priority = stoi(value); }
+			else if (token == "IO_BUFFER_SIZE") { loaded.ioBufferSize = stoi(value); }
+			else if (token == "PROBE_SIZE") { loaded.probeSize = stoll(value); }
+			else if (token == "ANALYZE_DURATION_US") { loaded.analyzeDurationUs = stoll(value); }
+			else if (token == "LIVE_MODE") { loaded.liveMode = stoi(value); }
+			else if (token == "LIVE_TARGET_DELAY_MS") { loaded.liveTargetDelayMs = stoi(value); }
+			else if (token == "AUDIO_OUTPUT_FORMAT") { loaded.audioOutputFormat = stoi(value); }
+			else if (token == "MAPPED_INPUT") { loaded.mappedInput = stoi(value); }
+		} catch (...) {
+			return false;
+		}
+	}
+
+	sanitize(loaded);
+	options = loaded;
+	LOG_INFO(Logger::CATEGORY_GENERAL, "config loading success.\n");
+	LOG_INFO(Logger::CATEGORY_GENERAL, "USE_TCP=%s\n", options.useTCP ? "true" : "false");
+	LOG_INFO(Logger::CATEGORY_GENERAL, "BUFF_VIDEO_MIN=%d\n", options.videoBufferMin);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "BUFF_VIDEO_MAX=%d\n", options.videoBufferMax);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "BUFF_AUDIO_MIN=%d\n", options.audioBufferMin);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "BUFF_AUDIO_MAX=%d\n", options.audioBufferMax);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "SEEK_ANY=%s\n", options.seekToAny ? "true" : "false");
+	LOG_INFO(Logger::CATEGORY_GENERAL, "OPEN_TIMEOUT_MS=%d\n", options.openTimeoutMs);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "READ_TIMEOUT_MS=%d\n", options.readTimeoutMs);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "SLICE_THRESHOLD_PIXELS=%lld\n", (long long)options.sliceThresholdPixels);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "VIDEO_OUTPUT_FORMAT=%d\n", options.videoOutputFormat);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "CODEC_THREADS=%d\n", options.codecThreads);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "PRIORITY=%d\n", options.priority);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "IO_BUFFER_SIZE=%d\n", options.ioBufferSize);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "PROBE_SIZE=%lld\n", (long long)options.probeSize);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "ANALYZE_DURATION_US=%lld\n", (long long)options.analyzeDurationUs);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "LIVE_MODE=%s\n", options.liveMode ? "true" : "false");
+	LOG_INFO(Logger::CATEGORY_GENERAL, "LIVE_TARGET_DELAY_MS=%d\n", options.liveTargetDelayMs);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "AUDIO_OUTPUT_FORMAT=%d\n", options.audioOutputFormat);
+	LOG_INFO(Logger::CATEGORY_GENERAL, "MAPPED_INPUT=%s\n", options.mappedInput ? "true" : "false");
+	return true;
+}
+
+//	Out of range values are clamped rather than rejected, so a host typo can not stop playback.
+void DecoderOptions::sanitize(NativeDecoderOptions& options) {
+	options.useTCP = options.useTCP != 0;
+	options.seekToAny = options.seekToAny != 0;
+	options.videoBufferMin = std::max(options.videoBufferMin, 1);
+	options.videoBufferMax = std::max(options.videoBufferMax, options.videoBufferMin);
+	options.audioBufferMin = std::max(options.audioBufferMin, 1);
+	options.audioBufferMax = std::max(options.audioBufferMax, options.audioBufferMin);
+	if (options.videoOutputFormat != VIDEO_OUTPUT_RGBA) {
+		options.videoOutputFormat = VIDEO_OUTPUT_RGB24;
+	}
+	options.codecThreads = std::max(options.codecThreads, 0);
+	options.priority = std::max(0, std::min(options.priority, 2));
+	options.ioBufferSize = std::max(options.ioBufferSize, 0);
+	options.probeSize = std::max<int64_t>(options.probeSize, 0);
+	options.analyzeDurationUs = std::max<int64_t>(options.analyzeDurationUs, 0);
+	options.liveMode = options.liveMode != 0;
+	options.liveTargetDelayMs = std::max(options.liveTargetDelayMs, 0);
+	if (options.audioOutputFormat != AUDIO_OUTPUT_S16 && options.audioOutputFormat != AUDIO_OUTPUT_FLTP) {
+		options.audioOutputFormat = AUDIO_OUTPUT_FLT;
+	}
+	options.mappedInput = options.mappedInput != 0;
+}
\ No newline at end of file
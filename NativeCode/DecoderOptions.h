@@ -0,0 +1,69 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+
+//	Per decoder settings handed over at creation, see FFMPEGDecoderWrapper.cs for the managed mirror.
+//	Zero in the sizes and limits below means the FFmpeg default.
+struct NativeDecoderOptions {
+	int32_t useTCP;					//	RTSP over TCP.
+	int32_t seekToAny;				//	Seek to any frame rather than the previous key frame.
+	int32_t videoBufferMin;			//	Frames, the adaptive queue depth stays within min and max.
+	int32_t videoBufferMax;
+	int32_t audioBufferMin;
+	int32_t audioBufferMax;
+	int32_t openTimeoutMs;			//	<= 0 for no timeout. On by default, an open used to wait as long as the input did.
+	int32_t readTimeoutMs;			//	<= 0 for no timeout. Opt in, a read that times out ends the stream like end of file.
+	int64_t sliceThresholdPixels;	//	Frames with more pixels are converted in parallel bands.
+	int32_t videoOutputFormat;		//	VideoOutputFormat.
+	int32_t codecThreads;			//	0 lets CodecThreadBudget decide.
+	int32_t priority;				//	CodecThreadBudget::Priority.
+	int32_t ioBufferSize;			//	Bytes, socket receive buffer of network inputs.
+	int64_t probeSize;				//	Bytes read to detect the streams.
+	int64_t analyzeDurationUs;		//	Media time analyzed to detect the streams.
+	int32_t liveMode;				//	Low latency settings for live RTSP and HLS sources, see LiveLatencyController.
+	int32_t liveTargetDelayMs;		//	Delay behind the live edge held in live mode.
+	int32_t audioOutputFormat;		//	AudioOutputFormat.
+	int32_t mappedInput;			//	Read local files through a shared memory mapping instead of the file protocol.
+									//	Opt in, only for files that are complete and never rewritten while they play.
+};
+
+enum VideoOutputFormat { VIDEO_OUTPUT_RGB24, VIDEO_OUTPUT_RGBA };
+enum AudioOutputFormat { AUDIO_OUTPUT_FLT, AUDIO_OUTPUT_S16, AUDIO_OUTPUT_FLTP };
+
+//	Layout of one queued audio frame, see nativeGetAudioPlanes.
+struct NativeAudioLayout {
+	int32_t sampleFormat;			//	AudioOutputFormat.
+	int32_t channels;
+	int32_t sampleRate;
+	int32_t samples;				//	Per channel.
+	int32_t bytesPerSample;
+	int32_t planeCount;				//	1 for interleaved formats, one plane per channel for AUDIO_OUTPUT_FLTP.
+	int32_t planeSize;				//	Bytes of audio in each plane, without padding.
+};
+
+//	Video frame leased to the host, see nativeLeaseVideoFrame. The planes stay valid until the handle is released
+//	or the decoder is destroyed.
+struct NativeVideoLease {
+	int64_t handle;					//	0 when no frame was leased.
+	double time;
+	int32_t width;
+	int32_t height;
+	int32_t format;					//	VideoOutputFormat.
+	int32_t planeCount;
+	uint8_t* planes[4];
+	int32_t strides[4];
+};
+
+//	Process wide defaults, loaded once from the config file in the working directory
+//	on first use. Decoders created without options copy the defaults at creation.
+class DecoderOptions {
+public:
+	static NativeDecoderOptions getDefaults();
+	static void setDefaults(const NativeDecoderOptions& options);
+
+	//	Built in values, used for the keys the config file does not set.
+	static NativeDecoderOptions getBuiltInDefaults();
+	static bool loadFile(const char* path, NativeDecoderOptions& options);
+	static void sanitize(NativeDecoderOptions& options);
+};
\ No newline at end of file
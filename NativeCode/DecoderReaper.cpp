@@ -0,0 +1,65 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "DecoderReaper.h"
+#include "Logger.h"
+
+DecoderReaper* DecoderReaper::_instance;
+DecoderReaper::DecoderReaper() {
+	mPendingCount = 0;
+	mPendingBytes = 0;
+	mWorker = std::thread(&DecoderReaper::workerLoop, this);
+	mWorker.detach();
+}
+
+DecoderReaper* DecoderReaper::instance() {
+	static std::once_flag once;
+	std::call_once(once, []() { _instance = new DecoderReaper(); });
+	return _instance;
+}
+
+//	bytes is the memory estimate released by the teardown, only used for reporting.
+void DecoderReaper::post(std::function<void()> teardown, int64_t bytes) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mTeardowns.push({ teardown, bytes });
+	mPendingCount++;
+	mPendingBytes += bytes;
+	mCondition.notify_one();
+}
+
+//	Block until every posted teardown has finished. Used on shutdown before the library can be unloaded.
+void DecoderReaper::waitIdle() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdleCondition.wait(lock, [this]() { return mPendingCount == 0; });
+}
+
+int DecoderReaper::getPendingCount() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPendingCount;
+}
+
+int64_t DecoderReaper::getPendingBytes() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPendingBytes;
+}
+
+void DecoderReaper::workerLoop() {
+	while (true) {
+		Teardown teardown;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return !mTeardowns.empty(); });
+			teardown = mTeardowns.front();
+			mTeardowns.pop();
+		}
+
+		teardown.run();
+		LOG_INFO(Logger::CATEGORY_DECODER, "Decoder teardown finished. \n");
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPendingCount--;
+		mPendingBytes -= teardown.bytes;
+		if (mPendingCount == 0) {
+			mIdleCondition.notify_all();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+
+//	Runs decoder teardown (joining threads, closing codecs and freeing queued frames) on a background thread,
+//	so destroying or hibernating decoders never stalls the caller. Teardowns run in posting order.
+class DecoderReaper {
+public:
+	static DecoderReaper* instance();
+
+	void post(std::function<void()> teardown, int64_t bytes);
+	void waitIdle();
+
+	int getPendingCount();
+	int64_t getPendingBytes();
+
+private:
+	DecoderReaper();
+
+	struct Teardown {
+		std::function<void()> run;
+		int64_t bytes;
+	};
+
+	void workerLoop();
+
+	std::thread mWorker;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::condition_variable mIdleCondition;
+	std::queue<Teardown> mTeardowns;
+	int mPendingCount;
+	int64_t mPendingBytes;
+
+	static DecoderReaper* _instance;
+};
\ No newline at end of file
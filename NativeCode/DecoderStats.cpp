@@ -0,0 +1,110 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "DecoderStats.h"
+#include <chrono>
+
+static const std::memory_order RELAXED = std::memory_order_relaxed;
+
+StatsHistogram::StatsHistogram() {
+	reset();
+}
+
+void StatsHistogram::record(int64_t us) {
+	us = us < 0 ? 0 : us;
+	int bucket = 0;
+	while (bucket < STATS_HISTOGRAM_BUCKETS - 1 && us >= ((int64_t)1 << bucket)) {
+		bucket++;
+	}
+
+	mBuckets[bucket].fetch_add(1, RELAXED);
+	mCount.fetch_add(1, RELAXED);
+	mSumUs.fetch_add(us, RELAXED);
+	if (us > mMaxUs.load(RELAXED)) {
+		mMaxUs.store(us, RELAXED);
+	}
+}
+
+void StatsHistogram::snapshot(NativeHistogram& histogram) const {
+	histogram.count = mCount.load(RELAXED);
+	histogram.sumUs = mSumUs.load(RELAXED);
+	histogram.maxUs = mMaxUs.load(RELAXED);
+	for (int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+		histogram.buckets[i] = mBuckets[i].load(RELAXED);
+	}
+}
+
+void StatsHistogram::reset() {
+	mCount.store(0, RELAXED);
+	mSumUs.store(0, RELAXED);
+	mMaxUs.store(0, RELAXED);
+	for (int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+		mBuckets[i].store(0, RELAXED);
+	}
+}
+
+DecoderStats::DecoderStats() {
+	videoQueueDepth.store(0, RELAXED);
+	audioQueueDepth.store(0, RELAXED);
+	videoQueueTarget.store(0, RELAXED);
+	audioQueueTarget.store(0, RELAXED);
+	reset();
+}
+
+int64_t DecoderStats::nowUs() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void DecoderStats::snapshot(NativeDecoderStats& stats) const {
+	demuxTime.snapshot(stats.demuxTime);
+	videoDecodeTime.snapshot(stats.videoDecodeTime);
+	audioDecodeTime.snapshot(stats.audioDecodeTime);
+	conversionTime.snapshot(stats.conversionTime);
+	seekLatency.snapshot(stats.seekLatency);
+	resumeLatency.snapshot(stats.resumeLatency);
+	stats.videoFramesDecoded = videoFramesDecoded.load(RELAXED);
+	stats.audioFramesDecoded = audioFramesDecoded.load(RELAXED);
+	stats.videoFramesDropped = videoFramesDropped.load(RELAXED);
+	stats.videoFramesCapped = videoFramesCapped.load(RELAXED);
+	stats.videoFramesPresented = videoFramesPresented.load(RELAXED);
+	stats.bytesRead = bytesRead.load(RELAXED);
+	stats.seekCount = seekCount.load(RELAXED);
+	stats.bufferUnderruns = bufferUnderruns.load(RELAXED);
+	stats.audioUnderruns = 0;		//	Counted by the audio ring of the handler, filled in by nativeGetDecoderStats.
+	stats.videoQueueDepth = videoQueueDepth.load(RELAXED);
+	stats.audioQueueDepth = audioQueueDepth.load(RELAXED);
+	stats.videoQueuePeak = videoQueuePeak.load(RELAXED);
+	stats.audioQueuePeak = audioQueuePeak.load(RELAXED);
+	stats.videoQueueTarget = videoQueueTarget.load(RELAXED);
+	stats.audioQueueTarget = audioQueueTarget.load(RELAXED);
+}
+
+//	Queue depths and targets are current values and are kept, everything else starts over.
+void DecoderStats::reset() {
+	demuxTime.reset();
+	videoDecodeTime.reset();
+	audioDecodeTime.reset();
+	conversionTime.reset();
+	seekLatency.reset();
+	resumeLatency.reset();
+	videoFramesDecoded.store(0, RELAXED);
+	audioFramesDecoded.store(0, RELAXED);
+	videoFramesDropped.store(0, RELAXED);
+	videoFramesCapped.store(0, RELAXED);
+	videoFramesPresented.store(0, RELAXED);
+	bytesRead.store(0, RELAXED);
+	seekCount.store(0, RELAXED);
+	bufferUnderruns.store(0, RELAXED);
+	videoQueuePeak.store(videoQueueDepth.load(RELAXED), RELAXED);
+	audioQueuePeak.store(audioQueueDepth.load(RELAXED), RELAXED);
+}
+
+void DecoderStats::updateQueueDepth(int videoDepth, int audioDepth) {
+	videoQueueDepth.store(videoDepth, RELAXED);
+	audioQueueDepth.store(audioDepth, RELAXED);
+	if (videoDepth > videoQueuePeak.load(RELAXED)) {
+		videoQueuePeak.store(videoDepth, RELAXED);
+	}
+	if (audioDepth > audioQueuePeak.load(RELAXED)) {
+		audioQueuePeak.store(audioDepth, RELAXED);
+	}
+}
\ No newline at end of file
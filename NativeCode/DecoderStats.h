@@ -0,0 +1,90 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+#define STATS_HISTOGRAM_BUCKETS 20
+
+//	Plain layouts handed to the host, see FFMPEGDecoderWrapper.cs for the managed mirror.
+//	Bucket 0 counts durations below 1 us, bucket i counts [2^(i-1), 2^i) us, the last bucket also everything above.
+struct NativeHistogram {
+	int64_t count;
+	int64_t sumUs;
+	int64_t maxUs;
+	uint32_t buckets[STATS_HISTOGRAM_BUCKETS];
+};
+
+struct NativeDecoderStats {
+	NativeHistogram demuxTime;
+	NativeHistogram videoDecodeTime;
+	NativeHistogram audioDecodeTime;
+	NativeHistogram conversionTime;
+	NativeHistogram seekLatency;		//	From the seek request to the first frame queued after it.
+	NativeHistogram resumeLatency;		//	From the resume request to the first frame at the hibernated position.
+	int64_t videoFramesDecoded;
+	int64_t audioFramesDecoded;
+	int64_t videoFramesDropped;			//	Decoded but never presented, skipped by preroll or flushed by a seek.
+	int64_t videoFramesCapped;			//	Decoded and dropped before conversion to stay under the frame-rate cap.
+	int64_t videoFramesPresented;
+	int64_t bytesRead;
+	int64_t seekCount;
+	int64_t bufferUnderruns;			//	Times a due video frame was not decoded yet, outside of end of stream.
+	int64_t audioUnderruns;				//	Audio ring requests padded with silence, counted once per gap.
+	int32_t videoQueueDepth;
+	int32_t audioQueueDepth;
+	int32_t videoQueuePeak;
+	int32_t audioQueuePeak;
+	int32_t videoQueueTarget;			//	Adaptive depth at which the queue reports FULL.
+	int32_t audioQueueTarget;
+};
+
+//	Lock free duration histogram, written by one thread and read by any.
+class StatsHistogram {
+public:
+	StatsHistogram();
+
+	void record(int64_t us);
+	void snapshot(NativeHistogram& histogram) const;
+	void reset();
+
+private:
+	std::atomic<int64_t> mCount;
+	std::atomic<int64_t> mSumUs;
+	std::atomic<int64_t> mMaxUs;
+	std::atomic<uint32_t> mBuckets[STATS_HISTOGRAM_BUCKETS];
+};
+
+//	Runtime statistics of one decoder. Members are updated with relaxed atomics on the decode path,
+//	so the host can poll a snapshot every frame.
+class DecoderStats {
+public:
+	DecoderStats();
+
+	static int64_t nowUs();
+
+	void snapshot(NativeDecoderStats& stats) const;
+	void reset();
+	void updateQueueDepth(int videoDepth, int audioDepth);
+
+	StatsHistogram demuxTime;
+	StatsHistogram videoDecodeTime;
+	StatsHistogram audioDecodeTime;
+	StatsHistogram conversionTime;
+	StatsHistogram seekLatency;
+	StatsHistogram resumeLatency;
+	std::atomic<int64_t> videoFramesDecoded;
+	std::atomic<int64_t> audioFramesDecoded;
+	std::atomic<int64_t> videoFramesDropped;
+	std::atomic<int64_t> videoFramesCapped;
+	std::atomic<int64_t> videoFramesPresented;
+	std::atomic<int64_t> bytesRead;
+	std::atomic<int64_t> seekCount;
+	std::atomic<int64_t> bufferUnderruns;
+	std::atomic<int32_t> videoQueueDepth;
+	std::atomic<int32_t> audioQueueDepth;
+	std::atomic<int32_t> videoQueuePeak;
+	std::atomic<int32_t> audioQueuePeak;
+	std::atomic<int32_t> videoQueueTarget;
+	std::atomic<int32_t> audioQueueTarget;
+};
\ No newline at end of file
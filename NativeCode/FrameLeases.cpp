@@ -0,0 +1,73 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "FrameLeases.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace {
+	struct Lease {
+		FrameLeases* owner;		//	Null once the decoder is destroyed.
+		AVFrame* frame;
+	};
+
+	std::mutex sMutex;
+	std::unordered_map<int64_t, Lease> sLeases;
+	int64_t sNextHandle = 1;
+}
+
+FrameLeases::FrameLeases() {
+	mCount = 0;
+}
+
+//	Leases still held are orphaned, not freed, the host may be reading them on another thread.
+FrameLeases::~FrameLeases() {
+	std::lock_guard<std::mutex> lock(sMutex);
+	for (auto& entry : sLeases) {
+		if (entry.second.owner == this) {
+			entry.second.owner = nullptr;
+		}
+	}
+}
+
+int64_t FrameLeases::add(AVFrame* frame) {
+	std::lock_guard<std::mutex> lock(sMutex);
+	int64_t handle = sNextHandle++;
+	sLeases[handle] = { this, frame };
+	mCount++;
+	return handle;
+}
+
+bool FrameLeases::release(int64_t handle) {
+	return release(this, handle);
+}
+
+bool FrameLeases::releaseHandle(int64_t handle) {
+	return release(nullptr, handle);
+}
+
+//	A null owner matches the leases of every decoder.
+bool FrameLeases::release(const FrameLeases* owner, int64_t handle) {
+	AVFrame* frame = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(sMutex);
+		auto it = sLeases.find(handle);
+		if (it == sLeases.end() || (owner != nullptr && it->second.owner != owner)) {
+			return false;
+		}
+		frame = it->second.frame;
+		if (it->second.owner != nullptr) {
+			it->second.owner->mCount--;
+		}
+		sLeases.erase(it);
+	}
+
+	av_frame_free(&frame);
+	return true;
+}
+
+int FrameLeases::getCount() {
+	std::lock_guard<std::mutex> lock(sMutex);
+	return mCount;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include <unordered_map>
+
+struct AVFrame;
+
+//	Video frames handed to the host, keyed by a handle that is unique in the process. A leased frame has left the
+//	decoder queue, so flushes and seeks never free it. Its buffer is reference counted and returns to the decoder pool
+//	on release. Every decoder's leases live in one table behind its own lock, so a release from any thread finds its
+//	frame by handle alone and never looks up the decoder. A destroyed decoder leaves its leases to the host, the pool
+//	their buffers come from is only freed once the last of them is released.
+class FrameLeases {
+public:
+	FrameLeases();
+	~FrameLeases();
+
+	//	Takes ownership of frame, returns its handle.
+	int64_t add(AVFrame* frame);
+	bool release(int64_t handle);
+	int getCount();
+
+	//	Releases a lease of any decoder, also one its destroyed decoder left behind. False for an unknown handle.
+	static bool releaseHandle(int64_t handle);
+
+private:
+	static bool release(const FrameLeases* owner, int64_t handle);
+
+	int mCount;		//	Guarded by the table lock.
+};
\ No newline at end of file
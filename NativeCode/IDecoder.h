@@ -1,6 +1,9 @@
 //========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
 
 #pragma once
+#include <stdint.h>
+#include "DecoderStats.h"
+#include "DecoderOptions.h"
 
 class IDecoder
 {
@@ -22,25 +25,52 @@ public:
 		bool isEnabled;
 		unsigned int channels;
 		unsigned int sampleRate;
+		int sampleFormat;			//	AudioOutputFormat of the queued frames.
 		double lastTime;
 		double totalTime;
 		BufferState bufferState;
 	};
+
+	//	Startup phase durations in milliseconds, -1 if the phase has not happened yet.
+	//	firstPacket and firstFrame are measured from the beginning of init.
+	struct StartupTimings {
+		double open;
+		double streamInfo;
+		double codecOpen;
+		double firstPacket;
+		double firstFrame;
+	};
 	
 	virtual bool init(const char* filePath) = 0;
 	virtual bool decode() = 0;
 	virtual void seek(double time) = 0;
 	virtual void destroy() = 0;
+	virtual bool preroll(double startTime) = 0;
+	virtual void interrupt() = 0;
+	virtual bool hibernate(bool isCloseInput) = 0;
+	virtual bool resume(double position, bool isVideoEnabled, bool isAudioEnabled) = 0;
+	virtual double updateLiveClock(double hostTime) = 0;
+	virtual bool getLiveLatency(double& latency, double& rate) = 0;
 
 	virtual VideoInfo getVideoInfo() = 0;
 	virtual AudioInfo getAudioInfo() = 0;
 	virtual void setVideoEnable(bool isEnable) = 0;
 	virtual void setAudioEnable(bool isEnable) = 0;
 	virtual void setAudioAllChDataEnable(bool isEnable) = 0;
-	virtual double getVideoFrame(void** frameData) = 0;
+	//	Moves the front video frame out of the queue into a lease. With time >= 0, every queued frame older than
+	//	the newest one due at time is released first, and nothing is leased while the front frame is in the future.
+	virtual bool leaseVideoFrame(double time, NativeVideoLease& lease) = 0;
+	virtual bool releaseVideoFrame(int64_t handle) = 0;
 	virtual double getAudioFrame(unsigned char** outputFrame, int& frameSize) = 0;
-	virtual void freeVideoFrame() = 0;
+	//	Front audio frame with every plane, up to maxPlanes. Released with freeAudioFrame like getAudioFrame.
+	virtual double getAudioPlanes(unsigned char** planes, int maxPlanes, NativeAudioLayout& layout) = 0;
 	virtual void freeAudioFrame() = 0;
 
 	virtual int getMetaData(char**& key, char**& value) = 0;
+	virtual StartupTimings getStartupTimings() = 0;
+	virtual int64_t getMemoryUsage() = 0;
+	virtual DecoderStats* getStats() = 0;
+	virtual void setPriority(int priority) = 0;
+	//	Frames per second handed out at most, <= 0 for no cap. Applied from the next decoded frame.
+	virtual void setMaxFrameRate(double frameRate) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "LiveLatencyController.h"
+#include <algorithm>
+#include <math.h>
+
+namespace {
+	const double MAX_TICK_SECONDS = 0.5;			//	Larger host clock steps are seeks or pauses, not progress.
+	const double MAX_EXTRAPOLATION_SECONDS = 0.25;	//	Smooths the edge between packets, a stalled source does not move it.
+	const double LATENCY_SMOOTHING = 0.1;
+	const double TOLERANCE_SECONDS = 0.05;
+	const double SKIP_MIN_SECONDS = 1.0;			//	Errors above max(this, target) are skipped instead of caught up.
+	const double RATE_GAIN = 0.5;
+	const double MAX_SPEEDUP = 0.1;
+	const double MAX_SLOWDOWN = 0.05;
+}
+
+LiveLatencyController::LiveLatencyController() {
+	reset(1.0);
+}
+
+void LiveLatencyController::reset(double targetSeconds) {
+	mEdgeTime = 0.0;
+	mEdgeUs = -1;
+	mTargetSeconds = std::max(targetSeconds, 0.0);
+	mOffset = 0.0;
+	mLastHostTime = -1.0;
+	mIsMeasured = false;
+	mLatency = 0.0;
+	mRate = 1.0;
+	mSkipCount = 0;
+}
+
+void LiveLatencyController::onMedia(double mediaTime, int64_t nowUs) {
+	if (mEdgeUs.load(std::memory_order_relaxed) < 0 || mediaTime > mEdgeTime.load(std::memory_order_relaxed)) {
+		mEdgeTime.store(mediaTime, std::memory_order_relaxed);
+		mEdgeUs.store(nowUs, std::memory_order_release);
+	}
+}
+
+double LiveLatencyController::update(double hostTime, int64_t nowUs) {
+	double elapsed = mLastHostTime < 0.0 ? 0.0 : hostTime - mLastHostTime;
+	mLastHostTime = hostTime;
+	if (elapsed < 0.0 || elapsed > MAX_TICK_SECONDS) {
+		elapsed = 0.0;
+	}
+
+	int64_t edgeUs = mEdgeUs.load(std::memory_order_acquire);
+	if (edgeUs < 0) {
+		return hostTime + mOffset;
+	}
+
+	double edge = mEdgeTime.load(std::memory_order_relaxed) + std::min((nowUs - edgeUs) / 1.0e6, MAX_EXTRAPOLATION_SECONDS);
+	double latency = edge - (hostTime + mOffset);
+	mLatency = mIsMeasured ? mLatency + LATENCY_SMOOTHING * (latency - mLatency) : latency;
+	mIsMeasured = true;
+
+	double error = mLatency - mTargetSeconds;
+	if (error > std::max(SKIP_MIN_SECONDS, mTargetSeconds) && elapsed > 0.0) {
+		//	Too far behind to catch up by rate, the decoder drops every frame the clock jumps over.
+		//	A paused host would only jump past frames it is not presenting anyway.
+		mOffset += error;
+		mLatency = mTargetSeconds;
+		mRate = 1.0;
+		mSkipCount++;
+	} else if (fabs(error) > TOLERANCE_SECONDS) {
+		mRate = 1.0 + std::max(-MAX_SLOWDOWN, std::min(RATE_GAIN * error, MAX_SPEEDUP));
+	} else {
+		mRate = 1.0;
+	}
+
+	mOffset += (mRate - 1.0) * elapsed;
+	return hostTime + mOffset;
+}
+
+double LiveLatencyController::getLatency() const {
+	return mIsMeasured ? mLatency : -1.0;
+}
+
+double LiveLatencyController::getRate() const {
+	return mRate;
+}
+
+int64_t LiveLatencyController::getSkipCount() const {
+	return mSkipCount;
+}
\ No newline at end of file
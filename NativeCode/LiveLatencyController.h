@@ -0,0 +1,39 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+//	Holds a live source at a target delay behind its live edge. The edge is the newest demuxed timestamp,
+//	extrapolated by wall time between packets. The host clock only advances, so a stall or a paused host
+//	adds latency that is never won back. The controller keeps an offset on top of the host clock, which
+//	runs slightly fast while the latency is above the target and jumps ahead when it is far above.
+class LiveLatencyController {
+public:
+	LiveLatencyController();
+
+	void reset(double targetSeconds);
+
+	//	Decode thread, media time of each demuxed packet.
+	void onMedia(double mediaTime, int64_t nowUs);
+
+	//	Host thread, returns the presentation clock for hostTime.
+	double update(double hostTime, int64_t nowUs);
+
+	//	Host thread, smoothed latency in seconds (-1 until measured) and the current clock rate.
+	double getLatency() const;
+	double getRate() const;
+	int64_t getSkipCount() const;
+
+private:
+	std::atomic<double> mEdgeTime;
+	std::atomic<int64_t> mEdgeUs;		//	Arrival of the edge packet, -1 before the first packet.
+
+	double mTargetSeconds;
+	double mOffset;
+	double mLastHostTime;
+	bool mIsMeasured;
+	double mLatency;
+	double mRate;
+	int64_t mSkipCount;
+};
\ No newline at end of file
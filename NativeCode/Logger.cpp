@@ -1,27 +1,171 @@
 //========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
 
 #include "Logger.h"
+#include <chrono>
+#include <mutex>
+#include <string.h>
 
 #pragma warning(disable:4996)
 
+namespace {
+	const char* LEVEL_NAMES[] = { "NONE", "ERROR", "WARN", "INFO", "DEBUG", "VERBOSE" };
+	const int64_t RATE_WINDOW_MS = 1000;
+	const int WRITER_INTERVAL_MS = 20;
+	const int FLUSH_TIMEOUT_MS = 1000;
+	std::once_flag sOnce;
+
+	int64_t nowMs() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+#ifdef ENABLE_LOG
+std::atomic<int> Logger::sLevel(Logger::LEVEL_DEBUG);
+#else
+std::atomic<int> Logger::sLevel(Logger::LEVEL_NONE);
+#endif
+std::atomic<int> Logger::sCategories(Logger::CATEGORY_ALL);
+std::atomic<int> Logger::sRateLimit(20);
 Logger* Logger::_instance;
+
 Logger::Logger() {
-	fclose(stdout);
-	freopen("NativeLog.txt", "a", stdout);
+	for (uint64_t i = 0; i < QUEUE_SIZE; i++) {
+		mEntries[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	mEnqueuePos.store(0);
+	mDequeuePos.store(0);
+	mWrittenPos.store(0);
+	mDroppedCount.store(0);
+
+	//	The logger lives as long as the library, so the writer is never joined.
+	mWriter = std::thread(&Logger::writerLoop, this);
+	mWriter.detach();
 }
 
 Logger* Logger::instance() {
-	if (!_instance) {
-		_instance = new Logger();
-	}
+	std::call_once(sOnce, []() { _instance = new Logger(); });
 	return _instance;
 }
 
-void Logger::log(const char* str, ...) {
+void Logger::setLevel(Level level, int categories) {
+	sLevel.store(level, std::memory_order_relaxed);
+	sCategories.store(categories, std::memory_order_relaxed);
+}
+
+void Logger::setRateLimit(int messagesPerSecond) {
+	sRateLimit.store(messagesPerSecond, std::memory_order_relaxed);
+}
+
+void Logger::log(Level level, int category, Site& site, const char* str, ...) {
+	int suppressed = 0;
+	int limit = sRateLimit.load(std::memory_order_relaxed);
+	if (limit > 0) {
+		int64_t now = nowMs();
+		int64_t windowStart = site.windowStart.load(std::memory_order_relaxed);
+		if (now - windowStart >= RATE_WINDOW_MS && site.windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+			site.count.store(0, std::memory_order_relaxed);
+			suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+		}
+		if (site.count.fetch_add(1, std::memory_order_relaxed) >= limit) {
+			site.suppressed.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	char message[MESSAGE_SIZE];
+	int offset = 0;
+	if (suppressed > 0) {
+		offset = snprintf(message, MESSAGE_SIZE, "(%d similar suppressed) ", suppressed);
+	}
 	va_list args;
 	va_start(args, str);
-	vprintf(str, args);
+	vsnprintf(message + offset, MESSAGE_SIZE - offset, str, args);
 	va_end(args);
 
-	fflush(stdout);
+	//	Call sites end their messages inconsistently, the writer adds one line break.
+	size_t length = strlen(message);
+	while (length > 0 && (message[length - 1] == '\n' || message[length - 1] == ' ')) {
+		message[--length] = '\0';
+	}
+
+	if (!push(level, category, message)) {
+		mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void Logger::flush() {
+	uint64_t target = mEnqueuePos.load(std::memory_order_acquire);
+	int64_t deadline = nowMs() + FLUSH_TIMEOUT_MS;
+	while (mWrittenPos.load(std::memory_order_acquire) < target && nowMs() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+//	Bounded multi producer queue, each slot sequence tells whether it is free for position pos (== pos)
+//	or holds the message of position pos (== pos + 1). A full queue drops the message instead of blocking.
+bool Logger::push(Level level, int category, const char* message) {
+	uint64_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+	Entry* entry = nullptr;
+	while (true) {
+		entry = &mEntries[pos % QUEUE_SIZE];
+		uint64_t sequence = entry->sequence.load(std::memory_order_acquire);
+		int64_t diff = (int64_t)sequence - (int64_t)pos;
+		if (diff == 0) {
+			if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = mEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	entry->time = nowMs();
+	entry->threadId = (uint64_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+	entry->level = level;
+	entry->category = category;
+	strncpy(entry->message, message, MESSAGE_SIZE - 1);
+	entry->message[MESSAGE_SIZE - 1] = '\0';
+	entry->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+//	Only called from the writer thread.
+bool Logger::pop(FILE* file) {
+	uint64_t pos = mDequeuePos.load(std::memory_order_relaxed);
+	Entry* entry = &mEntries[pos % QUEUE_SIZE];
+	if (entry->sequence.load(std::memory_order_acquire) != pos + 1) {
+		return false;
+	}
+
+	if (file != nullptr) {
+		fprintf(file, "[%lld.%03lld][%s][%04llx] %s\n", (long long)(entry->time / 1000), (long long)(entry->time % 1000),
+			LEVEL_NAMES[entry->level], (unsigned long long)(entry->threadId & 0xffff), entry->message);
+	}
+	entry->sequence.store(pos + QUEUE_SIZE, std::memory_order_release);
+	mDequeuePos.store(pos + 1, std::memory_order_relaxed);
+	return true;
+}
+
+void Logger::writerLoop() {
+	FILE* file = fopen("NativeLog.txt", "a");
+	while (true) {
+		bool hasWritten = false;
+		while (pop(file)) {
+			hasWritten = true;
+		}
+
+		int64_t dropped = mDroppedCount.exchange(0, std::memory_order_relaxed);
+		if (dropped > 0 && file != nullptr) {
+			fprintf(file, "[%s] %lld messages dropped, log queue full.\n", LEVEL_NAMES[LEVEL_WARNING], (long long)dropped);
+			hasWritten = true;
+		}
+
+		if (hasWritten && file != nullptr) {
+			fflush(file);
+		}
+		mWrittenPos.store(mDequeuePos.load(std::memory_order_relaxed), std::memory_order_release);
+		std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_INTERVAL_MS));
+	}
 }
\ No newline at end of file
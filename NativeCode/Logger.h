@@ -3,19 +3,90 @@
 #pragma once
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
 
+//	Every log call site checks the runtime level and category first, so a disabled message costs two relaxed loads and no formatting.
+//	Enabled messages are formatted by the caller into a lock free queue and written to NativeLog.txt by a background thread.
+//	ENABLE_LOG only changes the default level from LEVEL_NONE to LEVEL_DEBUG.
 //#define ENABLE_LOG
-#ifdef ENABLE_LOG
-#define LOG(...) Logger::instance()->log(__VA_ARGS__)
-#else
-#define LOG
-#endif
+#define LOG_AT(level, category, ...) \
+	do { \
+		static Logger::Site _logSite; \
+		if (Logger::isEnabled(level, category)) { \
+			Logger::instance()->log(level, category, _logSite, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_ERROR(category, ...)	LOG_AT(Logger::LEVEL_ERROR, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...)	LOG_AT(Logger::LEVEL_WARNING, category, __VA_ARGS__)
+#define LOG_INFO(category, ...)		LOG_AT(Logger::LEVEL_INFO, category, __VA_ARGS__)
+#define LOG_VERBOSE(category, ...)	LOG_AT(Logger::LEVEL_VERBOSE, category, __VA_ARGS__)
+#define LOG(...)					LOG_AT(Logger::LEVEL_DEBUG, Logger::CATEGORY_GENERAL, __VA_ARGS__)
 
 class Logger {
 public:
+	enum Level { LEVEL_NONE, LEVEL_ERROR, LEVEL_WARNING, LEVEL_INFO, LEVEL_DEBUG, LEVEL_VERBOSE };
+	enum Category {
+		CATEGORY_GENERAL = 1 << 0,
+		CATEGORY_DECODER = 1 << 1,
+		CATEGORY_IO = 1 << 2,
+		CATEGORY_VIDEO = 1 << 3,
+		CATEGORY_AUDIO = 1 << 4,
+		CATEGORY_API = 1 << 5,
+		CATEGORY_ALL = 0xffff
+	};
+
+	//	Rate limit state of one call site.
+	struct Site {
+		std::atomic<int64_t> windowStart;
+		std::atomic<int> count;
+		std::atomic<int> suppressed;
+	};
+
 	static Logger* instance();
-	void log(const char* str, ...);
+
+	static inline bool isEnabled(Level level, int category) {
+		return level <= sLevel.load(std::memory_order_relaxed) && (category & sCategories.load(std::memory_order_relaxed)) != 0;
+	}
+
+	static void setLevel(Level level, int categories);
+	//	Messages per second and call site, <= 0 for no limit.
+	static void setRateLimit(int messagesPerSecond);
+
+	void log(Level level, int category, Site& site, const char* str, ...);
+	//	Block until everything queued so far is written.
+	void flush();
+
 private:
 	Logger();
+
+	static const int QUEUE_SIZE = 1024;
+	static const int MESSAGE_SIZE = 256;
+
+	struct Entry {
+		std::atomic<uint64_t> sequence;
+		int64_t time;
+		uint64_t threadId;
+		Level level;
+		int category;
+		char message[MESSAGE_SIZE];
+	};
+
+	bool push(Level level, int category, const char* message);
+	bool pop(FILE* file);
+	void writerLoop();
+
+	Entry mEntries[QUEUE_SIZE];
+	std::atomic<uint64_t> mEnqueuePos;
+	std::atomic<uint64_t> mDequeuePos;
+	std::atomic<uint64_t> mWrittenPos;
+	std::atomic<int64_t> mDroppedCount;
+	std::thread mWriter;
+
+	static std::atomic<int> sLevel;
+	static std::atomic<int> sCategories;
+	static std::atomic<int> sRateLimit;
 	static Logger* _instance;
 };
\ No newline at end of file
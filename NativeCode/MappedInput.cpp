@@ -0,0 +1,223 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "MappedInput.h"
+#include "Logger.h"
+#include <algorithm>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+extern "C" {
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+namespace {
+	const int IO_BUFFER_SIZE = 64 * 1024;
+	const int64_t PREFETCH_BYTES = 4 * 1024 * 1024;	//	Read ahead window, renewed when half of it is consumed.
+	const char* FILE_PROTOCOL = "file:";
+}
+
+std::mutex FileMapping::sMutex;
+std::map<std::string, std::weak_ptr<FileMapping>> FileMapping::sMappings;
+
+FileMapping::FileMapping() {
+	mData = nullptr;
+	mSize = 0;
+#ifdef _WIN32
+	mFile = INVALID_HANDLE_VALUE;
+	mMapping = nullptr;
+#endif
+}
+
+FileMapping::~FileMapping() {
+#ifdef _WIN32
+	if (mData != nullptr) {
+		UnmapViewOfFile(mData);
+	}
+	if (mMapping != nullptr) {
+		CloseHandle(mMapping);
+	}
+	if (mFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(mFile);
+	}
+#else
+	if (mData != nullptr) {
+		munmap((void*)mData, (size_t)mSize);
+	}
+#endif
+}
+
+std::shared_ptr<FileMapping> FileMapping::acquire(const std::string& path) {
+	std::lock_guard<std::mutex> lock(sMutex);
+	std::shared_ptr<FileMapping> mapping = sMappings[path].lock();
+	if (mapping != nullptr) {
+		return mapping;
+	}
+
+	mapping.reset(new FileMapping());
+	if (!mapping->map(path)) {
+		sMappings.erase(path);
+		return nullptr;
+	}
+
+	//	Expired entries of other paths are dropped here rather than tracked on release.
+	for (auto it = sMappings.begin(); it != sMappings.end();) {
+		it = it->second.expired() ? sMappings.erase(it) : std::next(it);
+	}
+	sMappings[path] = mapping;
+	return mapping;
+}
+
+//	Empty files are not mapped, the file protocol handles them like any other.
+bool FileMapping::map(const std::string& path) {
+#ifdef _WIN32
+	int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+	if (length <= 0) {
+		return false;
+	}
+	std::wstring widePath(length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &widePath[0], length);
+
+	mFile = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER size;
+	if (mFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFile, &size) || size.QuadPart <= 0) {
+		return false;
+	}
+
+	mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mMapping == nullptr) {
+		return false;
+	}
+
+	mData = (const uint8_t*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+	mSize = size.QuadPart;
+	return mData != nullptr;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	mData = (const uint8_t*)data;
+	mSize = status.st_size;
+	madvise(data, (size_t)mSize, MADV_SEQUENTIAL);
+	return true;
+#endif
+}
+
+//	Windows has no portable equivalent before PrefetchVirtualMemory, page faults are clustered by the memory manager there.
+void FileMapping::prefetch(int64_t offset, int64_t size) const {
+#ifndef _WIN32
+	static const int64_t pageSize = sysconf(_SC_PAGESIZE);
+	int64_t begin = std::max<int64_t>(offset, 0) / pageSize * pageSize;
+	int64_t end = std::min(offset + size, mSize);
+	if (end > begin) {
+		madvise((void*)(mData + begin), (size_t)(end - begin), MADV_WILLNEED);
+	}
+#endif
+}
+
+MappedInput::MappedInput() {
+	mIOContext = nullptr;
+	mPosition = 0;
+	mPrefetchedUntil = 0;
+}
+
+MappedInput::~MappedInput() {
+	if (mIOContext != nullptr) {
+		av_freep(&mIOContext->buffer);
+		avio_context_free(&mIOContext);
+	}
+}
+
+std::unique_ptr<MappedInput> MappedInput::open(const char* filePath) {
+	std::string path = filePath != nullptr ? filePath : "";
+	if (path.compare(0, strlen(FILE_PROTOCOL), FILE_PROTOCOL) == 0) {
+		path = path.substr(strlen(FILE_PROTOCOL));
+	} else if (path.empty() || path.find("://") != std::string::npos) {
+		return nullptr;
+	}
+
+	std::shared_ptr<FileMapping> mapping = FileMapping::acquire(path);
+	if (mapping == nullptr) {
+		LOG_INFO(Logger::CATEGORY_IO, "Could not map %s, using the file protocol. \n", path.c_str());
+		return nullptr;
+	}
+
+	std::unique_ptr<MappedInput> input(new MappedInput());
+	uint8_t* buffer = (uint8_t*)av_malloc(IO_BUFFER_SIZE);
+	input->mIOContext = avio_alloc_context(buffer, IO_BUFFER_SIZE, 0, input.get(), readPacket, nullptr, seek);
+	if (input->mIOContext == nullptr) {
+		av_free(buffer);
+		return nullptr;
+	}
+	input->mMapping = mapping;
+	return input;
+}
+
+int MappedInput::readPacket(void* opaque, uint8_t* buffer, int size) {
+	MappedInput* input = (MappedInput*)opaque;
+	int64_t remaining = input->mMapping->getSize() - input->mPosition;
+	if (remaining <= 0) {
+		return AVERROR_EOF;
+	}
+
+	//	Renewed when less than half of the window is left, or when a seek went back before it.
+	if (input->mPosition + PREFETCH_BYTES / 2 > input->mPrefetchedUntil || input->mPosition < input->mPrefetchedUntil - PREFETCH_BYTES) {
+		input->mMapping->prefetch(input->mPosition, PREFETCH_BYTES);
+		input->mPrefetchedUntil = input->mPosition + PREFETCH_BYTES;
+	}
+
+	int count = (int)std::min<int64_t>(size, remaining);
+	memcpy(buffer, input->mMapping->getData() + input->mPosition, count);
+	input->mPosition += count;
+	return count;
+}
+
+int64_t MappedInput::seek(void* opaque, int64_t offset, int whence) {
+	MappedInput* input = (MappedInput*)opaque;
+	int64_t position = 0;
+	switch (whence & ~AVSEEK_FORCE) {
+	case AVSEEK_SIZE:
+		return input->mMapping->getSize();
+	case SEEK_SET:
+		position = offset;
+		break;
+	case SEEK_CUR:
+		position = input->mPosition + offset;
+		break;
+	case SEEK_END:
+		position = input->mMapping->getSize() + offset;
+		break;
+	default:
+		return AVERROR(EINVAL);
+	}
+
+	if (position < 0) {
+		return AVERROR(EINVAL);
+	}
+	input->mPosition = position;
+	return position;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+//	Read only mapping of a whole local file. Decoders opening the same path share one mapping and its pages.
+class FileMapping {
+public:
+	~FileMapping();
+
+	//	nullptr when the path can not be mapped, the caller then falls back to the file protocol.
+	static std::shared_ptr<FileMapping> acquire(const std::string& path);
+
+	const uint8_t* getData() const { return mData; }
+	int64_t getSize() const { return mSize; }
+
+	//	Hints the kernel to read the range ahead of use.
+	void prefetch(int64_t offset, int64_t size) const;
+
+private:
+	FileMapping();
+	bool map(const std::string& path);
+
+	const uint8_t* mData;
+	int64_t mSize;
+#ifdef _WIN32
+	void* mFile;
+	void* mMapping;
+#endif
+
+	static std::mutex sMutex;
+	static std::map<std::string, std::weak_ptr<FileMapping>> sMappings;
+};
+
+//	AVIOContext serving reads and seeks of a local file from its mapping, in place of the file protocol.
+//	Each reader has its own position, so one instance belongs to one AVFormatContext.
+//	The size is fixed at open: a file still growing is cut off there, and a file truncated while mapped
+//	faults on the next read of the lost pages. That is why NativeDecoderOptions::mappedInput is opt in.
+class MappedInput {
+public:
+	~MappedInput();
+
+	//	Paths with a protocol other than file: are not local and return nullptr.
+	static std::unique_ptr<MappedInput> open(const char* filePath);
+
+	AVIOContext* getIOContext() { return mIOContext; }
+
+private:
+	MappedInput();
+
+	static int readPacket(void* opaque, uint8_t* buffer, int size);
+	static int64_t seek(void* opaque, int64_t offset, int whence);
+
+	std::shared_ptr<FileMapping> mMapping;
+	AVIOContext* mIOContext;
+	int64_t mPosition;
+	int64_t mPrefetchedUntil;
+};
\ No newline at end of file
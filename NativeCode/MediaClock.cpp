@@ -0,0 +1,75 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "MediaClock.h"
+#include <algorithm>
+#include <math.h>
+
+namespace {
+	const double DISCONTINUITY_SECONDS = 0.1;	//	A larger gap in the pulled audio restarts the timeline.
+}
+
+MediaClock::MediaClock() {
+	mSource = SOURCE_HOST;
+	mHostTime = -1.0;
+	mAudioLatency = 0.0;
+	reset();
+}
+
+void MediaClock::setSource(Source source) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSource = source;
+}
+
+MediaClock::Source MediaClock::getSource() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mSource;
+}
+
+void MediaClock::setAudioLatency(double seconds) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mAudioLatency = std::max(seconds, 0.0);
+}
+
+void MediaClock::setHostTime(double time) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mHostTime = time;
+}
+
+void MediaClock::onAudioFrame(double time, double duration, int64_t nowUs) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	int64_t durationUs = (int64_t)(duration * 1.0e6);
+	if (mAudioEndTime < 0.0 || nowUs > mAudioEndUs || fabs(time - mAudioEndTime) > DISCONTINUITY_SECONDS) {
+		//	Start, underrun or seek, this frame starts playing now.
+		mAudioEndUs = nowUs + durationUs;
+	} else {
+		mAudioEndUs += durationUs;
+	}
+	mAudioEndTime = time + duration;
+}
+
+//	Media time of the next sample the audio device takes, nothing beyond it is known to be queued.
+void MediaClock::onAudioPosition(double time, int64_t nowUs) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mAudioEndTime = time;
+	mAudioEndUs = nowUs;
+}
+
+void MediaClock::reset() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mAudioEndTime = -1.0;
+	mAudioEndUs = 0;
+}
+
+double MediaClock::getTime(int64_t nowUs) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mSource == SOURCE_HOST) {
+		return mHostTime;
+	}
+
+	if (mAudioEndTime < 0.0) {
+		return -1.0;
+	}
+
+	double remaining = std::max<int64_t>(mAudioEndUs - nowUs, 0) / 1.0e6;
+	return std::max(mAudioEndTime - remaining - mAudioLatency, 0.0);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <mutex>
+
+//	Presentation clock of one decoder, used to pick the video frame that should be on screen.
+//	SOURCE_HOST follows the time the host sets with nativeSetVideoTime. SOURCE_AUDIO follows the audio handed
+//	to the host: pulled audio is assumed to play back to back after the audio output latency, so the clock is the media time
+//	of the sample playing now and stops at the end of the pulled audio when the host runs dry. With the audio ring the
+//	host pulls nothing through the API, the ring read position is sampled with onAudioPosition instead.
+class MediaClock {
+public:
+	enum Source { SOURCE_HOST, SOURCE_AUDIO };
+
+	MediaClock();
+
+	void setSource(Source source);
+	Source getSource();
+	void setAudioLatency(double seconds);
+
+	void setHostTime(double time);
+	void onAudioFrame(double time, double duration, int64_t nowUs);
+	void onAudioPosition(double time, int64_t nowUs);
+
+	//	Forgets the audio timeline, called on seek.
+	void reset();
+
+	//	Media time in seconds, -1 until the source has set it.
+	double getTime(int64_t nowUs);
+
+private:
+	std::mutex mMutex;
+	Source mSource;
+	double mHostTime;
+	double mAudioLatency;
+	double mAudioEndTime;		//	Media time at the end of the pulled audio, -1 if none.
+	int64_t mAudioEndUs;		//	Wall time at which the pulled audio runs out.
+};
\ No newline at end of file
@@ -0,0 +1,167 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "OpenExecutor.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+	const int IDLE_WORKER_SECONDS = 5;	//	Workers without an open for this long exit, a new one starts on demand.
+
+	int getDefaultConcurrency() {
+		int threads = (int)std::thread::hardware_concurrency();
+		return std::max(threads > 0 ? threads / 2 : 2, 2);
+	}
+}
+
+OpenExecutor* OpenExecutor::_instance;
+OpenExecutor::OpenExecutor() {
+	mConcurrency = 0;
+	mWorkerCount = 0;
+	mRunningCount = 0;
+	mNextSequence = 0;
+	mCancelledCount = 0;
+}
+
+OpenExecutor* OpenExecutor::instance() {
+	static std::once_flag once;
+	std::call_once(once, []() { _instance = new OpenExecutor(); });
+	return _instance;
+}
+
+//	Lowering the limit lets the running opens finish, the extra workers exit afterwards.
+void OpenExecutor::setConcurrency(int concurrency) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mConcurrency = concurrency;
+	spawnWorkersLocked();
+	mCondition.notify_all();
+}
+
+int OpenExecutor::getConcurrency() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mConcurrency == 0 ? getDefaultConcurrency() : mConcurrency;
+}
+
+int OpenExecutor::getLimitLocked() {
+	if (mConcurrency < 0) {
+		return INT32_MAX;
+	}
+	return mConcurrency == 0 ? getDefaultConcurrency() : mConcurrency;
+}
+
+std::shared_ptr<OpenExecutor::Task> OpenExecutor::post(std::function<void()> open, int priority) {
+	std::shared_ptr<Task> task = std::make_shared<Task>();
+	task->open = open;
+	task->priority = priority;
+	task->postUs = DecoderStats::nowUs();
+	task->state = TASK_QUEUED;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	task->sequence = mNextSequence++;
+	mQueue.push_back(task);
+	spawnWorkersLocked();
+	mCondition.notify_one();
+	return task;
+}
+
+void OpenExecutor::setPriority(const std::shared_ptr<Task>& task, int priority) {
+	if (task == nullptr) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	task->priority = priority;
+}
+
+bool OpenExecutor::cancel(const std::shared_ptr<Task>& task) {
+	if (task == nullptr) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (task->state != TASK_QUEUED) {
+		return false;
+	}
+
+	mQueue.erase(std::find(mQueue.begin(), mQueue.end(), task));
+	task->state = TASK_CANCELLED;
+	task->open = nullptr;
+	mCancelledCount++;
+	mDoneCondition.notify_all();
+	return true;
+}
+
+void OpenExecutor::wait(const std::shared_ptr<Task>& task) {
+	if (task == nullptr) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCondition.wait(lock, [&task]() { return task->state == TASK_DONE || task->state == TASK_CANCELLED; });
+}
+
+void OpenExecutor::getStats(int& queued, int& running, int64_t& cancelled, NativeHistogram& queueWait, NativeHistogram& openTime) {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		queued = (int)mQueue.size();
+		running = mRunningCount;
+		cancelled = mCancelledCount;
+	}
+	mQueueWait.snapshot(queueWait);
+	mOpenTime.snapshot(openTime);
+}
+
+void OpenExecutor::resetStats() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCancelledCount = 0;
+	mQueueWait.reset();
+	mOpenTime.reset();
+}
+
+//	One worker per queued open up to the limit, idle workers pick up new opens before more are started.
+void OpenExecutor::spawnWorkersLocked() {
+	int limit = getLimitLocked();
+	while (mWorkerCount < limit && mWorkerCount - mRunningCount < (int)mQueue.size()) {
+		mWorkerCount++;
+		std::thread(&OpenExecutor::workerLoop, this).detach();
+	}
+}
+
+void OpenExecutor::workerLoop() {
+	while (true) {
+		std::shared_ptr<Task> task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait_for(lock, std::chrono::seconds(IDLE_WORKER_SECONDS), [this]() {
+				return !mQueue.empty() || mWorkerCount > getLimitLocked();
+			});
+			if (mQueue.empty() || mWorkerCount > getLimitLocked()) {
+				mWorkerCount--;
+				return;
+			}
+
+			auto best = std::min_element(mQueue.begin(), mQueue.end(), [](const std::shared_ptr<Task>& a, const std::shared_ptr<Task>& b) {
+				return a->priority != b->priority ? a->priority > b->priority : a->sequence < b->sequence;
+			});
+			task = *best;
+			mQueue.erase(best);
+			task->state = TASK_RUNNING;
+			mRunningCount++;
+		}
+
+		//	The histograms expect a single writer, so they are recorded with the mutex held.
+		int64_t startUs = DecoderStats::nowUs();
+		task->open();
+		int64_t endUs = DecoderStats::nowUs();
+		LOG_VERBOSE(Logger::CATEGORY_DECODER, "Open finished after %lld us in the queue. \n", (long long)(startUs - task->postUs));
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueueWait.record(startUs - task->postUs);
+		mOpenTime.record(endUs - startUs);
+		task->state = TASK_DONE;
+		task->open = nullptr;
+		mRunningCount--;
+		mDoneCondition.notify_all();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include "DecoderStats.h"
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//	Runs decoder opens (probing the input and opening the codecs) on a bounded set of worker threads.
+//	Queued opens start highest priority first, in request order within a priority, so the screens the host
+//	cares about are not stuck behind a scene load worth of other opens.
+class OpenExecutor {
+public:
+	enum TaskState { TASK_QUEUED, TASK_RUNNING, TASK_DONE, TASK_CANCELLED };
+
+	struct Task {
+		std::function<void()> open;
+		int priority;
+		int64_t sequence;
+		int64_t postUs;
+		TaskState state;
+	};
+
+	static OpenExecutor* instance();
+
+	//	Opens running at once, 0 for half the hardware concurrency, negative for no limit.
+	void setConcurrency(int concurrency);
+	int getConcurrency();
+
+	//	Any int, higher starts first. The priority can change until the open starts.
+	std::shared_ptr<Task> post(std::function<void()> open, int priority);
+	void setPriority(const std::shared_ptr<Task>& task, int priority);
+
+	//	True when the open was still queued and will never run. A running open is not affected.
+	bool cancel(const std::shared_ptr<Task>& task);
+
+	//	Blocks until the open has run or was cancelled.
+	void wait(const std::shared_ptr<Task>& task);
+
+	//	Queue wait and open time histograms cover every open since start or the last reset.
+	void getStats(int& queued, int& running, int64_t& cancelled, NativeHistogram& queueWait, NativeHistogram& openTime);
+	void resetStats();
+
+private:
+	OpenExecutor();
+
+	int getLimitLocked();
+	void spawnWorkersLocked();
+	void workerLoop();
+
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::condition_variable mDoneCondition;
+	std::vector<std::shared_ptr<Task>> mQueue;	//	Scanned for the best task, it only ever holds a scene load of opens.
+	int mConcurrency;
+	int mWorkerCount;
+	int mRunningCount;
+	int64_t mNextSequence;
+	int64_t mCancelledCount;
+	StatsHistogram mQueueWait;
+	StatsHistogram mOpenTime;
+
+	static OpenExecutor* _instance;
+};
\ No newline at end of file
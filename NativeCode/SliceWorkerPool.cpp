@@ -0,0 +1,113 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "SliceWorkerPool.h"
+#include "Logger.h"
+#include <algorithm>
+
+SliceWorkerPool* SliceWorkerPool::_instance;
+SliceWorkerPool::SliceWorkerPool() {
+	mIsStopping = false;
+	mThreadCount = 0;
+	int hardwareThreads = (int)std::thread::hardware_concurrency();
+	setThreadCount(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+}
+
+//	Decode threads of several decoders reach this concurrently, so creation is guarded.
+SliceWorkerPool* SliceWorkerPool::instance() {
+	static std::once_flag once;
+	std::call_once(once, []() { _instance = new SliceWorkerPool(); });
+	return _instance;
+}
+
+void SliceWorkerPool::run(int count, const std::function<void(int)>& task) {
+	if (count <= 1) {
+		if (count == 1) {
+			task(0);
+		}
+		return;
+	}
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->task = &task;
+	job->count = count;
+	job->next = 0;
+	job->finished = 0;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push_back(job);
+	}
+	mCondition.notify_all();
+
+	runSlices(*job);
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	auto it = std::find(mJobs.begin(), mJobs.end(), job);
+	if (it != mJobs.end()) {
+		mJobs.erase(it);
+	}
+	mDoneCondition.wait(lock, [&job]() { return job->finished == job->count; });
+}
+
+//	Workers are only restarted between frames, a job in flight is still finished by its caller.
+void SliceWorkerPool::setThreadCount(int threadCount) {
+	threadCount = std::max(threadCount, 0);
+	std::vector<std::thread> workers;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (threadCount == mThreadCount && (int)mWorkers.size() == threadCount) {
+			return;
+		}
+		mIsStopping = true;
+		workers.swap(mWorkers);
+	}
+	mCondition.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mIsStopping = false;
+	mThreadCount = threadCount;
+	for (int i = 0; i < threadCount; i++) {
+		mWorkers.push_back(std::thread(&SliceWorkerPool::workerLoop, this));
+	}
+	LOG_INFO(Logger::CATEGORY_VIDEO, "Slice worker threads: %d \n", threadCount);
+}
+
+int SliceWorkerPool::getThreadCount() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mThreadCount;
+}
+
+void SliceWorkerPool::workerLoop() {
+	while (true) {
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mIsStopping || !mJobs.empty(); });
+			if (mIsStopping) {
+				return;
+			}
+
+			job = mJobs.front();
+			if (job->next >= job->count) {
+				mJobs.pop_front();
+				continue;
+			}
+		}
+
+		runSlices(*job);
+	}
+}
+
+void SliceWorkerPool::runSlices(Job& job) {
+	int index = 0;
+	while ((index = job.next++) < job.count) {
+		(*job.task)(index);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (++job.finished == job.count) {
+			mDoneCondition.notify_all();
+		}
+	}
+}
\ No newline at end of file
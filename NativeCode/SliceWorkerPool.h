@@ -0,0 +1,48 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <vector>
+
+//	Worker threads shared by all decoders for slice-parallel work such as colour conversion of high resolution frames.
+//	The calling thread takes part in its own job, so a job always completes even when every worker is busy.
+class SliceWorkerPool {
+public:
+	static SliceWorkerPool* instance();
+
+	//	Run task(0) .. task(count - 1) in parallel and return once all of them finished.
+	void run(int count, const std::function<void(int)>& task);
+
+	//	Number of worker threads besides the caller. Defaults to the hardware concurrency minus one.
+	void setThreadCount(int threadCount);
+	int getThreadCount();
+
+private:
+	SliceWorkerPool();
+
+	struct Job {
+		const std::function<void(int)>* task;
+		int count;
+		std::atomic<int> next;
+		int finished;
+	};
+
+	void workerLoop();
+	void runSlices(Job& job);
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::condition_variable mDoneCondition;
+	std::deque<std::shared_ptr<Job>> mJobs;
+	bool mIsStopping;
+	int mThreadCount;
+
+	static SliceWorkerPool* _instance;
+};
\ No newline at end of file
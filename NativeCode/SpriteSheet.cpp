@@ -0,0 +1,268 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "SpriteSheet.h"
+#include "DecoderOptions.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+	const int MAX_PACKETS_PER_TILE = 256;	//	A tile whose key frame does not decode within this many packets stays black.
+	const int MAX_WORKERS = 8;
+
+	struct Layout {
+		int columns;
+		int rows;
+		int bytesPerPixel;
+		int64_t stride;
+	};
+
+	Layout getLayout(const SpriteSheet::Params& params) {
+		Layout layout;
+		int count = std::max(params.count, 1);
+		layout.columns = params.columns > 0 ? std::min(params.columns, count) : (int)ceil(sqrt((double)count));
+		layout.rows = (count + layout.columns - 1) / layout.columns;
+		layout.bytesPerPixel = params.videoOutputFormat == VIDEO_OUTPUT_RGBA ? 4 : 3;
+		layout.stride = (int64_t)layout.columns * std::max(params.tileWidth, 0) * layout.bytesPerPixel;
+		return layout;
+	}
+
+	//	One independent input and codec context, used by a single thread.
+	class Worker {
+	public:
+		Worker();
+		~Worker();
+
+		bool open(const char* filePath);
+		double getDuration();
+
+		//	Renders the key frame at or before time into cell, returns its time or -1.
+		double renderTile(double time, uint8_t* cell, const Layout& layout, const SpriteSheet::Params& params);
+
+	private:
+		void copyLastTile(uint8_t* cell, const Layout& layout, const SpriteSheet::Params& params);
+
+		AVFormatContext* mFormatContext;
+		AVCodecContext* mCodecContext;
+		AVStream* mStream;
+		AVFrame* mFrame;
+		SwsContext* mSwsContext;
+
+		int64_t mLastKeyTimestamp;		//	Key packet of the last rendered tile.
+		uint8_t* mLastCell;
+		double mLastTime;
+	};
+
+	Worker::Worker() {
+		mFormatContext = nullptr;
+		mCodecContext = nullptr;
+		mStream = nullptr;
+		mFrame = av_frame_alloc();
+		mSwsContext = nullptr;
+		mLastKeyTimestamp = AV_NOPTS_VALUE;
+		mLastCell = nullptr;
+		mLastTime = -1.0;
+	}
+
+	Worker::~Worker() {
+		sws_freeContext(mSwsContext);
+		av_frame_free(&mFrame);
+		avcodec_free_context(&mCodecContext);
+		if (mFormatContext != nullptr) {
+			avformat_close_input(&mFormatContext);
+		}
+	}
+
+	bool Worker::open(const char* filePath) {
+		if (avformat_open_input(&mFormatContext, filePath, nullptr, nullptr) < 0 ||
+			avformat_find_stream_info(mFormatContext, nullptr) < 0) {
+			return false;
+		}
+
+		int streamIndex = av_find_best_stream(mFormatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+		if (streamIndex < 0) {
+			return false;
+		}
+
+		for (unsigned int i = 0; i < mFormatContext->nb_streams; i++) {
+			mFormatContext->streams[i]->discard = (int)i == streamIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+		}
+		mStream = mFormatContext->streams[streamIndex];
+
+		AVCodec* codec = avcodec_find_decoder(mStream->codecpar->codec_id);
+		if (codec == nullptr) {
+			return false;
+		}
+
+		mCodecContext = avcodec_alloc_context3(codec);
+		if (mCodecContext == nullptr || avcodec_parameters_to_context(mCodecContext, mStream->codecpar) < 0) {
+			return false;
+		}
+
+		//	The workers are the parallelism. Previews only need key frames and tolerate skipping the loop filter.
+		mCodecContext->thread_count = 1;
+		mCodecContext->skip_frame = AVDISCARD_NONKEY;
+		mCodecContext->skip_loop_filter = AVDISCARD_ALL;
+		return avcodec_open2(mCodecContext, codec, nullptr) >= 0;
+	}
+
+	double Worker::getDuration() {
+		if (mStream->duration > 0) {
+			return mStream->duration * av_q2d(mStream->time_base);
+		}
+		return mFormatContext->duration > 0 ? (double)mFormatContext->duration / AV_TIME_BASE : -1.0;
+	}
+
+	double Worker::renderTile(double time, uint8_t* cell, const Layout& layout, const SpriteSheet::Params& params) {
+		TRACE_SCOPE("spriteTile", -1);
+		double timeBase = av_q2d(mStream->time_base);
+		int64_t startTime = mStream->start_time != AV_NOPTS_VALUE ? mStream->start_time : 0;
+		if (av_seek_frame(mFormatContext, mStream->index, startTime + (int64_t)(time / timeBase), AVSEEK_FLAG_BACKWARD) < 0) {
+			return -1.0;
+		}
+		avcodec_flush_buffers(mCodecContext);
+
+		AVPacket packet;
+		bool isKeyFound = false;
+		int isFrameAvailable = 0;
+		for (int i = 0; i < MAX_PACKETS_PER_TILE && !isFrameAvailable; i++) {
+			av_init_packet(&packet);
+			packet.data = nullptr;
+			packet.size = 0;
+			bool isEnd = av_read_frame(mFormatContext, &packet) < 0;
+			if (!isEnd && (packet.stream_index != mStream->index || !(packet.flags & AV_PKT_FLAG_KEY))) {
+				av_packet_unref(&packet);
+				continue;
+			}
+
+			//	Neighbouring tiles often land on the same key frame, the cell is copied instead of decoded again.
+			if (!isEnd && !isKeyFound) {
+				isKeyFound = true;
+				int64_t keyTimestamp = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+				if (keyTimestamp != AV_NOPTS_VALUE && keyTimestamp == mLastKeyTimestamp && mLastCell != nullptr) {
+					av_packet_unref(&packet);
+					copyLastTile(cell, layout, params);
+					return mLastTime;
+				}
+				mLastKeyTimestamp = keyTimestamp;
+			}
+
+			//	An empty packet at the end drains the frame the codec still holds.
+			if (avcodec_decode_video2(mCodecContext, mFrame, &isFrameAvailable, &packet) < 0) {
+				isFrameAvailable = 0;
+			}
+			av_packet_unref(&packet);
+			if (isEnd && !isFrameAvailable) {
+				break;
+			}
+		}
+
+		if (!isFrameAvailable) {
+			mLastKeyTimestamp = AV_NOPTS_VALUE;
+			return -1.0;
+		}
+
+		AVPixelFormat dstFormat = params.videoOutputFormat == VIDEO_OUTPUT_RGBA ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
+		mSwsContext = sws_getCachedContext(mSwsContext, mFrame->width, mFrame->height, (AVPixelFormat)mFrame->format,
+			params.tileWidth, params.tileHeight, dstFormat, SWS_BILINEAR, nullptr, nullptr, nullptr);
+		if (mSwsContext == nullptr) {
+			av_frame_unref(mFrame);
+			return -1.0;
+		}
+
+		uint8_t* dstData[4] = { cell, nullptr, nullptr, nullptr };
+		int dstStride[4] = { (int)layout.stride, 0, 0, 0 };
+		sws_scale(mSwsContext, mFrame->data, mFrame->linesize, 0, mFrame->height, dstData, dstStride);
+
+		int64_t timeStamp = av_frame_get_best_effort_timestamp(mFrame);
+		mLastTime = timeStamp != AV_NOPTS_VALUE ? std::max((timeStamp - startTime) * timeBase, 0.0) : time;
+		mLastCell = cell;
+		av_frame_unref(mFrame);
+		return mLastTime;
+	}
+
+	void Worker::copyLastTile(uint8_t* cell, const Layout& layout, const SpriteSheet::Params& params) {
+		size_t rowBytes = (size_t)params.tileWidth * layout.bytesPerPixel;
+		for (int y = 0; y < params.tileHeight; y++) {
+			memcpy(cell + y * layout.stride, mLastCell + y * layout.stride, rowBytes);
+		}
+	}
+}
+
+int64_t SpriteSheet::getAtlasSize(const Params& params) {
+	Layout layout = getLayout(params);
+	return layout.stride * layout.rows * std::max(params.tileHeight, 0);
+}
+
+int SpriteSheet::generate(const char* filePath, const Params& params, uint8_t* atlas, float* tileTimes) {
+	if (filePath == nullptr || atlas == nullptr || params.count <= 0 || params.tileWidth <= 0 || params.tileHeight <= 0) {
+		LOG_ERROR(Logger::CATEGORY_VIDEO, "Invalid sprite sheet parameters. \n");
+		return -1;
+	}
+
+	av_register_all();
+	Layout layout = getLayout(params);
+	memset(atlas, 0, (size_t)getAtlasSize(params));
+	for (int i = 0; tileTimes != nullptr && i < params.count; i++) {
+		tileTimes[i] = -1.0f;
+	}
+
+	//	The first worker also validates the input before any thread starts.
+	Worker firstWorker;
+	double duration = -1.0;
+	if (!firstWorker.open(filePath) || (duration = firstWorker.getDuration()) <= 0) {
+		LOG_ERROR(Logger::CATEGORY_VIDEO, "Sprite sheet needs a seekable video with a known duration. \n");
+		return -1;
+	}
+
+	int workerCount = params.workerCount > 0 ? params.workerCount : std::min((int)std::thread::hardware_concurrency(), MAX_WORKERS);
+	workerCount = std::max(1, std::min(workerCount, params.count));
+
+	//	Contiguous runs keep each worker seeking forward.
+	std::atomic<int> filledCount(0);
+	auto renderTiles = [&](Worker& worker, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			uint8_t* cell = atlas + (int64_t)(i / layout.columns) * params.tileHeight * layout.stride +
+				(int64_t)(i % layout.columns) * params.tileWidth * layout.bytesPerPixel;
+			double tileTime = worker.renderTile(duration * (i + 0.5) / params.count, cell, layout, params);
+			if (tileTime >= 0) {
+				filledCount++;
+				if (tileTimes != nullptr) {
+					tileTimes[i] = (float)tileTime;
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int w = 1; w < workerCount; w++) {
+		int begin = params.count * w / workerCount;
+		int end = params.count * (w + 1) / workerCount;
+		threads.emplace_back([&, begin, end]() {
+			Worker worker;
+			if (worker.open(filePath)) {
+				renderTiles(worker, begin, end);
+			} else {
+				LOG_WARNING(Logger::CATEGORY_VIDEO, "Sprite sheet worker could not open the input. \n");
+			}
+		});
+	}
+	renderTiles(firstWorker, 0, params.count / workerCount);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	LOG_INFO(Logger::CATEGORY_VIDEO, "Sprite sheet %d of %d tiles with %d workers. \n", filledCount.load(), params.count, workerCount);
+	return filledCount;
+}
\ No newline at end of file
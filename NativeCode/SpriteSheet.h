@@ -0,0 +1,27 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+
+//	Seek bar preview atlas: count tiles at evenly spaced times, laid out row major in columns.
+//	The times are split into contiguous runs across worker threads, each with its own input and codec context.
+//	A worker decodes only the key frame at or before each time and scales it straight into its atlas cell,
+//	a key frame shared by neighbouring tiles is decoded once and copied.
+class SpriteSheet {
+public:
+	struct Params {
+		int count;
+		int tileWidth;
+		int tileHeight;
+		int columns;			//	<= 0 for a square-ish grid.
+		int workerCount;		//	<= 0 picks one per core, capped by the tile count.
+		int videoOutputFormat;	//	VideoOutputFormat of the atlas.
+	};
+
+	//	Bytes the caller has to provide for the atlas.
+	static int64_t getAtlasSize(const Params& params);
+
+	//	Blocks until every worker is done. tileTimes, optional, receives the time of the key frame in each tile
+	//	or -1 for tiles that could not be decoded. Returns the number of tiles filled, -1 if the input is unusable.
+	static int generate(const char* filePath, const Params& params, uint8_t* atlas, float* tileTimes);
+};
\ No newline at end of file
@@ -0,0 +1,144 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "Tracer.h"
+#include "Logger.h"
+#include <stdio.h>
+#include <chrono>
+
+#pragma warning(disable:4996)
+
+std::atomic<bool> Tracer::sIsEnabled(false);
+Tracer* Tracer::_instance;
+
+Tracer::Tracer() {
+	mNextThreadId = 1;
+}
+
+Tracer* Tracer::instance() {
+	static std::once_flag once;
+	std::call_once(once, []() { _instance = new Tracer(); });
+	return _instance;
+}
+
+void Tracer::setEnabled(bool isEnabled) {
+	if (isEnabled && !sIsEnabled.load()) {
+		instance()->clear();
+	}
+	sIsEnabled.store(isEnabled);
+}
+
+int64_t Tracer::nowUs() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Tracer::ThreadBuffer* Tracer::getThreadBuffer() {
+	thread_local ThreadBufferOwner owner;
+	if (owner.buffer == nullptr) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		std::unique_ptr<ThreadBuffer> buffer;
+		if (!mFreeBuffers.empty()) {
+			buffer = std::move(mFreeBuffers.back());
+			mFreeBuffers.pop_back();
+		} else {
+			buffer = std::make_unique<ThreadBuffer>();
+		}
+		buffer->threadId = mNextThreadId++;
+		buffer->next = 0;
+		buffer->isExited = false;
+		owner.buffer = buffer.get();
+		mBuffers.push_back(std::move(buffer));
+	}
+	return owner.buffer;
+}
+
+//	The events stay for the next dump, up to MAX_EXITED_BUFFERS threads. A buffer without any is free right away.
+Tracer::ThreadBufferOwner::~ThreadBufferOwner() {
+	if (buffer == nullptr) {
+		return;
+	}
+
+	Tracer* tracer = Tracer::instance();
+	std::lock_guard<std::mutex> lock(tracer->mMutex);
+	buffer->isExited = true;
+	tracer->recycleExitedBuffers(false);
+}
+
+//	Called with mMutex held. After a dump or clear every exited buffer goes, otherwise those without events and the
+//	oldest beyond MAX_EXITED_BUFFERS. Free buffers beyond MAX_FREE_BUFFERS are deleted.
+void Tracer::recycleExitedBuffers(bool isAll) {
+	size_t exitedCount = 0;
+	for (std::unique_ptr<ThreadBuffer>& buffer : mBuffers) {
+		exitedCount += buffer->isExited ? 1 : 0;
+	}
+
+	for (auto it = mBuffers.begin(); it != mBuffers.end();) {
+		ThreadBuffer* buffer = it->get();
+		if (!buffer->isExited || !(isAll || buffer->next == 0 || exitedCount > MAX_EXITED_BUFFERS)) {
+			it++;
+			continue;
+		}
+		exitedCount--;
+
+		if (mFreeBuffers.size() < MAX_FREE_BUFFERS) {
+			mFreeBuffers.push_back(std::move(*it));
+		}
+		it = mBuffers.erase(it);
+	}
+}
+
+//	The oldest events of a thread are overwritten once its ring is full.
+void Tracer::record(const char* name, int decoderId, int64_t beginUs, int64_t endUs) {
+	ThreadBuffer* buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(buffer->mutex);
+	Event& event = buffer->events[buffer->next % RING_SIZE];
+	event.name = name;
+	event.decoderId = decoderId;
+	event.beginUs = beginUs;
+	event.durationUs = endUs - beginUs;
+	buffer->next++;
+}
+
+void Tracer::clear() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (std::unique_ptr<ThreadBuffer>& buffer : mBuffers) {
+		std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+		buffer->next = 0;
+	}
+	recycleExitedBuffers(true);
+}
+
+bool Tracer::dump(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) {
+		LOG_ERROR(Logger::CATEGORY_GENERAL, "Can not open trace file %s. \n", path);
+		return false;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ViveMediaDecoder\"}}");
+	int64_t eventCount = 0;
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (std::unique_ptr<ThreadBuffer>& buffer : mBuffers) {
+		std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+		if (buffer->next == 0) {
+			continue;
+		}
+
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+			buffer->threadId, buffer->threadId);
+		uint64_t first = buffer->next > RING_SIZE ? buffer->next - RING_SIZE : 0;
+		for (uint64_t i = first; i < buffer->next; i++) {
+			const Event& event = buffer->events[i % RING_SIZE];
+			fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"decoder\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d,\"args\":{\"decoder\":%d}}",
+				event.name, (long long)event.beginUs, (long long)event.durationUs, buffer->threadId, event.decoderId);
+			eventCount++;
+		}
+	}
+	recycleExitedBuffers(true);
+	fprintf(file, "\n]}\n");
+	bool isSuccess = ferror(file) == 0;
+	fclose(file);
+
+	LOG_INFO(Logger::CATEGORY_GENERAL, "Trace dumped, %lld events. \n", (long long)eventCount);
+	return isSuccess;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+//	Scoped timeline events, TRACE_SCOPE("decode", id) records a complete event from here to the end of the scope.
+//	Names must be string literals. When tracing is disabled a scope costs one relaxed load.
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name, decoderId) TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name, decoderId)
+
+//	Events go to a ring buffer of the recording thread and are written as Chrome trace-event JSON on demand,
+//	which chrome://tracing and Perfetto open directly.
+class Tracer {
+public:
+	static Tracer* instance();
+
+	static inline bool isEnabled() {
+		return sIsEnabled.load(std::memory_order_relaxed);
+	}
+
+	//	Enabling clears the events of the previous session.
+	static void setEnabled(bool isEnabled);
+
+	static int64_t nowUs();
+	void record(const char* name, int decoderId, int64_t beginUs, int64_t endUs);
+	bool dump(const char* path);
+
+private:
+	Tracer();
+
+	static const int RING_SIZE = 16384;
+	static const size_t MAX_FREE_BUFFERS = 8;
+	static const size_t MAX_EXITED_BUFFERS = 64;
+
+	struct Event {
+		const char* name;
+		int decoderId;
+		int64_t beginUs;
+		int64_t durationUs;
+	};
+
+	//	Owned by the tracer, so the events of finished threads survive until the next dump or clear. After that the
+	//	buffer is reused by a new thread, so threads that come and go do not grow the tracer.
+	struct ThreadBuffer {
+		int threadId;
+		uint64_t next;
+		bool isExited;			//	Guarded by the tracer mutex.
+		std::mutex mutex;		//	Only contended while dumping.
+		Event events[RING_SIZE];
+	};
+
+	//	Thread local, hands the buffer back when its thread exits.
+	struct ThreadBufferOwner {
+		ThreadBuffer* buffer = nullptr;
+		~ThreadBufferOwner();
+	};
+
+	ThreadBuffer* getThreadBuffer();
+	void clear();
+	void recycleExitedBuffers(bool isAll);
+
+	std::mutex mMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> mBuffers;
+	std::vector<std::unique_ptr<ThreadBuffer>> mFreeBuffers;
+	int mNextThreadId;
+
+	static std::atomic<bool> sIsEnabled;
+	static Tracer* _instance;
+};
+
+class TraceScope {
+public:
+	TraceScope(const char* name, int decoderId) {
+		mName = Tracer::isEnabled() ? name : nullptr;
+		if (mName != nullptr) {
+			mDecoderId = decoderId;
+			mBeginUs = Tracer::nowUs();
+		}
+	}
+
+	~TraceScope() {
+		if (mName != nullptr) {
+			Tracer::instance()->record(mName, mDecoderId, mBeginUs, Tracer::nowUs());
+		}
+	}
+
+private:
+	const char* mName;
+	int mDecoderId;
+	int64_t mBeginUs;
+};
\ No newline at end of file
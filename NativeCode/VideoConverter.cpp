@@ -0,0 +1,139 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#include "VideoConverter.h"
+#include "ColorConvert.h"
+#include "SliceWorkerPool.h"
+#include "Logger.h"
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+static const int MIN_BAND_ROWS = 64;
+
+//	Band boundaries are aligned to 4 rows so every band starts on a chroma row of vertically subsampled formats.
+static int getBandRow(int height, int index, int count) {
+	if (index >= count) {
+		return height;
+	}
+	return (int)((int64_t)height * index / count) & ~3;
+}
+
+//	Matrices other than BT.601/BT.709 are left to swscale. Unspecified ones follow the usual SD/HD convention.
+static bool getColorMatrix(const AVFrame* frame, ColorConvert::Matrix& matrix) {
+	switch (frame->colorspace) {
+	case AVCOL_SPC_BT709:
+		matrix = ColorConvert::BT709;
+		return true;
+	case AVCOL_SPC_BT470BG:
+	case AVCOL_SPC_SMPTE170M:
+		matrix = ColorConvert::BT601;
+		return true;
+	case AVCOL_SPC_UNSPECIFIED:
+		matrix = frame->height > 576 ? ColorConvert::BT709 : ColorConvert::BT601;
+		return true;
+	default:
+		return false;
+	}
+}
+
+VideoConverter::VideoConverter() {
+	mSliceThreshold = 1920 * 1080;
+	mIsKernelEnabled = true;
+}
+
+VideoConverter::~VideoConverter() {
+	for (Band& band : mBands) {
+		sws_freeContext(band.swsContext);
+	}
+}
+
+void VideoConverter::setSliceThreshold(int64_t pixels) {
+	mSliceThreshold = pixels;
+}
+
+void VideoConverter::setKernelEnabled(bool isEnabled) {
+	mIsKernelEnabled = isEnabled;
+}
+
+int VideoConverter::getSliceCount(const AVFrame* srcFrame) {
+	if ((int64_t)srcFrame->width * srcFrame->height <= mSliceThreshold) {
+		return 1;
+	}
+
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get((AVPixelFormat)srcFrame->format);
+	if (desc == nullptr || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM)) != 0) {
+		return 1;
+	}
+
+	int count = SliceWorkerPool::instance()->getThreadCount() + 1;
+	return std::max(1, std::min(count, srcFrame->height / MIN_BAND_ROWS));
+}
+
+void VideoConverter::convert(const AVFrame* srcFrame, AVFrame* dstFrame, AVPixelFormat dstFormat) {
+	int width = srcFrame->width;
+	int height = srcFrame->height;
+	AVPixelFormat srcFormat = (AVPixelFormat)srcFrame->format;
+	bool isFullRange = srcFrame->color_range == AVCOL_RANGE_JPEG || srcFormat == AV_PIX_FMT_YUVJ420P;
+	int sliceCount = getSliceCount(srcFrame);
+
+	ColorConvert::Matrix matrix = ColorConvert::BT601;
+	bool isMatrixSupported = getColorMatrix(srcFrame, matrix);
+	bool isSourceSupported = srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVJ420P || srcFormat == AV_PIX_FMT_NV12;
+	bool isDestSupported = dstFormat == AV_PIX_FMT_RGB24 || dstFormat == AV_PIX_FMT_RGBA;
+	if (mIsKernelEnabled && isMatrixSupported && isSourceSupported && isDestSupported) {
+		ColorConvert::Coefficients coef = ColorConvert::getCoefficients(matrix, isFullRange);
+		ColorConvert::SourceFormat kernelSrcFormat = srcFormat == AV_PIX_FMT_NV12 ? ColorConvert::NV12 : ColorConvert::YUV420P;
+		ColorConvert::DestFormat kernelDstFormat = dstFormat == AV_PIX_FMT_RGBA ? ColorConvert::RGBA : ColorConvert::RGB24;
+		SliceWorkerPool::instance()->run(sliceCount, [&](int index) {
+			ColorConvert::convert(kernelSrcFormat, kernelDstFormat, coef, srcFrame->data, srcFrame->linesize, dstFrame->data[0], dstFrame->linesize[0],
+				width, getBandRow(height, index, sliceCount), getBandRow(height, index + 1, sliceCount));
+		});
+		return;
+	}
+
+	int colorspace = srcFrame->colorspace;
+	if (srcFrame->colorspace == AVCOL_SPC_UNSPECIFIED) {
+		colorspace = matrix == ColorConvert::BT709 ? SWS_CS_ITU709 : SWS_CS_DEFAULT;
+	}
+
+	while ((int)mBands.size() < sliceCount) {
+		mBands.push_back({ nullptr, -1 });
+	}
+	SliceWorkerPool::instance()->run(sliceCount, [&](int index) {
+		convertBandWithSwscale(mBands[index], srcFrame, dstFrame, dstFormat,
+			getBandRow(height, index, sliceCount), getBandRow(height, index + 1, sliceCount), colorspace, isFullRange);
+	});
+}
+
+//	Each band owns a swscale context sized to the band, fed with plane pointers offset to its first row.
+void VideoConverter::convertBandWithSwscale(Band& band, const AVFrame* srcFrame, AVFrame* dstFrame, AVPixelFormat dstFormat,
+	int rowBegin, int rowEnd, int colorspace, bool isFullRange) {
+	int width = srcFrame->width;
+	int bandHeight = rowEnd - rowBegin;
+	AVPixelFormat srcFormat = (AVPixelFormat)srcFrame->format;
+	band.swsContext = sws_getCachedContext(band.swsContext, width, bandHeight, srcFormat, width, bandHeight, dstFormat, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+	if (band.swsContext == nullptr) {
+		LOG_ERROR(Logger::CATEGORY_VIDEO, "Unsupported video conversion. \n");
+		return;
+	}
+
+	//	swscale drops the colorspace details whenever it reallocates the context, so they are applied again on any configuration change.
+	int64_t swsConfig = ((int64_t)width << 40) | ((int64_t)bandHeight << 24) | ((int64_t)srcFormat << 8) | (colorspace << 1) | (isFullRange ? 1 : 0);
+	if (swsConfig != band.swsConfig) {
+		sws_setColorspaceDetails(band.swsContext, sws_getCoefficients(colorspace), isFullRange ? 1 : 0, sws_getCoefficients(SWS_CS_DEFAULT), 1, 0, 1 << 16, 1 << 16);
+		band.swsConfig = swsConfig;
+	}
+
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(srcFormat);
+	int chromaShift = desc != nullptr ? desc->log2_chroma_h : 0;
+	const uint8_t* src[4] = { nullptr, nullptr, nullptr, nullptr };
+	for (int plane = 0; plane < 4 && srcFrame->data[plane] != nullptr; plane++) {
+		int row = (plane == 1 || plane == 2) ? rowBegin >> chromaShift : rowBegin;
+		src[plane] = srcFrame->data[plane] + (ptrdiff_t)row * srcFrame->linesize[plane];
+	}
+	uint8_t* dst[4] = { dstFrame->data[0] + (ptrdiff_t)rowBegin * dstFrame->linesize[0], nullptr, nullptr, nullptr };
+
+	sws_scale(band.swsContext, src, srcFrame->linesize, 0, bandHeight, dst, dstFrame->linesize);
+}
\ No newline at end of file
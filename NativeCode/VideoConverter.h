@@ -0,0 +1,40 @@
+//========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
+
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+//	Same size conversion of decoded frames to RGB. YUV420P/NV12 use the SIMD kernels of ColorConvert, everything else goes through swscale.
+//	Frames above the slice threshold are split into horizontal bands converted in parallel on SliceWorkerPool,
+//	each band with its own swscale context.
+class VideoConverter {
+public:
+	VideoConverter();
+	~VideoConverter();
+
+	void convert(const AVFrame* srcFrame, AVFrame* dstFrame, AVPixelFormat dstFormat);
+
+	//	Pixel count above which frames are sliced, <= 0 slices every frame.
+	void setSliceThreshold(int64_t pixels);
+	//	Disable the SIMD kernels to force swscale, mainly for benchmarks.
+	void setKernelEnabled(bool isEnabled);
+
+private:
+	struct Band {
+		SwsContext* swsContext;
+		int64_t swsConfig;			//	Size, format and colorspace the colorspace details were set for.
+	};
+
+	int getSliceCount(const AVFrame* srcFrame);
+	void convertBandWithSwscale(Band& band, const AVFrame* srcFrame, AVFrame* dstFrame, AVPixelFormat dstFormat,
+		int rowBegin, int rowEnd, int colorspace, bool isFullRange);
+
+	std::vector<Band> mBands;
+	int64_t mSliceThreshold;
+	bool mIsKernelEnabled;
+};
\ No newline at end of file
@@ -2,40 +2,84 @@
 
 #include "ViveMediaDecoder.h"
 #include "AVHandler.h"
+#include "DecoderReaper.h"
+#include "FrameLeases.h"
+#include "CodecPool.h"
+#include "CodecThreadBudget.h"
+#include "MediaClock.h"
+#include "OpenExecutor.h"
+#include "SpriteSheet.h"
 #include "Logger.h"
+#include "Tracer.h"
 #include <stdio.h>
 #include <string>
 #include <memory>
-#include <thread>
 #include <list>
+#include <atomic>
+#include <thread>
 #include <cstring>
 
 typedef struct _VideoContext {
 	int id = -1;
 	std::string path = "";
-    std::thread initThread;
-    bool initThreadRunning = false;
+    std::shared_ptr<OpenExecutor::Task> openTask;	//	Last open or resume posted to the executor.
+    int openPriority = CodecThreadBudget::PRIORITY_NORMAL;
     bool destroying = false;
     std::unique_ptr<AVHandler> avhandler = nullptr;
 	float progressTime = 0.0f;
 	float lastUpdateTime = -1.0f;
-    bool videoFrameLocked = false;
+    int64_t videoFrameLease = 0;		//	Lease behind nativeGrabVideoFrame, 0 when the host holds none.
 	bool isContentReady = false;	//	This flag is used to indicate the period that seek over until first data is got.
 									//	Usually used for AV sync problem, in pure audio case, it should be discard.
+	MediaClock clock;
 } VideoContext;
 
 std::list<std::shared_ptr<VideoContext>> videoContexts;
 typedef std::list<std::shared_ptr<VideoContext>>::iterator VideoContextIter;
 
-bool getVideoContext(int id, std::shared_ptr<VideoContext>& videoCtx) {
+//	The host audio thread never walks videoContexts. It finds a ring through a fixed table of slots indexed by
+//	decoder id, published when the ring is enabled and withdrawn by nativeDestroyDecoder before the handler goes
+//	to the reaper. A withdraw waits out the readers of its slot, each of which is one wait free ring read.
+const int AUDIO_RING_SLOT_COUNT = 256;
+
+struct AudioRingSlot {
+	std::atomic<AVHandler*> avhandler;
+	std::atomic<int> readers;
+};
+
+static AudioRingSlot audioRingSlots[AUDIO_RING_SLOT_COUNT];
+
+static void withdrawAudioRing(int id) {
+	if (id < 0 || id >= AUDIO_RING_SLOT_COUNT) {
+		return;
+	}
+
+	AudioRingSlot& slot = audioRingSlots[id];
+	if (slot.avhandler.exchange(nullptr) == nullptr) {
+		return;
+	}
+	while (slot.readers.load() > 0) {
+		std::this_thread::yield();
+	}
+}
+
+//	Quiet lookup, also used to probe for a free id.
+static bool findVideoContext(int id, std::shared_ptr<VideoContext>& videoCtx) {
 	for (VideoContextIter it = videoContexts.begin(); it != videoContexts.end(); it++) {
 		if ((*it)->id == id) {
 			videoCtx = *it;
 			return true;
 		}
 	}
+	return false;
+}
 
-	LOG("Decoder does not exist. \n");
+bool getVideoContext(int id, std::shared_ptr<VideoContext>& videoCtx) {
+	if (findVideoContext(id, videoCtx)) {
+		return true;
+	}
+
+	LOG_WARNING(Logger::CATEGORY_API, "Decoder does not exist. \n");
 	return false;
 }
 
@@ -57,12 +101,15 @@ void nativeCleanAll() {
     for(int id : idList) {
         nativeDestroyDecoder(id);
     }
+
+	//	Used on shutdown, so wait until every teardown is done before the library can be unloaded.
+	DecoderReaper::instance()->waitIdle();
 }
 
 void nativeCleanDestroyedDecoders() {
     std::list<int> idList;
     for(auto videoCtx : videoContexts) {
-        if (videoCtx->destroying && !videoCtx->avhandler->isDecoderRunning() && !videoCtx->initThreadRunning) {
+        if (videoCtx->destroying) {
             idList.push_back(videoCtx->id);
         }
     }
@@ -72,24 +119,34 @@ void nativeCleanDestroyedDecoders() {
     }
 }
 
-int nativeCreateDecoderAsync(const char* filePath, int& id) {
-	LOG("Query available decoder id. \n");
+std::shared_ptr<VideoContext> createVideoContext(const char* filePath, const NativeDecoderOptions* options = nullptr) {
+	LOG_INFO(Logger::CATEGORY_API, "Query available decoder id. \n");
 
 	int newID = 0;
-    std::shared_ptr<VideoContext> videoCtx;
-	while (getVideoContext(newID, videoCtx)) { newID++; }
+	std::shared_ptr<VideoContext> videoCtx;
+	while (findVideoContext(newID, videoCtx)) { newID++; }
 
 	videoCtx = std::make_shared<VideoContext>();
-	videoCtx->avhandler = std::make_unique<AVHandler>();
+	videoCtx->avhandler = std::make_unique<AVHandler>(newID, options);
 	videoCtx->id = newID;
-	id = videoCtx->id;
 	videoCtx->path = std::string(filePath);
 	videoCtx->isContentReady = false;
+	videoCtx->openPriority = options != nullptr ? options->priority : DecoderOptions::getDefaults().priority;
+
+	return videoCtx;
+}
+
+//	Async opens are queued by priority and run by the executor, a bounded number at a time.
+static void postOpen(const std::shared_ptr<VideoContext>& videoCtx, std::function<void()> open) {
+	videoCtx->openTask = OpenExecutor::instance()->post(open, videoCtx->openPriority);
+}
+
+int nativeCreateDecoderAsync(const char* filePath, int& id) {
+	std::shared_ptr<VideoContext> videoCtx = createVideoContext(filePath);
+	id = videoCtx->id;
 
-    videoCtx->initThreadRunning = true;
-	videoCtx->initThread = std::thread([videoCtx]() {
+	postOpen(videoCtx, [videoCtx]() {
 		videoCtx->avhandler->init(videoCtx->path.c_str());
-        videoCtx->initThreadRunning = false;
 	});
 
 	videoContexts.push_back(videoCtx);
@@ -97,20 +154,47 @@ int nativeCreateDecoderAsync(const char* filePath, int& id) {
 	return 0;
 }
 
+//	Async init which also decodes the first frame at startTime, so it is available as soon as decoding starts.
+int nativeCreateDecoderPrerollAsync(const char* filePath, float startTime, int& id) {
+	std::shared_ptr<VideoContext> videoCtx = createVideoContext(filePath);
+	id = videoCtx->id;
+
+	postOpen(videoCtx, [videoCtx, startTime]() {
+		videoCtx->avhandler->init(videoCtx->path.c_str(), true, startTime);
+	});
+
+	videoContexts.push_back(videoCtx);
+
+	return 0;
+}
+
+//	Options are copied, so the caller may reuse them right away. A negative prerollTime skips the preroll.
+int nativeCreateDecoderWithOptionsAsync(const char* filePath, const NativeDecoderOptions& options, float prerollTime, int& id) {
+	std::shared_ptr<VideoContext> videoCtx = createVideoContext(filePath, &options);
+	id = videoCtx->id;
+
+	postOpen(videoCtx, [videoCtx, prerollTime]() {
+		videoCtx->avhandler->init(videoCtx->path.c_str(), prerollTime >= 0.0f, prerollTime >= 0.0f ? prerollTime : 0.0);
+	});
+
+	videoContexts.push_back(videoCtx);
+
+	return 0;
+}
+
+void nativeGetDefaultDecoderOptions(NativeDecoderOptions& options) {
+	options = DecoderOptions::getDefaults();
+}
+
+void nativeSetDefaultDecoderOptions(const NativeDecoderOptions& options) {
+	DecoderOptions::setDefaults(options);
+}
+
 //	Synchronized init. Used for thumbnail currently.
 int nativeCreateDecoder(const char* filePath, int& id) {
-	LOG("Query available decoder id. \n");
-
-	int newID = 0;
-    std::shared_ptr<VideoContext> videoCtx;
-	while (getVideoContext(newID, videoCtx)) { newID++; }
-
-    videoCtx = std::make_shared<VideoContext>();
-    videoCtx->avhandler = std::make_unique<AVHandler>();
-    videoCtx->id = newID;
-    id = videoCtx->id;
-    videoCtx->path = std::string(filePath);
-    videoCtx->isContentReady = false;
+	std::shared_ptr<VideoContext> videoCtx = createVideoContext(filePath);
+	id = videoCtx->id;
+	videoCtx->avhandler->setPriority(CodecThreadBudget::PRIORITY_LOW);
 	videoCtx->avhandler->init(filePath);
 
 	videoContexts.push_back(videoCtx);
@@ -129,9 +213,8 @@ bool nativeStartDecoding(int id) {
     std::shared_ptr<VideoContext> videoCtx;
 	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return false; }
 
-	if (videoCtx->initThread.joinable()) {
-		videoCtx->initThread.join();
-	}
+	//	Blocks while the open is still queued or running, poll nativeGetDecoderState first to avoid it.
+	OpenExecutor::instance()->wait(videoCtx->openTask);
 
 	AVHandler* avhandler = videoCtx->avhandler.get();
 	if (avhandler->getDecoderState() >= AVHandler::DecoderState::INITIALIZED) {
@@ -152,23 +235,208 @@ void nativeScheduleDestroyDecoder(int id) {
     videoCtx->destroying = true;
 }
 
+//	The decoder is detached right away, joining its threads and freeing its resources is done by the reaper thread.
 void nativeDestroyDecoder(int id) {
     std::shared_ptr<VideoContext> videoCtx;
 	if (!getVideoContext(id, videoCtx)) { return; }
 
-	if (videoCtx->initThread.joinable()) {
-		videoCtx->initThread.join();
+	//	Abort a blocking open or read, otherwise the teardown could wait until the network times out.
+	if (videoCtx->avhandler != nullptr) {
+		videoCtx->avhandler->stop();
 	}
+	OpenExecutor::instance()->cancel(videoCtx->openTask);
+
+	//	Ids are reused right away, so the slot is empty before the id is free again.
+	withdrawAudioRing(videoCtx->id);
+	removeVideoContext(videoCtx->id);
+	videoCtx->id = -1;
+
+	int64_t bytes = videoCtx->avhandler != nullptr ? videoCtx->avhandler->getMemoryUsage() : 0;
+	DecoderReaper::instance()->post([videoCtx]() {
+		OpenExecutor::instance()->wait(videoCtx->openTask);
+		videoCtx->openTask = nullptr;
+
+		//	The grabbed frame can not be released by id any more, leases taken by the host stay its own.
+		if (videoCtx->videoFrameLease != 0) {
+			FrameLeases::releaseHandle(videoCtx->videoFrameLease);
+			videoCtx->videoFrameLease = 0;
+		}
+		videoCtx->avhandler.reset();
 
-	videoCtx->avhandler.reset();
+		videoCtx->path.clear();
+		videoCtx->progressTime = 0.0f;
+		videoCtx->lastUpdateTime = 0.0f;
+		videoCtx->isContentReady = false;
+	}, bytes);
+}
+
+//	Returns at once, the decode thread is joined and the codecs freed on the reaper. Poll nativeGetDecoderState until
+//	HIBERNATED before resuming. A grabbed video frame is freed as well, the host must not use its data afterwards.
+//	Leased frames stay valid.
+bool nativeHibernateDecoder(int id, bool isCloseInput) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return false; }
+
+	if (!videoCtx->avhandler->beginHibernate()) {
+		return false;
+	}
 
-	videoCtx->path.clear();
-	videoCtx->progressTime = 0.0f;
-	videoCtx->lastUpdateTime = 0.0f;
+	int64_t bytes = videoCtx->avhandler->getMemoryUsage();
+	DecoderReaper::instance()->post([videoCtx, isCloseInput]() {
+		videoCtx->avhandler->finishHibernate(isCloseInput);
+	}, bytes);
 
+	if (videoCtx->videoFrameLease != 0) {
+		videoCtx->avhandler->releaseVideoFrame(videoCtx->videoFrameLease);
+		videoCtx->videoFrameLease = 0;
+	}
+	videoCtx->lastUpdateTime = -1.0f;
 	videoCtx->isContentReady = false;
-	removeVideoContext(videoCtx->id);
-	videoCtx->id = -1;
+	return true;
+}
+
+//	Poll nativeGetDecoderState until INITIALIZED and start decoding again, as after nativeCreateDecoderAsync.
+void nativeResumeDecoderAsync(int id) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return; }
+
+	if (videoCtx->avhandler->getDecoderState() != AVHandler::DecoderState::HIBERNATED) {
+		LOG_WARNING(Logger::CATEGORY_API, "Decoder is not hibernated. \n");
+		return;
+	}
+
+	OpenExecutor::instance()->wait(videoCtx->openTask);
+	postOpen(videoCtx, [videoCtx]() {
+		videoCtx->avhandler->resume();
+	});
+}
+
+void nativeGetPendingTeardowns(int& count, long long& bytes) {
+	count = DecoderReaper::instance()->getPendingCount();
+	bytes = DecoderReaper::instance()->getPendingBytes();
+}
+
+//	Number of idle codec contexts kept for reuse, 0 disables the pool.
+void nativeSetCodecPoolSize(int size) {
+	CodecPool::instance()->setCapacity(size);
+}
+
+void nativeGetCodecPoolStats(int& idleCount, int& hitCount, int& missCount) {
+	CodecPool::instance()->getStats(idleCount, hitCount, missCount);
+}
+
+void nativeSetCodecThreadBudget(int threadCount) {
+	CodecThreadBudget::instance()->setBudget(threadCount);
+}
+
+void nativeGetCodecThreadStats(int& budget, int& liveDecoders, int& allocatedThreads) {
+	budget = CodecThreadBudget::instance()->getBudget();
+	CodecThreadBudget::instance()->getStats(liveDecoders, allocatedThreads);
+}
+
+//	Async opens and resumes running at once, 0 for half the cores, negative for no limit.
+void nativeSetOpenConcurrency(int concurrency) {
+	OpenExecutor::instance()->setConcurrency(concurrency);
+}
+
+void nativeGetOpenStats(int& concurrency, int& queued, int& running, long long& cancelled, NativeHistogram& queueWait, NativeHistogram& openTime) {
+	int64_t cancelledCount = 0;
+	concurrency = OpenExecutor::instance()->getConcurrency();
+	OpenExecutor::instance()->getStats(queued, running, cancelledCount, queueWait, openTime);
+	cancelled = cancelledCount;
+}
+
+void nativeResetOpenStats() {
+	OpenExecutor::instance()->resetStats();
+}
+
+//	Reorders a queued open right away. The codec thread share is fixed when the video codec opens,
+//	so call it right after creating the decoder for that part to apply.
+void nativeSetDecoderPriority(int id, int priority) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return; }
+
+	videoCtx->avhandler->setPriority(priority);
+	videoCtx->openPriority = priority;
+	OpenExecutor::instance()->setPriority(videoCtx->openTask, priority);
+}
+
+//	For small or distant screens. Frames over the cap are dropped before conversion, audio and frame times are untouched.
+//	Can change at any time, <= 0 removes the cap.
+void nativeSetMaxFrameRate(int id, float maxFrameRate) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return; }
+
+	videoCtx->avhandler->setMaxFrameRate(maxFrameRate);
+}
+
+void nativeGetStartupTimings(int id, float& open, float& streamInfo, float& codecOpen, float& firstPacket, float& firstFrame) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return; }
+
+	IDecoder::StartupTimings timings = videoCtx->avhandler->getStartupTimings();
+	open = (float)(timings.open);
+	streamInfo = (float)(timings.streamInfo);
+	codecOpen = (float)(timings.codecOpen);
+	firstPacket = (float)(timings.firstPacket);
+	firstFrame = (float)(timings.firstFrame);
+}
+
+//	Cheap enough to be polled every frame, every value is a relaxed atomic load.
+bool nativeGetDecoderStats(int id, NativeDecoderStats& stats) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return false; }
+
+	DecoderStats* decoderStats = videoCtx->avhandler->getStats();
+	if (decoderStats == nullptr) { return false; }
+
+	decoderStats->snapshot(stats);
+	stats.audioUnderruns = videoCtx->avhandler->getAudioRingUnderruns();
+	return true;
+}
+
+void nativeResetDecoderStats(int id) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return; }
+
+	DecoderStats* decoderStats = videoCtx->avhandler->getStats();
+	if (decoderStats != nullptr) {
+		decoderStats->reset();
+	}
+	videoCtx->avhandler->resetAudioRingUnderruns();
+}
+
+//	Seconds behind the live edge and the clock rate used to catch up, false when the decoder is not in live mode.
+bool nativeGetLiveLatency(int id, float& latency, float& rate) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return false; }
+
+	double liveLatency = 0.0, liveRate = 1.0;
+	if (!videoCtx->avhandler->getLiveLatency(liveLatency, liveRate)) {
+		return false;
+	}
+
+	latency = (float)liveLatency;
+	rate = (float)liveRate;
+	return true;
+}
+
+void nativeSetLogLevel(int level, int categories) {
+	Logger::setLevel((Logger::Level)level, categories);
+}
+
+void nativeSetTraceEnabled(bool isEnabled) {
+	Tracer::setEnabled(isEnabled);
+}
+
+bool nativeDumpTrace(const char* path) {
+	return Tracer::instance()->dump(path);
+}
+
+void nativeFlushLog() {
+	if (Logger::isEnabled(Logger::LEVEL_ERROR, Logger::CATEGORY_ALL)) {
+		Logger::instance()->flush();
+	}
 }
 
 //	Video
@@ -177,12 +445,12 @@ bool nativeIsVideoEnabled(int id) {
 	if (!getVideoContext(id, videoCtx)) { return false; }
 
 	if (videoCtx->avhandler->getDecoderState() < AVHandler::DecoderState::INITIALIZED) {
-		LOG("Decoder is unavailable currently. \n");
+		LOG_VERBOSE(Logger::CATEGORY_API, "Decoder is unavailable currently. \n");
 		return false;
 	}
 
 	bool ret = videoCtx->avhandler->getVideoInfo().isEnabled;
-	LOG("nativeIsVideoEnabled: %s \n", ret ? "true" : "false");
+	LOG_INFO(Logger::CATEGORY_API, "nativeIsVideoEnabled: %s \n", ret ? "true" : "false");
 	return ret;
 }
 
@@ -191,7 +459,7 @@ void nativeGetVideoFormat(int id, int& width, int& height, float& totalTime) {
 	if (!getVideoContext(id, videoCtx)) { return; }
 
 	if (videoCtx->avhandler->getDecoderState() < AVHandler::DecoderState::INITIALIZED) {
-		LOG("Decoder is unavailable currently. \n");
+		LOG_VERBOSE(Logger::CATEGORY_API, "Decoder is unavailable currently. \n");
 		return;
 	}
 
@@ -205,7 +473,9 @@ void nativeSetVideoTime(int id, float currentTime) {
     std::shared_ptr<VideoContext> videoCtx;
 	if (!getVideoContext(id, videoCtx)) { return; }
 
-	videoCtx->progressTime = currentTime;
+	//	Live sources run the host clock through the latency controller.
+	videoCtx->progressTime = videoCtx->avhandler != nullptr ? (float)videoCtx->avhandler->updateLiveClock(currentTime) : currentTime;
+	videoCtx->clock.setHostTime(videoCtx->progressTime);
 }
 
 bool nativeIsAudioEnabled(int id) {
@@ -213,12 +483,12 @@ bool nativeIsAudioEnabled(int id) {
 	if (!getVideoContext(id, videoCtx)) { return false; }
 
 	if (videoCtx->avhandler->getDecoderState() < AVHandler::DecoderState::INITIALIZED) {
-		LOG("Decoder is unavailable currently. \n");
+		LOG_VERBOSE(Logger::CATEGORY_API, "Decoder is unavailable currently. \n");
 		return false;
 	}
 
 	bool ret = videoCtx->avhandler->getAudioInfo().isEnabled;
-	LOG("nativeIsAudioEnabled: %s \n", ret ? "true" : "false");
+	LOG_INFO(Logger::CATEGORY_API, "nativeIsAudioEnabled: %s \n", ret ? "true" : "false");
 	return ret;
 }
 
@@ -227,7 +497,7 @@ void nativeGetAudioFormat(int id, int& channel, int& frequency, float& totalTime
 	if (!getVideoContext(id, videoCtx)) { return; }
 
 	if (videoCtx->avhandler->getDecoderState() < AVHandler::DecoderState::INITIALIZED) {
-		LOG("Decoder is unavailable currently. \n");
+		LOG_VERBOSE(Logger::CATEGORY_API, "Decoder is unavailable currently. \n");
 		return;
 	}
 
@@ -241,7 +511,26 @@ float nativeGetAudioData(int id, unsigned char** audioData, int& frameSize) {
     std::shared_ptr<VideoContext> videoCtx;
 	if (!getVideoContext(id, videoCtx)) { return -1.0f; }
 
-	return (float) (videoCtx->avhandler->getAudioFrame(audioData, frameSize));
+	double frameTime = videoCtx->avhandler->getAudioFrame(audioData, frameSize);
+	unsigned int sampleRate = videoCtx->avhandler->getAudioInfo().sampleRate;
+	if (frameTime >= 0 && sampleRate > 0) {
+		videoCtx->clock.onAudioFrame(frameTime, (double)frameSize / sampleRate, DecoderStats::nowUs());
+	}
+
+	return (float)frameTime;
+}
+
+//	Like nativeGetAudioData with the layout of the frame, planar formats return one plane per channel.
+float nativeGetAudioPlanes(int id, unsigned char** planes, int maxPlanes, NativeAudioLayout& layout) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx)) { return -1.0f; }
+
+	double frameTime = videoCtx->avhandler->getAudioPlanes(planes, maxPlanes, layout);
+	if (frameTime >= 0 && layout.sampleRate > 0) {
+		videoCtx->clock.onAudioFrame(frameTime, (double)layout.samples / layout.sampleRate, DecoderStats::nowUs());
+	}
+
+	return (float)frameTime;
 }
 
 void nativeFreeAudioData(int id) {
@@ -251,17 +540,72 @@ void nativeFreeAudioData(int id) {
 	videoCtx->avhandler->freeAudioFrame();
 }
 
+//	While the ring is enabled, audio is read with nativeFillAudioBuffer and nativeGetAudioData returns nothing useful.
+bool nativeSetAudioRingEnable(int id, bool isEnable, int capacityMs) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return false; }
+
+	if (isEnable && id >= AUDIO_RING_SLOT_COUNT) {
+		LOG_WARNING(Logger::CATEGORY_AUDIO, "Audio ring supports decoder ids below %d. \n", AUDIO_RING_SLOT_COUNT);
+		return false;
+	}
+
+	if (!videoCtx->avhandler->setAudioRingEnable(isEnable, capacityMs)) {
+		return false;
+	}
+
+	if (isEnable) {
+		audioRingSlots[id].avhandler.store(videoCtx->avhandler.get());
+	}
+	return true;
+}
+
+//	Safe on the host audio thread: no lock, no allocation and no logging. An id without a ring, or one destroyed
+//	during the call, fills silence. Returns the frames taken from the ring, the rest of the buffer is silence.
+int nativeFillAudioBuffer(int id, float* buffer, int frameCount, int channels) {
+	int frames = 0;
+	bool isFilled = false;
+	if (id >= 0 && id < AUDIO_RING_SLOT_COUNT) {
+		AudioRingSlot& slot = audioRingSlots[id];
+		slot.readers.fetch_add(1);
+		AVHandler* avhandler = slot.avhandler.load();
+		if (avhandler != nullptr) {
+			frames = avhandler->fillAudioRing(buffer, frameCount, channels);
+			isFilled = true;
+		}
+		slot.readers.fetch_sub(1);
+	}
+
+	if (!isFilled && buffer != nullptr && frameCount > 0 && channels > 0) {
+		memset(buffer, 0, (size_t)frameCount * channels * sizeof(float));
+	}
+	return frames;
+}
+
+//	With the ring enabled the host pulls no audio through the API, so an audio clock samples the ring instead.
+static void updateAudioRingClock(VideoContext* videoCtx, int64_t nowUs) {
+	if (videoCtx->avhandler == nullptr || videoCtx->clock.getSource() != MediaClock::SOURCE_AUDIO) {
+		return;
+	}
+
+	double ringTime = videoCtx->avhandler->getAudioRingTime();
+	if (ringTime >= 0.0) {
+		videoCtx->clock.onAudioPosition(ringTime, nowUs);
+	}
+}
+
 void nativeSetSeekTime(int id, float sec) {
     std::shared_ptr<VideoContext> videoCtx;
 	if (!getVideoContext(id, videoCtx)) { return; }
 
 	if (videoCtx->avhandler->getDecoderState() < AVHandler::DecoderState::INITIALIZED) {
-		LOG("Decoder is unavailable currently. \n");
+		LOG_WARNING(Logger::CATEGORY_API, "Decoder is unavailable currently. \n");
 		return;
 	}
 
-	LOG("nativeSetSeekTime %f. \n", sec);
+	LOG_INFO(Logger::CATEGORY_API, "nativeSetSeekTime %f. \n", sec);
 	videoCtx->avhandler->setSeekTime(sec);
+	videoCtx->clock.reset();
 	if (!videoCtx->avhandler->getVideoInfo().isEnabled) {
 		videoCtx->isContentReady = true;
 	} else {
@@ -276,6 +620,29 @@ bool nativeIsSeekOver(int id) {
 	return !(videoCtx->avhandler->getDecoderState() == AVHandler::DecoderState::SEEK);
 }
 
+void nativeSetClockSource(int id, int source) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx)) { return; }
+
+	videoCtx->clock.setSource(source == MediaClock::SOURCE_AUDIO ? MediaClock::SOURCE_AUDIO : MediaClock::SOURCE_HOST);
+}
+
+void nativeSetAudioOutputLatency(int id, float seconds) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx)) { return; }
+
+	videoCtx->clock.setAudioLatency(seconds);
+}
+
+float nativeGetClockTime(int id) {
+	std::shared_ptr<VideoContext> videoCtx;
+	if (!getVideoContext(id, videoCtx)) { return -1.0f; }
+
+	int64_t nowUs = DecoderStats::nowUs();
+	updateAudioRingClock(videoCtx.get(), nowUs);
+	return (float)videoCtx->clock.getTime(nowUs);
+}
+
 bool nativeIsVideoBufferFull(int id) {
     std::shared_ptr<VideoContext> videoCtx;
 	if (!getVideoContext(id, videoCtx)) { return false; }
@@ -292,6 +659,7 @@ bool nativeIsVideoBufferEmpty(int id) {
 
 int nativeGetMetaData(const char* filePath, char*** key, char*** value) {
     std::unique_ptr<AVHandler> avHandler = std::make_unique<AVHandler>();
+	avHandler->setPriority(CodecThreadBudget::PRIORITY_LOW);
 	avHandler->init(filePath);
 
 	char** metaKey = nullptr;
@@ -314,6 +682,20 @@ int nativeGetMetaData(const char* filePath, char*** key, char*** value) {
 	return metaCount;
 }
 
+int64_t nativeGetSpriteSheetSize(int count, int tileWidth, int tileHeight, int columns, int videoOutputFormat) {
+	SpriteSheet::Params params = { count, tileWidth, tileHeight, columns, 0, videoOutputFormat };
+	return SpriteSheet::getAtlasSize(params);
+}
+
+//	Blocks until the atlas is complete, call it off the engine main thread. No decoder id is involved,
+//	the workers open their own contexts on the file.
+int nativeCreateSpriteSheet(const char* filePath, int count, int tileWidth, int tileHeight, int columns,
+	int workerCount, int videoOutputFormat, unsigned char* atlas, float* tileTimes) {
+	TRACE_SCOPE("nativeCreateSpriteSheet", -1);
+	SpriteSheet::Params params = { count, tileWidth, tileHeight, columns, workerCount, videoOutputFormat };
+	return SpriteSheet::generate(filePath, params, atlas, tileTimes);
+}
+
 bool nativeIsContentReady(int id) {
     std::shared_ptr<VideoContext> videoCtx;
 	if (!getVideoContext(id, videoCtx)) { return false; }
@@ -342,37 +724,135 @@ void nativeSetAudioAllChDataEnable(int id, bool isEnable) {
 	videoCtx->avhandler->setAudioAllChDataEnable(isEnable);
 }
 
+//	A frame with the time of the last presented one, possible after a seek back, is handed back instead of presented twice.
+static bool onVideoFrameLeased(VideoContext* videoCtx, NativeVideoLease& lease) {
+    if (videoCtx->lastUpdateTime == (float)lease.time) {
+        videoCtx->avhandler->releaseVideoFrame(lease.handle);
+        lease.handle = 0;
+        return false;
+    }
+
+    DecoderStats* stats = videoCtx->avhandler->getStats();
+    if (stats != nullptr) {
+        stats->videoFramesPresented.fetch_add(1, std::memory_order_relaxed);
+    }
+    videoCtx->lastUpdateTime = (float)lease.time;
+    videoCtx->isContentReady = true;
+    return true;
+}
+
+//	Next frame in decode order, once the host time set by nativeSetVideoTime reached the last one.
+static bool leaseNextVideoFrame(VideoContext* videoCtx, NativeVideoLease& lease) {
+    memset(&lease, 0, sizeof(NativeVideoLease));
+    lease.time = -1;
+    AVHandler* localAVHandler = videoCtx->avhandler.get();
+    if (localAVHandler->getDecoderState() < AVHandler::DecoderState::INITIALIZED || !localAVHandler->getVideoInfo().isEnabled ||
+        localAVHandler->getVideoInfo().lastTime > videoCtx->progressTime) {
+        return false;
+    }
+
+    return localAVHandler->leaseVideoFrame(-1.0, lease) && onVideoFrameLeased(videoCtx, lease);
+}
+
+//	A negative presentationTime presents at the decoder clock. Frames the clock has passed are released in the same call.
+static bool leaseVideoFrameAt(VideoContext* videoCtx, float presentationTime, NativeVideoLease& lease) {
+    memset(&lease, 0, sizeof(NativeVideoLease));
+    lease.time = -1;
+    AVHandler* localAVHandler = videoCtx->avhandler.get();
+    if (localAVHandler->getDecoderState() < AVHandler::DecoderState::INITIALIZED || !localAVHandler->getVideoInfo().isEnabled) {
+        return false;
+    }
+
+    double time = presentationTime;
+    if (time < 0) {
+        int64_t nowUs = DecoderStats::nowUs();
+        updateAudioRingClock(videoCtx, nowUs);
+        time = videoCtx->clock.getTime(nowUs);
+    }
+    if (time < 0) {
+        return false;
+    }
+
+    return localAVHandler->leaseVideoFrame(time, lease) && onVideoFrameLeased(videoCtx, lease);
+}
+
+//	Single frame contract on top of a lease kept by the context, a seek no longer frees the frame under the host.
 void nativeGrabVideoFrame(int id, void** frameData, bool& frameReady) {
+    TRACE_SCOPE("nativeGrabVideoFrame", id);
     frameReady = false;
     std::shared_ptr<VideoContext> videoCtx;
     if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return; }
-    if (videoCtx->videoFrameLocked) {
-        LOG("Release last video frame first");
+    if (videoCtx->videoFrameLease != 0) {
+        LOG_VERBOSE(Logger::CATEGORY_API, "Release last video frame first");
         return;
     }
 
-    AVHandler* localAVHandler = videoCtx->avhandler.get();
+    NativeVideoLease lease;
+    if (leaseNextVideoFrame(videoCtx.get(), lease)) {
+        *frameData = lease.planes[0];
+        videoCtx->videoFrameLease = lease.handle;
+        frameReady = true;
+    }
+}
 
-    if (localAVHandler != nullptr && localAVHandler->getDecoderState() >= AVHandler::DecoderState::INITIALIZED && localAVHandler->getVideoInfo().isEnabled) {
-        double videoDecCurTime = localAVHandler->getVideoInfo().lastTime;
-        if (videoDecCurTime <= videoCtx->progressTime) {
-
-            double curFrameTime = localAVHandler->getVideoFrame(frameData);
-            if (frameData != nullptr && curFrameTime != -1 && videoCtx->lastUpdateTime != curFrameTime) {
-                frameReady = true;
-                videoCtx->lastUpdateTime = (float)curFrameTime;
-                videoCtx->isContentReady = true;
-                videoCtx->videoFrameLocked = true;
-            }
-        }
+void nativeGrabVideoFrameAt(int id, float presentationTime, void** frameData, bool& frameReady, float& frameTime) {
+    TRACE_SCOPE("nativeGrabVideoFrameAt", id);
+    frameReady = false;
+    frameTime = -1.0f;
+    std::shared_ptr<VideoContext> videoCtx;
+    if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return; }
+    if (videoCtx->videoFrameLease != 0) {
+        LOG_VERBOSE(Logger::CATEGORY_API, "Release last video frame first");
+        return;
+    }
+
+    NativeVideoLease lease;
+    bool isLeased = leaseVideoFrameAt(videoCtx.get(), presentationTime, lease);
+    frameTime = (float)lease.time;
+    if (isLeased) {
+        *frameData = lease.planes[0];
+        videoCtx->videoFrameLease = lease.handle;
+        frameReady = true;
     }
 }
 
 void nativeReleaseVideoFrame(int id) {
+    TRACE_SCOPE("nativeReleaseVideoFrame", id);
     std::shared_ptr<VideoContext> videoCtx;
     if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) { return; }
-    videoCtx->avhandler->freeVideoFrame();
-    videoCtx->videoFrameLocked = false;
+    if (videoCtx->videoFrameLease != 0) {
+        videoCtx->avhandler->releaseVideoFrame(videoCtx->videoFrameLease);
+        videoCtx->videoFrameLease = 0;
+    }
+}
+
+bool nativeLeaseVideoFrame(int id, NativeVideoLease& lease) {
+    TRACE_SCOPE("nativeLeaseVideoFrame", id);
+    std::shared_ptr<VideoContext> videoCtx;
+    if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) {
+        memset(&lease, 0, sizeof(NativeVideoLease));
+        return false;
+    }
+
+    return leaseNextVideoFrame(videoCtx.get(), lease);
+}
+
+bool nativeLeaseVideoFrameAt(int id, float presentationTime, NativeVideoLease& lease) {
+    TRACE_SCOPE("nativeLeaseVideoFrameAt", id);
+    std::shared_ptr<VideoContext> videoCtx;
+    if (!getVideoContext(id, videoCtx) || videoCtx->avhandler == nullptr) {
+        memset(&lease, 0, sizeof(NativeVideoLease));
+        return false;
+    }
+
+    return leaseVideoFrameAt(videoCtx.get(), presentationTime, lease);
+}
+
+//	Safe on a host upload thread while the main thread keeps leasing or destroys the decoder, a lease stays valid
+//	after the destroy until it is released here. Handles are unique in the process, so the lease table is searched
+//	by handle alone and the id is only kept for the signature.
+bool nativeReleaseVideoLease(int id, int64_t handle) {
+    return FrameLeases::releaseHandle(handle);
 }
 
 bool nativeIsEOF(int id) {
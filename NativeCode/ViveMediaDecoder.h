@@ -1,21 +1,54 @@
 //========= Copyright 2015-2019, HTC Corporation. All rights reserved. ===========
 
 #pragma once
+#include "DecoderStats.h"
+#include "DecoderOptions.h"
 
 extern "C" {
     // Utils
     __declspec(dllexport) void nativeCleanAll();
     __declspec(dllexport) void nativeCleanDestroyedDecoders();
+	__declspec(dllexport) void nativeGetPendingTeardowns(int& count, long long& bytes);
+	__declspec(dllexport) void nativeSetCodecPoolSize(int size);
+	__declspec(dllexport) void nativeGetCodecPoolStats(int& idleCount, int& hitCount, int& missCount);
+	__declspec(dllexport) void nativeSetCodecThreadBudget(int threadCount);
+	__declspec(dllexport) void nativeGetCodecThreadStats(int& budget, int& liveDecoders, int& allocatedThreads);
+	__declspec(dllexport) void nativeSetOpenConcurrency(int concurrency);
+	__declspec(dllexport) void nativeGetOpenStats(int& concurrency, int& queued, int& running, long long& cancelled, NativeHistogram& queueWait, NativeHistogram& openTime);
+	__declspec(dllexport) void nativeResetOpenStats();
 	//	Decoder
 	__declspec(dllexport) int nativeCreateDecoder(const char* filePath, int& id);
 	__declspec(dllexport) int nativeCreateDecoderAsync(const char* filePath, int& id);
+	__declspec(dllexport) int nativeCreateDecoderPrerollAsync(const char* filePath, float startTime, int& id);
+	__declspec(dllexport) int nativeCreateDecoderWithOptionsAsync(const char* filePath, const NativeDecoderOptions& options, float prerollTime, int& id);
+	__declspec(dllexport) void nativeGetDefaultDecoderOptions(NativeDecoderOptions& options);
+	__declspec(dllexport) void nativeSetDefaultDecoderOptions(const NativeDecoderOptions& options);
 	__declspec(dllexport) int nativeGetDecoderState(int id);
+	__declspec(dllexport) void nativeSetDecoderPriority(int id, int priority);
+	__declspec(dllexport) void nativeSetMaxFrameRate(int id, float maxFrameRate);
 	__declspec(dllexport) bool nativeStartDecoding(int id);
     __declspec(dllexport) void nativeScheduleDestroyDecoder(int id);
 	__declspec(dllexport) void nativeDestroyDecoder(int id);
+	__declspec(dllexport) bool nativeHibernateDecoder(int id, bool isCloseInput);
+	__declspec(dllexport) void nativeResumeDecoderAsync(int id);
 	__declspec(dllexport) bool nativeIsEOF(int id);
     __declspec(dllexport) void nativeGrabVideoFrame(int id, void** frameData, bool& frameReady);
+	__declspec(dllexport) void nativeGrabVideoFrameAt(int id, float presentationTime, void** frameData, bool& frameReady, float& frameTime);
     __declspec(dllexport) void nativeReleaseVideoFrame(int id);
+	//	Leases may be held several at once and released in any order, from any thread. They outlive a destroy, so every lease has to be released.
+	__declspec(dllexport) bool nativeLeaseVideoFrame(int id, NativeVideoLease& lease);
+	__declspec(dllexport) bool nativeLeaseVideoFrameAt(int id, float presentationTime, NativeVideoLease& lease);
+	__declspec(dllexport) bool nativeReleaseVideoLease(int id, int64_t handle);
+	__declspec(dllexport) void nativeGetStartupTimings(int id, float& open, float& streamInfo, float& codecOpen, float& firstPacket, float& firstFrame);
+	__declspec(dllexport) bool nativeGetDecoderStats(int id, NativeDecoderStats& stats);
+	__declspec(dllexport) void nativeResetDecoderStats(int id);
+	__declspec(dllexport) bool nativeGetLiveLatency(int id, float& latency, float& rate);
+	//	Log
+	__declspec(dllexport) void nativeSetLogLevel(int level, int categories);
+	__declspec(dllexport) void nativeFlushLog();
+	//	Trace
+	__declspec(dllexport) void nativeSetTraceEnabled(bool isEnabled);
+	__declspec(dllexport) bool nativeDumpTrace(const char* path);
 	//	Video
 	__declspec(dllexport) bool nativeIsVideoEnabled(int id);
 	__declspec(dllexport) void nativeSetVideoEnable(int id, bool isEnable);
@@ -30,10 +63,20 @@ extern "C" {
 	__declspec(dllexport) void nativeSetAudioAllChDataEnable(int id, bool isEnable);
 	__declspec(dllexport) void nativeGetAudioFormat(int id, int& channel, int& frequency, float& totalTime);
 	__declspec(dllexport) float nativeGetAudioData(int id, unsigned char** audioData, int& frameSize);
+	__declspec(dllexport) float nativeGetAudioPlanes(int id, unsigned char** planes, int maxPlanes, NativeAudioLayout& layout);
 	__declspec(dllexport) void nativeFreeAudioData(int id);
+	__declspec(dllexport) bool nativeSetAudioRingEnable(int id, bool isEnable, int capacityMs);
+	__declspec(dllexport) int nativeFillAudioBuffer(int id, float* buffer, int frameCount, int channels);
 	//	Seek
 	__declspec(dllexport) void nativeSetSeekTime(int id, float sec);
 	__declspec(dllexport) bool nativeIsSeekOver(int id);
+	//	Clock
+	__declspec(dllexport) void nativeSetClockSource(int id, int source);
+	__declspec(dllexport) void nativeSetAudioOutputLatency(int id, float seconds);
+	__declspec(dllexport) float nativeGetClockTime(int id);
 	//  Utility
 	__declspec(dllexport) int nativeGetMetaData(const char* filePath, char*** key, char*** value);
+	__declspec(dllexport) int64_t nativeGetSpriteSheetSize(int count, int tileWidth, int tileHeight, int columns, int videoOutputFormat);
+	__declspec(dllexport) int nativeCreateSpriteSheet(const char* filePath, int count, int tileWidth, int tileHeight, int columns,
+		int workerCount, int videoOutputFormat, unsigned char* atlas, float* tileTimes);
 }
\ No newline at end of file